@@ -0,0 +1,10 @@
+#pragma once
+#include <events.h>
+
+// Front-panel buttons. Each edge interrupt restarts that pin's debounce timer;
+// once the line has been quiet for BUTTON_DEBOUNCE_MS the timer commits the
+// level and posts a press or long press into the FSM mailbox, so nothing
+// polls the pins.
+//   Start: released before RECIPE_SELECT_HOLD_MS -> StartPressed, else RecipeNext
+//   Reset: press -> ResetPressed; held BUTTON_LONG_PRESS_MS -> Debug on release
+void buttonsInit();
@@ -0,0 +1,38 @@
+#pragma once
+#include "config.h"
+#include <events.h>
+#include <stdint.h>
+
+// Cycle checkpoint in NVS: enough of each shoe's progress to resume a Running
+// cycle after a watchdog, panic or brownout reset (see CHECKPOINT_RESUME).
+// Elapsed times are relative to the moment the snapshot was taken.
+struct ShoeCheckpoint {
+  SubState state;
+  uint8_t phase;          // profiled sub-phase (CyclePhase in tskFSM.cpp)
+  uint8_t reEvapRetries;
+  float initialWetDiff;   // AH diff at WET entry; sets the WET tier
+  uint32_t queueWaitMs;
+  uint32_t wetElapsedMs;  // since WET start (0 = not started)
+  uint32_t peakAgoMs;     // since the evaporation peak (post-peak buffer)
+  uint32_t coolingElapsedMs;
+  uint32_t coolingMotorDurationMs;
+};
+
+struct CycleCheckpoint {
+  uint16_t version;  // CHECKPOINT_VERSION; set by checkpointSave()
+  uint16_t seq;      // write counter, for the logs
+  uint32_t runElapsedMs;
+  uint32_t uvRemainingMs;  // 0 = UV not running
+  RecipeId recipe;
+  ShoeCheckpoint shoes[NUM_BAYS];
+};
+
+// Start the writer task. Flash writes stall both cores for milliseconds, so
+// they run there instead of on the caller.
+void checkpointInit();
+// Read the stored checkpoint; false if there is none or its layout is stale
+bool checkpointLoad(CycleCheckpoint &out);
+// Queue a snapshot / erase the stored one. Non-blocking; the latest request
+// replaces one the writer has not reached yet.
+void checkpointSave(const CycleCheckpoint &cp);
+void checkpointClear();
@@ -52,6 +52,10 @@ constexpr uint32_t DRY_STABILIZE_MS = 90u * 1000u;  // Stabilization phase after
 constexpr uint32_t MOTOR_SAFETY_MS = 600u * 1000u;
 constexpr uint32_t HW_UV_DEFAULT_MS = 57u * 1000u;
 constexpr uint32_t HEATER_WARMUP_MS = 12u * 1000u;  // Extended for cold shoes (was 10s)
+constexpr uint32_t HEATER_WARMUP_MIN_MS = 30u * 1000u;       // WET warmup: heater on unconditionally at least this long
+constexpr uint32_t HEATER_WARMUP_EXTENDED_MS = 50u * 1000u;  // ... and this long for cold shoes
+constexpr float HEATER_WARMUP_COLD_C = 25.0f;                // a shoe below this is cold
+constexpr float HEATER_WET_TEMP_THRESHOLD_C = 38.0f;         // warmup target and heater cut-off in WET / re-evap
 constexpr uint32_t HEATER_WARMUP_MOTOR_DUTY = 65u;  // Motor duty during heater-only phase (before PID takes over)
 constexpr float COOLING_TEMP_FAN_BOOST_ON = 38.5f;      // If shoe temp >= this, boost fan during COOLING
 constexpr float COOLING_TEMP_RELEASE_C = 37.0f;         // Do not end COOLING motor phase until temp <= this
@@ -74,13 +78,6 @@ constexpr uint32_t RE_EVAP_MIN_TIME_SOAKED = 120u * 1000u;
 // WET post-peak buffer safeguards
 constexpr float WET_BUFFER_TEMP_HOT_C = 38.5f;          // If temp >= this at buffer end, extend buffer
 constexpr uint32_t WET_BUFFER_TEMP_EXTEND_MS = 30u * 1000u; // Add 30s buffer when hot
-// Adaptive heater warmup thresholds (override base when shoe already warm)
-constexpr float HEATER_WARMUP_FAST_35C = 35.0f;   // very warm shoe
-constexpr float HEATER_WARMUP_FAST_30C = 30.0f;   // warm shoe
-constexpr float HEATER_WARMUP_FAST_25C = 25.0f;   // mildly warm
-constexpr uint32_t HEATER_WARMUP_35C_MS = 3u * 1000u;
-constexpr uint32_t HEATER_WARMUP_30C_MS = 5u * 1000u;
-constexpr uint32_t HEATER_WARMUP_25C_MS = 7u * 1000u;
 // Heater efficiency cutoffs
 // Bang-bang heater control thresholds for WET phase
 constexpr float HEATER_MAX_TEMP_C = 39.0f;        // OFF at >= 39°C (aligned with smart controller)
@@ -133,6 +130,8 @@ constexpr int HW_DHT_PIN_2 = 4;
 // Buttons
 constexpr int HW_START_PIN = 35;
 constexpr int HW_RESET_PIN = 34;
+constexpr uint32_t BUTTON_DEBOUNCE_MS = 50u;       // line quiet this long before a level counts
+constexpr uint32_t BUTTON_LONG_PRESS_MS = 5000u;   // Reset held at least this long (see buttons.h)
 
 // Motors (PWM/MOSFET)
 constexpr int HW_MOTOR_PIN_0 = 25;
@@ -145,6 +144,7 @@ constexpr int HW_HEATER_PIN_1 = 5;
 // UV (PWM/MOSFET, single channel)
 constexpr int HW_UV_PIN_0 = 14;
 constexpr int HW_UV_PIN_1 = 12;
+constexpr uint8_t NUM_UV_CHANNELS = 2;  // uvStart()/uvStop() index range
 
 // LEDs
 constexpr int HW_STATUS_LED_PIN = 33;
@@ -153,6 +153,91 @@ constexpr int HW_ERROR_LED_PIN = 32;
 // Battery
 constexpr int HW_BATTERY_ADC_PIN = 39;
 
+// ==================== BAYS ====================
+// One bay holds one shoe: its DHT sensor (sensor 0 is ambient), fan motor and
+// heater. The FSM, motor and sensor tasks are written once against this table;
+// a larger cabinet only adds rows (and pins).
+constexpr uint8_t NUM_BAYS = 2;
+constexpr uint8_t NUM_DHT_SENSORS = 1 + NUM_BAYS;
+
+struct BayDescriptor {
+  const char *label;  // log prefix
+  int dhtPin;
+  int motorPin;
+  uint8_t motorPwmCh;  // LEDC channel (UV uses 2 and 3)
+  int heaterPin;
+};
+
+constexpr BayDescriptor HW_BAYS[NUM_BAYS] = {
+    {"SUB1", HW_DHT_PIN_1, HW_MOTOR_PIN_0, 0, HW_HEATER_PIN_0},
+    {"SUB2", HW_DHT_PIN_2, HW_MOTOR_PIN_1, 1, HW_HEATER_PIN_1},
+};
+
+// Index of bay `bay`'s sensor in the g_dht* sensor arrays
+constexpr uint8_t baySensor(uint8_t bay) {
+  return 1 + bay;
+}
+
+// ==================== POWER BUDGET ====================
+// Nominal worst-case draw per actuator. A bay reserves heater + fan before it
+// enters WET, keeps the fan share through the COOLING motor phase, and the UV
+// lamp reserves its own share. Bays wait in S_WAITING until their draw fits.
+constexpr uint16_t POWER_HEATER_W = 40;
+constexpr uint16_t POWER_MOTOR_W = 6;  // fan at 100% duty
+constexpr uint16_t POWER_UV_W = 5;
+constexpr uint16_t POWER_BASE_W = 3;  // controller, sensors and displays (always on)
+
+// Battery units fit one heating bay plus the capped extra fan share: bays
+// heat one at a time, as with the old single WET lock. A mains supply with
+// headroom for every bay's heater and fan dries them concurrently.
+constexpr bool HW_MAINS_POWERED = false;
+constexpr uint16_t POWER_BUDGET_BATTERY_W = POWER_HEATER_W + POWER_MOTOR_W + 4;
+constexpr uint16_t POWER_BUDGET_MAINS_W = 100;
+constexpr uint16_t POWER_BUDGET_W = HW_MAINS_POWERED ? POWER_BUDGET_MAINS_W : POWER_BUDGET_BATTERY_W;
+// Pipelined COOLING/WET: a bay may start WET while another bay's fan still
+// runs its COOLING motor phase. The fans are arbitrated to a combined duty cap
+// (heating bays first), so a COOLING fan only reserves the power the cap adds
+// above one full fan. Off: a COOLING fan reserves a full fan, which on battery
+// holds the next WET until the motor phase ends.
+constexpr bool PIPELINE_COOLING_OVERLAP = true;
+constexpr int FAN_COMBINED_DUTY_MAX_PCT = 150;  // sum of every fan's duty
+
+// Interleaved heating: a WET bay coasting with its heater off (trend-gated
+// control) drops to the fan share, so another bay can take the heater power
+// for its own WET; each bay asks for the heater again when it wants heat.
+// With the battery budget at most one heater is on at a time.
+constexpr bool HEATER_INTERLEAVE = true;
+
+// A waiting bay gains one unit of priority per interval (see WAIT_POLICY)
+constexpr uint32_t POWER_AGING_MS = 60u * 1000u;
+
+// Order in which waiting bays get heater power
+enum class WaitPolicy : uint8_t {
+  WettestFirst,   // highest AH diff first; aging adds 1 g/m^3 per POWER_AGING_MS
+  ShortestFirst,  // shortest predicted WET + COOLING first; aging offsets predicted time 1:1
+};
+constexpr WaitPolicy WAIT_POLICY = WaitPolicy::ShortestFirst;
+// Cycle prediction: fan cool-down time per degree from heater cut-off to ambient
+constexpr uint32_t SCHED_COOL_MS_PER_C = 10u * 1000u;
+
+// ==================== RECIPES ====================
+// Built-in drying recipes (see include/recipe.h). Standard is the tuning
+// above; holding Start for RECIPE_SELECT_HOLD_MS in Checking steps to the
+// next recipe, which lasts until power-off.
+enum class RecipeId : uint8_t { Standard, Mesh, Leather, Boots, Count };
+constexpr RecipeId RECIPE_DEFAULT = RecipeId::Standard;
+constexpr uint32_t RECIPE_SELECT_HOLD_MS = 1500u;
+
+// ==================== CHECKPOINT / RESUME ====================
+// Running progress is checkpointed to NVS at phase boundaries (batched: at
+// most one write per CHECKPOINT_MIN_GAP_MS) and every CHECKPOINT_INTERVAL_MS
+// while a timed phase (WET, COOLING, UV) runs. After a watchdog, panic or
+// brownout reset the cycle resumes from it; any other reset, or a button
+// press before the resume starts, discards it.
+constexpr bool CHECKPOINT_RESUME = true;
+constexpr uint32_t CHECKPOINT_MIN_GAP_MS = 5u * 1000u;
+constexpr uint32_t CHECKPOINT_INTERVAL_MS = 60u * 1000u;
+
 // ==================== HARDWARE POLARITY ====================
 constexpr bool HW_RELAY_ACTIVE_LOW = false;
 constexpr bool HW_ACTUATOR_ACTIVE_LOW = false;
@@ -173,3 +258,19 @@ constexpr float BATTERY_LOW_THRESHOLD = 10.0f;
 constexpr float BATTERY_RECOVERY_THRESHOLD = 10.8f;
 constexpr int BATTERY_ADC_SAMPLES = 32;
 constexpr uint32_t BATTERY_CHECK_INTERVAL_MS = 1000u;
+
+// Mid-cycle degradation ladder (Running). The battery task estimates the
+// resting voltage from each reading plus the present load's sag, so a heater
+// switching on does not look like a drained pack, and steps down as it falls:
+// cap the fans, then hold the heaters, then pause the cycle. Each rung steps
+// back up once the resting voltage clears it by the hysteresis.
+constexpr float BATTERY_CAP_FANS_V = 11.0f;
+constexpr float BATTERY_HOLD_HEATERS_V = 10.7f;
+constexpr float BATTERY_PAUSE_V = 10.4f;
+constexpr float BATTERY_LADDER_HYST_V = 0.2f;
+constexpr uint32_t BATTERY_LADDER_DWELL_MS = 30u * 1000u;  // min time on a rung before stepping up
+// A loaded reading under this steps one rung down at once, whatever the model says
+constexpr float BATTERY_MIN_LOADED_V = 10.2f;
+// Pack + wiring resistance; the starting guess, refined from load steps
+constexpr float BATTERY_INTERNAL_OHM = 0.12f;
+constexpr int BATTERY_FAN_CAP_PCT = 60;  // CapFans rung: combined duty of every fan
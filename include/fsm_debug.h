@@ -54,14 +54,14 @@ inline const char *eventName(Event e) {
     return "SensorTimeout";
   if (v == static_cast<uint32_t>(Event::SubFSMDone))
     return "SubFSMDone";
-  if (v == static_cast<uint32_t>(Event::Shoe0InitWet))
-    return "Shoe0InitWet";
-  if (v == static_cast<uint32_t>(Event::Shoe0InitDry))
-    return "Shoe0InitDry";
-  if (v == static_cast<uint32_t>(Event::Shoe1InitWet))
-    return "Shoe1InitWet";
-  if (v == static_cast<uint32_t>(Event::Shoe1InitDry))
-    return "Shoe1InitDry";
+  if (v == static_cast<uint32_t>(Event::InitWet))
+    return "InitWet";
+  if (v == static_cast<uint32_t>(Event::InitDry))
+    return "InitDry";
+  if (v == static_cast<uint32_t>(Event::Resume))
+    return "Resume";
+  if (v == static_cast<uint32_t>(Event::RecipeNext))
+    return "RecipeNext";
   return "Event(unknown)";
 }
 
@@ -11,32 +11,48 @@
 static constexpr float kAmbAhOffset = AMB_AH_OFFSET;
 
 // Raw temperature and humidity readings (indexed by sensor)
-extern volatile float g_dhtTemp[3];
-extern volatile float g_dhtHum[3];
+extern volatile float g_dhtTemp[NUM_DHT_SENSORS];
+extern volatile float g_dhtHum[NUM_DHT_SENSORS];
 
 // Instantaneous absolute humidity (g/m^3)
-extern volatile float g_dhtAH[3];
+extern volatile float g_dhtAH[NUM_DHT_SENSORS];
 
-// Differences relative to sensor 0 (two diffs: sensor1 - sensor0, sensor2 - sensor0)
-extern volatile float g_dhtAHDiff[2];
+// Differences relative to sensor 0, one per bay (bay sensor - sensor 0)
+extern volatile float g_dhtAHDiff[NUM_BAYS];
 
 // EMA-filtered absolute humidity and diffs
-extern volatile float g_dhtAH_ema[3];
-extern volatile float g_dhtAHDiff_ema[2];
+extern volatile float g_dhtAH_ema[NUM_DHT_SENSORS];
+extern volatile float g_dhtAHDiff_ema[NUM_BAYS];
 
-// Boolean wet/dry status for sensors 1 and 2 (true = wet)
-extern volatile bool g_dhtIsWet[2];
+// Boolean wet/dry status per bay (true = wet)
+extern volatile bool g_dhtIsWet[NUM_BAYS];
 
-// AH rate-of-change in g/m³/min for sensors 1 and 2 (calculated by motor task)
-extern float g_dhtAHRate[2];
+// AH rate-of-change in g/m³/min per bay (calculated by motor task)
+extern float g_dhtAHRate[NUM_BAYS];
 
 // Count of NaN occurrences per DHT sensor (temperature or humidity read failures)
-extern volatile uint32_t g_dhtNaNCount[3];
+extern volatile uint32_t g_dhtNaNCount[NUM_DHT_SENSORS];
 
-// Cached battery voltage (updated during Checking state and at boot)
+// Incremented after each full sensor pass (temps, AH and diffs all updated)
+extern volatile uint32_t g_dhtSampleSeq;
+
+// Cached battery voltage (kept fresh by the battery sampler task)
 extern volatile float g_lastBatteryVoltage;
 
-// Battery voltage monitoring
+// Mid-cycle battery degradation ladder (see BATTERY_CAP_FANS_V), chosen by
+// the battery task; each rung includes the ones before it
+enum class BatteryRung : uint8_t {
+  Normal,
+  CapFans,      // combined fan duty capped at BATTERY_FAN_CAP_PCT
+  HoldHeaters,  // heater relays held off
+  Pause,        // fans off too; the FSM freezes the cycle until the pack recovers
+};
+extern volatile BatteryRung g_batteryRung;
+// Estimated resting (no-load) battery voltage
+extern volatile float g_batteryRestV;
+
+// Battery voltage monitoring. readBatteryVoltage() samples the ADC (~64 ms);
+// the checks compare the cached voltage and never block.
 float readBatteryVoltage();
 bool isBatteryOk();
 bool isBatteryRecovered();
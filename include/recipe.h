@@ -0,0 +1,59 @@
+#pragma once
+#include "config.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Drying recipe: the thresholds that set a cycle's length for one kind of
+// shoe. The WET and COOLING scripts read them from the shoe's recipe, so a
+// light mesh shoe does not pay a leather boot's timings.
+
+// Wetness tier, picked by the AH diff at WET entry: the first tier whose
+// maxDiff is above it (the last one has INFINITY)
+struct RecipeTier {
+  float maxDiff;
+  const char *name;
+  uint32_t wetMinMs;     // minimum WET time
+  uint32_t wetMaxMs;     // WET safety limit when no peak is seen
+  uint32_t bufferMs;     // post-peak buffer
+  uint32_t peakMinMs;    // earliest moving-average peak ...
+  float peakRate;        // ... once the recent AH rate is below this (g/m^3/min)
+  uint32_t riseMinMs;    // earliest rise-from-minimum peak ...
+  float rise;            // ... once the AH diff is this far above its WET minimum
+  uint32_t reEvapMinMs;  // re-evap: earliest rise exit ...
+  float reEvapRise;      // ... once the AH diff is this far above its re-evap minimum
+};
+
+// COOLING motor phase, picked by the AH diff at the end of WET: the first band
+// it exceeds (the last one has -INFINITY)
+struct CoolingBand {
+  float minDiff;
+  uint32_t motorMs;
+  int duty;  // fan duty at COOLING start
+};
+
+constexpr size_t RECIPE_TIERS = 4;
+constexpr size_t RECIPE_COOLING_BANDS = 3;
+
+struct Recipe {
+  const char *name;      // logs
+  const char *abbr;      // display (4 chars)
+  float heaterMaxC;      // warmup target and heater cut-off (trend-gated WET, re-evap)
+  uint32_t warmupMinMs;  // heater on unconditionally at least this long ...
+  uint32_t warmupColdMs; // ... or this long for a cold shoe
+  float coldBelowC;      // shoe temperature that counts as cold
+  RecipeTier tiers[RECIPE_TIERS];
+  CoolingBand cooling[RECIPE_COOLING_BANDS];
+  uint32_t stabilizeMs;  // after the COOLING motor phase, before the dry-check
+  uint32_t reEvapMaxMs;
+};
+
+constexpr size_t NUM_RECIPES = static_cast<size_t>(RecipeId::Count);
+
+const Recipe &recipe(RecipeId id);
+const RecipeTier &recipeTier(const Recipe &r, float ahDiff);
+const CoolingBand &recipeCoolingBand(const Recipe &r, float ahDiff);
+
+// Recipe the next cycle runs (RECIPE_DEFAULT at boot), and stepping to the next
+// one in RecipeId order. Owned by the FSM task.
+RecipeId recipeSelected();
+RecipeId recipeSelectNext();
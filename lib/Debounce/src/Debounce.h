@@ -0,0 +1,50 @@
+#pragma once
+
+// system includes
+#include <stdint.h>
+
+// What a settled contact did
+enum class DebounceEdge : uint8_t { None, Press, Release, LongRelease };
+
+// Debounce state of one contact. Every edge restarts the quiet window; the
+// level is trusted only once the line has not changed for the window, and is
+// then committed with settle(). Bounce that returns to the committed level
+// commits nothing, so a press is never reported twice and a release is never
+// lost. A tap shorter than the window is dropped whole.
+// edge() may run in an ISR while due()/settle() run in one task; settling the
+// same level twice is harmless, so an edge racing a settle only costs one
+// more window.
+class Debouncer {
+public:
+  // The line changed level; restart the quiet window
+  void edge(uint32_t nowMs) {
+    _lastEdgeMs = nowMs;
+  }
+
+  // True once the line has been quiet for windowMs since the last edge
+  bool due(uint32_t nowMs, uint32_t windowMs) const {
+    return (uint32_t)(nowMs - _lastEdgeMs) >= windowMs;
+  }
+
+  // Commit the level read after the line went quiet (down = pressed). A
+  // release reports LongRelease if the press lasted longMs or more.
+  DebounceEdge settle(bool down, uint32_t nowMs, uint32_t longMs) {
+    if (down == _down)
+      return DebounceEdge::None;
+    _down = down;
+    if (down) {
+      _pressMs = nowMs;
+      return DebounceEdge::Press;
+    }
+    return (uint32_t)(nowMs - _pressMs) >= longMs ? DebounceEdge::LongRelease : DebounceEdge::Release;
+  }
+
+  bool down() const {
+    return _down;
+  }
+
+private:
+  volatile uint32_t _lastEdgeMs = 0;
+  bool _down = false;
+  uint32_t _pressMs = 0;  // commit time of the current press
+};
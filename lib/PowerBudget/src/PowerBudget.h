@@ -0,0 +1,133 @@
+#pragma once
+
+// system includes
+#include <stddef.h>
+#include <stdint.h>
+
+// Admission control for a shared power supply. Each client (a bay, the UV
+// lamp, ...) holds a grant in watts; the sum of grants never exceeds the
+// budget. A client that needs more asks with request() every time it polls
+// and keeps a pending request until it is granted, release()d or cancel()led.
+//
+// Pending requests are ranked by priority plus aging: a request gains one
+// priority unit per agingMs spent waiting, so a low-priority client is not
+// starved. A request is granted only if it fits and every higher-ranked
+// pending request still fits in what is left, so a small request can use
+// spare headroom but never delays a bigger one that ranks above it.
+// Not thread-safe: owned by the FSM task.
+template <size_t NumClients> class PowerBudget {
+  static_assert(NumClients > 0 && NumClients <= 32, "NumClients must fit the 32-bit pending mask");
+
+public:
+  PowerBudget(uint16_t budgetW, uint32_t agingMs) : _budgetW(budgetW), _agingMs(agingMs) {}
+
+  // Ask for a grant of `watts` in place of the client's current one. Shrinking
+  // always succeeds. Returns true once granted; `priority` may change between
+  // calls (higher goes first).
+  bool request(size_t client, uint16_t watts, float priority, uint32_t nowMs) {
+    if (client >= NumClients)
+      return false;
+    if (watts <= _grantW[client]) {
+      reduce(client, watts);
+      return true;
+    }
+    enqueue(client, watts, priority, nowMs);
+
+    // Headroom left once this client holds `watts`
+    int32_t left = static_cast<int32_t>(_budgetW) - (_usedW - _grantW[client]) - watts;
+    if (left < 0)
+      return false;
+    float rank = rankOf(client, nowMs);
+    uint32_t bit = 1u << client;
+    for (uint32_t m = _pendingMask & ~bit; m; m &= m - 1) {
+      size_t other = static_cast<size_t>(__builtin_ctz(m));
+      float theirs = rankOf(other, nowMs);
+      bool ahead = theirs > rank || (theirs == rank && other < client);
+      if (ahead && _wantW[other] - _grantW[other] > left)
+        return false;
+    }
+
+    _pendingMask &= ~bit;
+    _usedW = static_cast<uint16_t>(_usedW - _grantW[client] + watts);
+    _grantW[client] = watts;
+    return true;
+  }
+
+  // Queue a request without trying to grant it, so that it already ranks
+  // against clients that poll before this one does. Keeps the original wait
+  // time if the client is already pending.
+  void enqueue(size_t client, uint16_t watts, float priority, uint32_t nowMs) {
+    if (client >= NumClients)
+      return;
+    uint32_t bit = 1u << client;
+    if (!(_pendingMask & bit)) {
+      _pendingMask |= bit;
+      _sinceMs[client] = nowMs;
+    }
+    _wantW[client] = watts;
+    _priority[client] = priority;
+  }
+
+  // Lower the client's grant to `watts` (kept if it already holds less) and
+  // drop any pending request
+  void reduce(size_t client, uint16_t watts) {
+    if (client >= NumClients)
+      return;
+    _pendingMask &= ~(1u << client);
+    if (watts >= _grantW[client])
+      return;
+    _usedW = static_cast<uint16_t>(_usedW - (_grantW[client] - watts));
+    _grantW[client] = watts;
+  }
+
+  // Drop the client's grant and any pending request
+  void release(size_t client) {
+    reduce(client, 0);
+  }
+
+  // Withdraw a pending request, keeping the current grant
+  void cancel(size_t client) {
+    if (client < NumClients)
+      _pendingMask &= ~(1u << client);
+  }
+
+  // Leave `ms` out of every pending request's wait, e.g. while the supply was
+  // paused and nobody could have been granted anyway
+  void holdAging(uint32_t ms) {
+    for (uint32_t m = _pendingMask; m; m &= m - 1)
+      _sinceMs[__builtin_ctz(m)] += ms;
+  }
+
+  void releaseAll() {
+    for (size_t i = 0; i < NumClients; ++i)
+      release(i);
+  }
+
+  uint16_t granted(size_t client) const {
+    return client < NumClients ? _grantW[client] : 0;
+  }
+  bool pending(size_t client) const {
+    return client < NumClients && (_pendingMask & (1u << client));
+  }
+  uint16_t usedW() const {
+    return _usedW;
+  }
+  uint16_t budgetW() const {
+    return _budgetW;
+  }
+
+private:
+  float rankOf(size_t client, uint32_t nowMs) const {
+    float aged = _agingMs ? static_cast<float>(nowMs - _sinceMs[client]) / _agingMs : 0.0f;
+    return _priority[client] + aged;
+  }
+
+  uint16_t _budgetW;
+  uint32_t _agingMs;
+  uint16_t _usedW = 0;
+  uint32_t _pendingMask = 0;
+  uint16_t _grantW[NumClients] = {};
+  uint16_t _wantW[NumClients] = {};
+  float _priority[NumClients] = {};
+  uint32_t _sinceMs[NumClients] = {};
+};
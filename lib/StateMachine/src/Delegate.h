@@ -0,0 +1,69 @@
+#pragma once
+
+// system includes
+#include <type_traits>
+
+// Fixed-size, heap-free callback: a function pointer plus an optional context
+// pointer. Unlike std::function it never allocates, is trivially copyable and
+// can be built in constant expressions, so state tables holding it stay in
+// flash. Captureless lambdas convert implicitly; state is passed through an
+// explicit context pointer via bind<>() instead of lambda captures.
+template <typename Sig> class Delegate;
+
+template <typename R, typename... Args> class Delegate<R(Args...)> {
+public:
+  using FreeFn = R (*)(Args...);
+
+  constexpr Delegate() = default;
+  constexpr Delegate(decltype(nullptr)) {}
+  constexpr Delegate(FreeFn fn) : _free(fn) {}
+
+  // Accepts captureless lambdas (and other callables convertible to FreeFn).
+  // Anything that carries captures would need storage, so it is rejected at
+  // compile time rather than silently falling back to the heap.
+  template <typename F, typename = typename std::enable_if<
+                            !std::is_same<typename std::decay<F>::type, Delegate>::value>::type>
+  constexpr Delegate(F fn) : _free(toFree(fn)) {}
+
+  // Call Fn(ctx, args...) - a free function taking a typed context pointer.
+  template <auto Fn, typename T> static constexpr Delegate bind(T *ctx) {
+    return Delegate(
+        [](void *p, Args... args) -> R { return Fn(static_cast<T *>(p), args...); }, ctx);
+  }
+
+  // Call (obj->*Method)(args...).
+  template <auto Method, typename T> static constexpr Delegate bindMember(T *obj) {
+    return Delegate(
+        [](void *p, Args... args) -> R { return (static_cast<T *>(p)->*Method)(args...); }, obj);
+  }
+
+  constexpr explicit operator bool() const {
+    return _ctx != nullptr || _free != nullptr;
+  }
+
+  R operator()(Args... args) const {
+    return _ctx ? _bound(_ctx, args...) : _free(args...);
+  }
+
+private:
+  using BoundFn = R (*)(void *, Args...);
+
+  constexpr Delegate(BoundFn fn, void *ctx) : _bound(fn), _ctx(ctx) {}
+
+  template <typename F> static constexpr FreeFn toFree(F fn) {
+    static_assert(std::is_convertible<F, FreeFn>::value,
+                  "Delegate: callable has captures; use Delegate::bind<>() with a context pointer");
+    return fn;
+  }
+
+  // _ctx selects the active member: null -> _free, non-null -> _bound.
+  union {
+    FreeFn _free = nullptr;
+    BoundFn _bound;
+  };
+  void *_ctx = nullptr;
+};
+
+static_assert(sizeof(Delegate<void()>) == 2 * sizeof(void *), "Delegate must stay two words");
+static_assert(std::is_trivially_copyable<Delegate<void()>>::value,
+              "Delegate must be trivially copyable");
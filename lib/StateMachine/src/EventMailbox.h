@@ -0,0 +1,90 @@
+#pragma once
+
+// system includes
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// project includes
+#include "StateMachine.h"
+
+// Lock-free event mailbox for single-bit events. Producers (any task or ISR)
+// set the event's bit with one atomic fetch_or, so posting is wait-free and a
+// second post of an event that is still pending coalesces into the first.
+// A single consumer pops pending events in a fixed priority order.
+//
+// Each event is addressed to one of NumTargets targets (0 by default) with a
+// scalar payload. Every target has its own pending word, so the same event
+// posted to two targets is two pending slots and neither is lost. A coalesced
+// post overwrites the payload (newest value wins).
+template <typename EventT, size_t NumEvents, size_t NumTargets = 1> class EventMailbox {
+public:
+  // Returns false if the event was already pending for this target
+  // (coalesced) or invalid.
+  bool post(EventT ev, uint8_t target = 0, uint32_t arg = 0) {
+    uint32_t bit = static_cast<uint32_t>(ev);
+    size_t idx = eventIndex(ev);
+    if (!bit || idx >= NumEvents || target >= NumTargets)
+      return false;
+    // Payload first: the release below publishes it with the bit.
+    _arg[target][idx].store(arg, std::memory_order_relaxed);
+    uint32_t prev = _pending[target].fetch_or(bit, std::memory_order_release);
+    if (prev & bit) {
+      _overflow[idx].fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+
+  // Consumer side: clear and return the highest-priority pending event with
+  // its target and payload. Bits listed in `order` go first, in the order
+  // given; any other pending bits follow lowest-bit-first. Targets pending
+  // the same event are served lowest-first. Returns false when nothing is
+  // pending.
+  template <size_t N>
+  bool pop(EventT &out, uint8_t &target, uint32_t &arg, const EventT (&order)[N]) {
+    uint32_t words[NumTargets];
+    uint32_t pending = 0;
+    for (size_t t = 0; t < NumTargets; ++t) {
+      words[t] = _pending[t].load(std::memory_order_acquire);
+      pending |= words[t];
+    }
+    if (!pending)
+      return false;
+    uint32_t bit = pending & (~pending + 1);  // lowest set bit
+    for (size_t i = 0; i < N; ++i) {
+      uint32_t b = static_cast<uint32_t>(order[i]);
+      if (pending & b) {
+        bit = b;
+        break;
+      }
+    }
+    size_t t = 0;
+    while (!(words[t] & bit))
+      ++t;
+    // Only the consumer clears bits, so `bit` is still set here. Clearing
+    // before reading the payload means a concurrent re-post stays pending
+    // instead of being lost; this pop may then see its newer payload.
+    _pending[t].fetch_and(~bit, std::memory_order_acq_rel);
+    out = static_cast<EventT>(bit);
+    target = static_cast<uint8_t>(t);
+    arg = _arg[t][eventIndex(out)].load(std::memory_order_relaxed);
+    return true;
+  }
+
+  // Pending events for one target
+  uint32_t pending(uint8_t target = 0) const {
+    return target < NumTargets ? _pending[target].load(std::memory_order_relaxed) : 0;
+  }
+
+  // Number of posts of `ev` that found it already pending (any target).
+  uint32_t overflowCount(EventT ev) const {
+    size_t idx = eventIndex(ev);
+    return idx < NumEvents ? _overflow[idx].load(std::memory_order_relaxed) : 0;
+  }
+
+private:
+  std::atomic<uint32_t> _pending[NumTargets] = {};
+  std::atomic<uint32_t> _arg[NumTargets][NumEvents] = {};
+  std::atomic<uint32_t> _overflow[NumEvents] = {};
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+// system includes
+#include <stdint.h>
+
+// Stackless resumable body for a state's run callback (a protothread). A
+// script written with the PS_* macros reads as one linear sequence - heat,
+// wait for 38 C or 30 s, start the motor, ... - and each call resumes where
+// the previous one suspended instead of re-deriving its position from flags.
+//
+// The macros expand to one `switch` over the resume point, so:
+// - locals do not survive a suspension; keep them in the script's context
+// - at most one suspension per source line, none inside a nested `switch`
+// - a local declared before a suspension in the same block needs its own
+//   braces (the jump may not cross its initialization)
+class PhaseScript {
+public:
+  // Start again from PS_BEGIN on the next resume (call from the state entry)
+  void reset() {
+    _line = 0;
+  }
+
+  // Resume point; only the macros touch it
+  static constexpr uint16_t kFinished = 0xFFFF;
+  uint16_t _line = 0;
+};
+
+#define PS_BEGIN(ps)                                                                               \
+  switch ((ps)._line) {                                                                            \
+  case 0:
+
+#define PS_END(ps)                                                                                 \
+  }                                                                                                \
+  (ps)._line = PhaseScript::kFinished
+
+// Suspend; resume on the next call
+#define PS_YIELD(ps)                                                                               \
+  do {                                                                                             \
+    (ps)._line = __LINE__;                                                                         \
+    return;                                                                                        \
+  case __LINE__:;                                                                                  \
+  } while (0)
+
+// Suspend until `cond` holds; it is re-evaluated on each resume, so keep it
+// to a cheap comparison (e.g. a sensor sample counter against a snapshot).
+#define PS_WAIT_UNTIL(ps, cond)                                                                    \
+  do {                                                                                             \
+    (ps)._line = __LINE__;                                                                         \
+  case __LINE__:                                                                                   \
+    if (!(cond))                                                                                   \
+      return;                                                                                      \
+  } while (0)
+
+// Finish now; later resumes do nothing until reset()
+#define PS_EXIT(ps)                                                                                \
+  do {                                                                                             \
+    (ps)._line = PhaseScript::kFinished;                                                           \
+    return;                                                                                        \
+  } while (0)
@@ -0,0 +1,61 @@
+#include "TransitionTrace.h"
+
+#include <Arduino.h>
+#include <esp_attr.h>
+
+// Marks a ring written by this firmware; anything else is power-on garbage
+static constexpr uint32_t TRACE_MAGIC = 0x54524331u;  // "TRC1"
+
+__NOINIT_ATTR TransitionTrace g_fsmTrace;
+
+size_t TransitionTrace::snapshot(TraceRecord *out, size_t maxOut) const {
+  uint32_t head = total();
+  size_t n = head < kDepth ? head : kDepth;
+  if (n > maxOut)
+    n = maxOut;
+  uint32_t first = head - n;
+  for (size_t i = 0; i < n; ++i)
+    out[i] = _ring[(first + i) % kDepth];
+
+  // Records the writer reached during the copy (including one in progress)
+  // may be torn; drop them from the front.
+  uint32_t after = total();
+  uint32_t oldestValid = (after + 1 > kDepth) ? after + 1 - kDepth : 0;
+  if ((int32_t)(oldestValid - first) <= 0)
+    return n;
+  size_t drop = oldestValid - first;
+  if (drop >= n)
+    return 0;
+  for (size_t i = drop; i < n; ++i)
+    out[i - drop] = out[i];
+  return n - drop;
+}
+
+bool TransitionTrace::begin() {
+  if (_magic == TRACE_MAGIC)
+    return true;
+  clear();
+  return false;
+}
+
+void TransitionTrace::clear() {
+  _head = 0;
+  _magic = TRACE_MAGIC;
+}
+
+void fsmTraceDump(size_t count) {
+  if (!Serial)
+    return;
+  static TraceRecord buf[TransitionTrace::kDepth];
+  if (count > TransitionTrace::kDepth)
+    count = TransitionTrace::kDepth;
+  size_t n = g_fsmTrace.snapshot(buf, count);
+  uint32_t mhz = ESP.getCpuFreqMHz();
+  Serial.printf("[TRACE] %lu transitions total, last %u:\n", (unsigned long)g_fsmTrace.total(),
+                (unsigned)n);
+  for (size_t i = 0; i < n; ++i) {
+    const TraceRecord &r = buf[i];
+    Serial.printf("[TRACE] %lu ms m%u %u --e%u--> %u (%lu us)\n", (unsigned long)r.ms, r.machine, r.from,
+                  r.event, r.to, (unsigned long)(mhz ? r.cycles / mhz : r.cycles));
+  }
+}
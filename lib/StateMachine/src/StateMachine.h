@@ -1,126 +1,736 @@
 #pragma once
 
 // system includes
-#include <functional>
-#include <map>
-#include <vector>
+#include <stddef.h>
+#include <stdint.h>
 
 // project includes
-#include "fsm_debug.h"
+#include "Delegate.h"
+#include "TimerWheel.h"
+#include "TransitionTrace.h"
+#ifdef FSM_STATS
+#include "StateMachineStats.h"
+#endif
 
-// Alias for any callback with no args
-using ActionFn = std::function<void()>;
+// Time source for state timers; override for host builds.
+#ifndef FSM_MILLIS
+#include <Arduino.h>
+#define FSM_MILLIS() millis()
+#endif
 
-// Transition descriptor
-template <typename StateT, typename EventT> struct Transition {
+// Alias for any callback with no args. Delegate is a literal type, so the
+// tables below are built at compile time and end up in .rodata (flash on the
+// ESP32), and calling one never allocates.
+using ActionFn = Delegate<void()>;
+// Callback for tables shared by a StateMachineBank: receives the index of the
+// instance it runs for.
+using IndexedFn = Delegate<void(uint8_t)>;
+
+// Guard predicate matching a callback type: same arguments, returns bool.
+template <typename Fn> struct GuardFor;
+template <typename... Args> struct GuardFor<Delegate<void(Args...)>> {
+  using type = Delegate<bool(Args...)>;
+};
+
+// Transition descriptor. A transition with a guard only fires while the
+// guard returns true; nullptr (or leaving it out of the row) means always.
+template <typename StateT, typename EventT, typename Fn = ActionFn> struct Transition {
   StateT from;
   EventT event;
   StateT to;
-  ActionFn action;
+  Fn action;
+  typename GuardFor<Fn>::type guard = nullptr;
+};
+
+// Per-state callbacks. Any of entry/exit/run may be nullptr. A runPeriodMs of
+// 0 calls `run` on every run(); otherwise only on the grid runOffsetMs +
+// k * runPeriodMs, so states sharing a period can be phased apart.
+template <typename StateT, typename Fn = ActionFn> struct StateHandlers {
+  StateT state;
+  Fn entry;
+  Fn exit;
+  Fn run;
+  uint32_t runPeriodMs = 0;
+  uint32_t runOffsetMs = 0;
+};
+
+// Hierarchy edge: `state` is nested in super-state `parent`. Super-states are
+// never current; they hold transitions and handlers shared by their children.
+template <typename StateT> struct StateParent {
+  StateT state;
+  StateT parent;
+};
+
+// Per-state timeout: `event` is dispatched `ms` after `state` is entered,
+// unless the state is left first.
+template <typename StateT, typename EventT> struct StateTimeout {
+  StateT state;
+  uint32_t ms;
+  EventT event;
+};
+
+// Events are single-bit flags, so the dispatch column is the bit position.
+// Event::None (0) maps to column 0, which never holds a transition.
+template <typename EventT> constexpr uint8_t eventIndex(EventT ev) {
+  return static_cast<uint32_t>(ev) ? static_cast<uint8_t>(__builtin_ctz(static_cast<uint32_t>(ev))) : 0;
+}
+
+// Flat dispatch table: dispatch[state][eventIndex] holds the index of the
+// first candidate transition (or kNoTransition), already resolved through the
+// state's super-states; next[t] chains to the candidate tried when t's guard
+// fails. parent[state] is kNoParent for top-level states. Build with
+// makeStateTable().
+template <typename StateT, typename EventT, size_t NumStates, size_t NumEvents, size_t NumTransitions,
+          typename Fn = ActionFn>
+struct StateTable {
+  static constexpr uint8_t kNoTransition = 0xFF;
+  static constexpr uint8_t kNoParent = 0xFF;
+  static_assert(NumTransitions < kNoTransition, "too many transitions for uint8_t dispatch index");
+  static_assert(NumStates < kNoParent, "too many states for uint8_t parent index");
+
+  Transition<StateT, EventT, Fn> transitions[NumTransitions];
+  StateHandlers<StateT, Fn> handlers[NumStates];
+  uint8_t dispatch[NumStates][NumEvents];
+  uint8_t next[NumTransitions];
+  uint8_t parent[NumStates];
 };
 
-// Core state-machine template
-template <typename StateT, typename EventT> class StateMachine {
+// Deliberately not constexpr: reaching it while evaluating makeStateTable()
+// turns a malformed table into a build error for constexpr tables.
+inline void stateTableError(const char * /*why*/) {}
+
+// Compile-time table builder. The candidates for a (state, event) pair are the
+// state's own transitions for that event in table order, followed by those of
+// its nearest super-state that has any (and so on up); the first candidate
+// whose guard passes fires. Use makeStateTable() below.
+template <size_t NumStates, size_t NumEvents, typename StateT, typename EventT, typename Fn,
+          size_t NumTransitions, size_t NumHandlers>
+constexpr StateTable<StateT, EventT, NumStates, NumEvents, NumTransitions, Fn>
+buildStateTable(const Transition<StateT, EventT, Fn> (&transitions)[NumTransitions],
+                const StateHandlers<StateT, Fn> (&handlers)[NumHandlers], const StateParent<StateT> *parents,
+                size_t numParents) {
+  using Table = StateTable<StateT, EventT, NumStates, NumEvents, NumTransitions, Fn>;
+  Table t{};
+  bool isSuper[NumStates]{};
+  for (size_t s = 0; s < NumStates; ++s) {
+    t.handlers[s] = {static_cast<StateT>(s), nullptr, nullptr, nullptr, 0, 0};
+    t.parent[s] = Table::kNoParent;
+    for (size_t e = 0; e < NumEvents; ++e)
+      t.dispatch[s][e] = Table::kNoTransition;
+  }
+  for (size_t i = 0; i < numParents; ++i) {
+    size_t s = static_cast<size_t>(parents[i].state);
+    size_t p = static_cast<size_t>(parents[i].parent);
+    if (s >= NumStates || p >= NumStates || s == p || t.parent[s] != Table::kNoParent) {
+      stateTableError("bad or duplicate parent");
+      continue;
+    }
+    t.parent[s] = static_cast<uint8_t>(p);
+    isSuper[p] = true;
+  }
+  for (size_t s = 0; s < NumStates; ++s) {
+    size_t depth = 0;
+    for (size_t p = t.parent[s]; p != Table::kNoParent; p = t.parent[p]) {
+      if (++depth >= NumStates) {
+        stateTableError("cycle in state hierarchy");
+        break;
+      }
+    }
+  }
+  for (size_t i = 0; i < NumHandlers; ++i) {
+    size_t s = static_cast<size_t>(handlers[i].state);
+    if (s >= NumStates || t.handlers[s].entry || t.handlers[s].exit || t.handlers[s].run) {
+      stateTableError("bad or duplicate state handlers");
+      continue;
+    }
+    t.handlers[s] = handlers[i];
+  }
+  uint8_t tail[NumStates][NumEvents]{};  // last own candidate per (state, event)
+  for (size_t i = 0; i < NumTransitions; ++i) {
+    size_t s = static_cast<size_t>(transitions[i].from);
+    size_t to = static_cast<size_t>(transitions[i].to);
+    size_t e = eventIndex(transitions[i].event);
+    t.transitions[i] = transitions[i];
+    t.next[i] = Table::kNoTransition;
+    if (s >= NumStates || to >= NumStates || e >= NumEvents) {
+      stateTableError("transition out of range");
+      continue;
+    }
+    if (isSuper[to]) {
+      stateTableError("transition targets a super-state");
+      continue;
+    }
+    if (t.dispatch[s][e] == Table::kNoTransition)
+      t.dispatch[s][e] = static_cast<uint8_t>(i);
+    else
+      t.next[tail[s][e]] = static_cast<uint8_t>(i);
+    tail[s][e] = static_cast<uint8_t>(i);
+  }
+  // Resolve inheritance so dispatch stays a single lookup at run time, and
+  // chain each state's last own candidate to its nearest super-state's
+  // first. Walk the original rows (own) so the result does not depend on
+  // state order.
+  uint8_t own[NumStates][NumEvents]{};
+  for (size_t s = 0; s < NumStates; ++s)
+    for (size_t e = 0; e < NumEvents; ++e)
+      own[s][e] = t.dispatch[s][e];
+  for (size_t s = 0; s < NumStates; ++s) {
+    for (size_t e = 0; e < NumEvents; ++e) {
+      uint8_t inherited = Table::kNoTransition;
+      size_t depth = 0;
+      for (size_t p = t.parent[s]; inherited == Table::kNoTransition && p != Table::kNoParent &&
+                                   depth < NumStates;
+           p = t.parent[p], ++depth)
+        inherited = own[p][e];
+      if (own[s][e] == Table::kNoTransition)
+        t.dispatch[s][e] = inherited;
+      else
+        t.next[tail[s][e]] = inherited;
+    }
+  }
+  return t;
+}
+
+// Hierarchical table: `parents` lists the super-state of every nested state.
+template <size_t NumStates, size_t NumEvents, typename StateT, typename EventT, typename Fn,
+          size_t NumTransitions, size_t NumHandlers, size_t NumParents>
+constexpr StateTable<StateT, EventT, NumStates, NumEvents, NumTransitions, Fn>
+makeStateTable(const Transition<StateT, EventT, Fn> (&transitions)[NumTransitions],
+               const StateHandlers<StateT, Fn> (&handlers)[NumHandlers],
+               const StateParent<StateT> (&parents)[NumParents]) {
+  return buildStateTable<NumStates, NumEvents>(transitions, handlers, parents, NumParents);
+}
+
+// Flat table: every state is top-level.
+template <size_t NumStates, size_t NumEvents, typename StateT, typename EventT, typename Fn,
+          size_t NumTransitions, size_t NumHandlers>
+constexpr StateTable<StateT, EventT, NumStates, NumEvents, NumTransitions, Fn>
+makeStateTable(const Transition<StateT, EventT, Fn> (&transitions)[NumTransitions],
+               const StateHandlers<StateT, Fn> (&handlers)[NumHandlers]) {
+  return buildStateTable<NumStates, NumEvents>(transitions, handlers,
+                                               static_cast<const StateParent<StateT> *>(nullptr), 0);
+}
+
+// Table callbacks either take no arguments or the index of the instance they
+// run for.
+inline void invokeCallback(const ActionFn &fn, uint8_t /*index*/) {
+  fn();
+}
+inline void invokeCallback(const IndexedFn &fn, uint8_t index) {
+  fn(index);
+}
+inline bool invokeGuard(const Delegate<bool()> &guard, uint8_t /*index*/) {
+  return !guard || guard();
+}
+inline bool invokeGuard(const Delegate<bool(uint8_t)> &guard, uint8_t index) {
+  return !guard || guard(index);
+}
+
+// N state machines sharing one immutable StateTable. The table (and the
+// timeouts) are referenced once; each instance only keeps its current state,
+// timers and deferred-event queue, and table callbacks receive the instance
+// index (use IndexedFn tables) to find their per-instance data.
+//
+// Dispatch is a single array lookup, then a walk down the candidate chain
+// while guards reject; entry/exit walk the (short) super-state chain so
+// shared super-states are not exited and re-entered. Timers belong
+// to the state that armed them and are cancelled when that state is exited.
+// Building with FSM_STATS adds per-state dwell/entry counters and callback
+// timing (see StateMachineStats.h). Every fired transition is appended to
+// g_fsmTrace (its cycle count covers guards, exits, action and entries)
+// unless FSM_TRACE_DEPTH is 0.
+//
+// Periodic run handlers (runPeriodMs > 0) are skipped until due; instances
+// are staggered evenly across the period so a bank's instances do not run in
+// the same call, and nextDeadline() reports the next due one. StateT::Count
+// must cover every table state.
+//
+// Run-to-completion: an event raised while an instance is inside one of its
+// own callbacks is queued (up to MaxDeferred) and handled after the current
+// step finishes, so callbacks never nest and always see a settled state.
+template <typename StateT, typename EventT, size_t N, typename Fn = IndexedFn, size_t MaxTimers = 4,
+          size_t MaxDeferred = 4>
+class StateMachineBank {
+  static_assert(N > 0 && N <= 0xFF, "instance index must fit a uint8_t");
+  static_assert(MaxDeferred > 0 && MaxDeferred < 0xFF, "MaxDeferred must fit a uint8_t");
+
 public:
-  StateMachine(StateT init) : _current(init) {}
+  // Every instance starts in `init`; instance i tags its g_fsmTrace records
+  // with traceBase + i.
+  explicit StateMachineBank(StateT init, uint8_t traceBase = 0) : _traceBase(traceBase) {
+    for (auto &m : _inst)
+      m.current = init;
+  }
 
-  // Register a transition
-  void addTransition(const Transition<StateT, EventT> &t) {
-    _transitions.push_back(t);
+  static constexpr size_t size() {
+    return N;
   }
 
-  // Register onEntry/onExit for a state
-  void setEntry(StateT s, ActionFn fn) {
-    _entryMap[s] = fn;
+  // Bind the (usually constexpr) table. The table must outlive the bank.
+  template <size_t NumStates, size_t NumEvents, size_t NumTransitions>
+  void setTable(const StateTable<StateT, EventT, NumStates, NumEvents, NumTransitions, Fn> &table) {
+    _transitions = table.transitions;
+    _handlers = table.handlers;
+    _dispatch = &table.dispatch[0][0];
+    _next = table.next;
+    _parent = table.parent;
+    _numStates = NumStates;
+    _numEvents = NumEvents;
+    static_assert(NumStates <= kStates, "StateT::Count must cover every table state");
+    uint32_t now = FSM_MILLIS();
+    for (size_t i = 0; i < N; ++i)
+      for (size_t x = static_cast<size_t>(_inst[i].current); x < _numStates; x = _parent[x])
+        armRun(i, x, now);
+#ifdef FSM_STATS
+    for (size_t i = 0; i < N; ++i)
+      seedDwell(i);
+#endif
   }
-  void setExit(StateT s, ActionFn fn) {
-    _exitMap[s] = fn;
+
+  // Bind per-state timeouts, armed on every entry to their state. The array
+  // must outlive the bank.
+  template <size_t NumTimeouts> void setTimeouts(const StateTimeout<StateT, EventT> (&timeouts)[NumTimeouts]) {
+    _timeouts = timeouts;
+    _numTimeouts = NumTimeouts;
   }
 
-  // Handle an incoming event. Returns true if a transition fired.
-  // Uses map::find() to avoid mutating the maps during dispatch and
-  // a tiny last-match cache to speed up repeated identical dispatches.
-  bool handleEvent(EventT ev) {
-    // Fast-path: if the last dispatched (state,event) is likely to
-    // occur again, use the cached transition index to avoid scanning.
-    if (_hasCache) {
-      if (_cacheState == _current && _cacheEvent == ev) {
-        if (_cacheIndex < _transitions.size()) {
-          const auto &t = _transitions[_cacheIndex];
-          if (t.from == _current && t.event == ev) {
-            auto exitIt = _exitMap.find(_current);
-            if (exitIt != _exitMap.end() && exitIt->second)
-              exitIt->second();
-            if (t.action)
-              t.action();
-            _current = t.to;
-            auto entryIt = _entryMap.find(_current);
-            if (entryIt != _entryMap.end() && entryIt->second)
-              entryIt->second();
-            FSM_DBG_PRINTLN("StateMachine: event consumed (cache)");
-            return true;
-          }
+  // Handle an incoming event on instance i. Returns true if a transition
+  // fired. Exits run innermost-first from the current state up to the least
+  // common ancestor with the target, entries outermost-first back down to the
+  // target. A transition targeting the current state exits and re-enters it.
+  // Called from the instance's own callbacks, the event is deferred until the
+  // current step completes and false is returned.
+  bool handleEvent(size_t i, EventT ev) {
+    if (_inst[i].busy) {
+      defer(i, ev);
+      return false;
+    }
+    bool fired = step(i, ev);
+    drainDeferred(i);
+    return fired;
+  }
+
+  // handleEvent() on every instance; returns the number that transitioned.
+  size_t broadcast(EventT ev) {
+    size_t fired = 0;
+    for (size_t i = 0; i < N; ++i)
+      fired += handleEvent(i, ev);
+    return fired;
+  }
+
+  // Queue `ev` for instance i without handling it now, e.g. from another
+  // machine's callback. It is handled by the instance's next handleEvent(),
+  // run() or processDeferred(). Returns false (and counts an overflow) if the
+  // queue is full.
+  bool post(size_t i, EventT ev) {
+    return defer(i, ev);
+  }
+
+  // Handle queued events on every idle instance. Returns the number handled.
+  size_t processDeferred() {
+    size_t n = 0;
+    for (size_t i = 0; i < N; ++i)
+      if (!_inst[i].busy)
+        n += drainDeferred(i);
+    return n;
+  }
+
+  size_t deferredPending(size_t i) const {
+    return _inst[i].deferCount;
+  }
+  // Events dropped because the deferred queue was full
+  uint32_t deferredOverflow(size_t i) const {
+    return _inst[i].deferOverflow;
+  }
+  // Deepest the deferred queue has been
+  uint8_t deferredHighWater(size_t i) const {
+    return _inst[i].deferHighWater;
+  }
+
+  // Run the active logic for instance i's current state, then for each
+  // super-state, skipping periodic handlers that are not due. Events raised
+  // by the run handlers are handled once they all returned.
+  void run(size_t i) {
+    Instance &m = _inst[i];
+    if (!_handlers || m.busy)
+      return;
+    m.busy = true;
+    uint32_t now = FSM_MILLIS();
+    for (size_t x = static_cast<size_t>(m.current); x < _numStates; x = _parent[x])
+      if (runDue(i, x, now))
+        doRun(i, x);
+    m.busy = false;
+    drainDeferred(i);
+  }
+
+  StateT getState(size_t i) const {
+    return _inst[i].current;
+  }
+
+  // Dispatch `ev` to instance i `ms` from now, unless its current state is
+  // exited first. Call from entry/run handlers (a transition action still
+  // runs in the old state). Returns false if all timers are in use.
+  bool after(size_t i, uint32_t ms, EventT ev) {
+    return _inst[i].timers.start(FSM_MILLIS(), ms, ev, static_cast<uint8_t>(_inst[i].current));
+  }
+
+  // Cancel instance i's pending `ev` timers armed in its current state.
+  void cancel(size_t i, EventT ev) {
+    _inst[i].timers.cancel(static_cast<uint8_t>(_inst[i].current), ev);
+  }
+
+  // Dispatch every due timer event on every instance. Returns the number fired.
+  size_t pollTimers() {
+    uint32_t now = FSM_MILLIS();
+    size_t fired = 0;
+    for (size_t i = 0; i < N; ++i)
+      fired += _inst[i].timers.poll(now, [this, i](EventT ev, uint8_t) { handleEvent(i, ev); });
+    return fired;
+  }
+
+  // Milliseconds until the next timer or periodic run handler of any instance
+  // is due; false if there is neither. Unthrottled run handlers do not count,
+  // so a caller polling run() keeps its own cadence for those.
+  bool nextDeadline(uint32_t &msOut) const {
+    uint32_t now = FSM_MILLIS();
+    bool any = false;
+    for (const auto &m : _inst) {
+      uint32_t due;
+      if (m.timers.nextDeadline(now, due) && (!any || due < msOut)) {
+        msOut = due;
+        any = true;
+      }
+      for (size_t x = static_cast<size_t>(m.current); _handlers && x < _numStates; x = _parent[x]) {
+        if (!_handlers[x].run || !_handlers[x].runPeriodMs)
+          continue;
+        due = (int32_t)(m.runDueMs[x] - now) > 0 ? m.runDueMs[x] - now : 0;
+        if (!any || due < msOut) {
+          msOut = due;
+          any = true;
         }
-        // fall through to full scan on cache miss/inconsistency
       }
     }
+    return any;
+  }
 
-    for (size_t i = 0; i < _transitions.size(); ++i) {
-      const auto &t = _transitions[i];
-      if (t.from != _current || t.event != ev)
-        continue;
+  // True if instance i's current state is `s` or nested (at any depth) in it.
+  bool isIn(size_t i, StateT s) const {
+    return _parent && within(static_cast<size_t>(_inst[i].current), static_cast<size_t>(s));
+  }
 
-      // call exit if present (use find() to avoid mutating the map)
-      auto exitIt = _exitMap.find(_current);
-      if (exitIt != _exitMap.end() && exitIt->second)
-        exitIt->second();
+#ifdef FSM_STATS
+  const StateStats &stateStats(size_t i, StateT s) const {
+    return _inst[i].stats.states[static_cast<size_t>(s)];
+  }
+  // Fire count of the transition at `index` in the table's transition list
+  uint32_t transitionFires(size_t i, size_t index) const {
+    return index < FSM_STATS_MAX_TRANSITIONS ? _inst[i].stats.transitionFires[index] : 0;
+  }
+  const CallbackStats &actionStats(size_t i) const {
+    return _inst[i].stats.action;
+  }
+  // Candidate transitions skipped because their guard returned false
+  uint32_t guardRejects(size_t i) const {
+    return _inst[i].stats.guardRejects;
+  }
+  // Clear every counter; dwell of the active states restarts now.
+  void resetStats() {
+    for (size_t i = 0; i < N; ++i) {
+      _inst[i].stats = {};
+      seedDwell(i);
+    }
+  }
+#endif
+
+private:
+  static constexpr uint8_t kNoTransition = 0xFF;
+  static constexpr size_t kNoParent = 0xFF;
+  static constexpr size_t kDrainLimit = 4 * MaxDeferred;
+  static constexpr size_t kStates = static_cast<size_t>(StateT::Count);
+
+  // Everything one instance owns; the table lives in the bank.
+  struct Instance {
+    StateT current{};
+    bool busy = false;
+    uint8_t deferHead = 0;
+    uint8_t deferCount = 0;
+    uint8_t deferHighWater = 0;
+    uint32_t deferOverflow = 0;
+    EventT deferred[MaxDeferred]{};
+    TimerWheel<EventT, MaxTimers> timers;
+    uint32_t runDueMs[kStates]{};  // next run of each active periodic state
+#ifdef FSM_STATS
+    StateMachineStats<kStates> stats{};
+#endif
+  };
+
+  static void call(const Fn &fn, size_t i) {
+    if (fn)
+      invokeCallback(fn, static_cast<uint8_t>(i));
+  }
 
-      if (t.action)
-        t.action();
+#ifdef FSM_STATS
+  static void call(const Fn &fn, size_t i, CallbackStats &cs) {
+    if (!fn)
+      return;
+    uint32_t t0 = FSM_CYCLES();
+    invokeCallback(fn, static_cast<uint8_t>(i));
+    cs.record(FSM_CYCLES() - t0);
+  }
 
-      _current = t.to;
+  void seedDwell(size_t i) {
+    uint32_t now = FSM_MILLIS();
+    for (size_t x = static_cast<size_t>(_inst[i].current); x < _numStates; x = _parent[x])
+      _inst[i].stats.enteredMs[x] = now;
+  }
+#endif
 
-      auto entryIt = _entryMap.find(_current);
-      if (entryIt != _entryMap.end() && entryIt->second)
-        entryIt->second();
+  // One transition, without draining the deferred queue
+  bool step(size_t i, EventT ev) {
+    Instance &m = _inst[i];
+    size_t s = static_cast<size_t>(m.current);
+    size_t e = eventIndex(ev);
+    if (!_dispatch || s >= _numStates || e >= _numEvents)
+      return false;
+#if FSM_TRACE_DEPTH > 0
+    uint32_t t0 = FSM_CYCLES();
+#endif
+    // Guards run with busy set, so an event they raise is deferred too
+    m.busy = true;
+    uint8_t ti = _dispatch[s * _numEvents + e];
+    while (ti != kNoTransition && !invokeGuard(_transitions[ti].guard, static_cast<uint8_t>(i))) {
+#ifdef FSM_STATS
+      ++m.stats.guardRejects;
+#endif
+      ti = _next[ti];
+    }
+    if (ti == kNoTransition) {
+      m.busy = false;
+      return false;
+    }
 
-      FSM_DBG_PRINTLN("StateMachine: event consumed");
+    const auto &t = _transitions[ti];
+    size_t to = static_cast<size_t>(t.to);
+    size_t lca = commonAncestor(s, to);
+    for (size_t x = s; x != lca; x = _parent[x]) {
+      doExit(i, x);
+      m.timers.cancelTag(static_cast<uint8_t>(x));
+    }
+    doAction(i, ti);
+    m.current = t.to;
+    enter(i, lca, to);
 
-      // update small cache for likely repeated transitions
-      _hasCache = true;
-      _cacheState = t.from;
-      _cacheEvent = t.event;
-      _cacheIndex = i;
+#if FSM_TRACE_DEPTH > 0
+    g_fsmTrace.record(static_cast<uint8_t>(_traceBase + i), static_cast<uint8_t>(s), static_cast<uint8_t>(e),
+                      static_cast<uint8_t>(to), FSM_MILLIS(), FSM_CYCLES() - t0);
+#endif
+    m.busy = false;
+    return true;
+  }
 
-      return true;
+  bool defer(size_t i, EventT ev) {
+    Instance &m = _inst[i];
+    if (m.deferCount == MaxDeferred) {
+      ++m.deferOverflow;
+      return false;
     }
+    m.deferred[(m.deferHead + m.deferCount) % MaxDeferred] = ev;
+    if (++m.deferCount > m.deferHighWater)
+      m.deferHighWater = m.deferCount;
+    return true;
+  }
+
+  // FIFO; events raised while draining are appended and handled in the same
+  // pass, up to a bound so two events that keep re-raising each other cannot
+  // spin forever (the rest wait for the next call).
+  size_t drainDeferred(size_t i) {
+    Instance &m = _inst[i];
+    size_t n = 0;
+    while (m.deferCount && n < kDrainLimit) {
+      EventT ev = m.deferred[m.deferHead];
+      m.deferHead = static_cast<uint8_t>((m.deferHead + 1) % MaxDeferred);
+      --m.deferCount;
+      step(i, ev);
+      ++n;
+    }
+    return n;
+  }
+
+  void doEntry(size_t i, size_t x) {
+#ifdef FSM_STATS
+    _inst[i].stats.onEnter(x, FSM_MILLIS());
+    call(_handlers[x].entry, i, _inst[i].stats.states[x].entry);
+#else
+    call(_handlers[x].entry, i);
+#endif
+  }
+
+  void doExit(size_t i, size_t x) {
+#ifdef FSM_STATS
+    call(_handlers[x].exit, i, _inst[i].stats.states[x].exit);
+    _inst[i].stats.onExit(x, FSM_MILLIS());
+#else
+    call(_handlers[x].exit, i);
+#endif
+  }
+
+  // Schedule state x's first run at or after `now` on its grid, shifted by
+  // 1/N of the period per instance index.
+  void armRun(size_t i, size_t x, uint32_t now) {
+    uint32_t period = _handlers ? _handlers[x].runPeriodMs : 0;
+    if (!period)
+      return;
+    uint32_t phase = _handlers[x].runOffsetMs + static_cast<uint32_t>(period * i / N);
+    uint32_t late = (now - phase) % period;
+    _inst[i].runDueMs[x] = late ? now + (period - late) : now;
+  }
+
+  // True if state x's run handler should be called now; advances its due
+  // time. A handler that fell behind skips the missed slots instead of
+  // running back to back.
+  bool runDue(size_t i, size_t x, uint32_t now) {
+    uint32_t period = _handlers[x].runPeriodMs;
+    if (!period)
+      return true;
+    uint32_t &due = _inst[i].runDueMs[x];
+    if ((int32_t)(now - due) < 0)
+      return false;
+    due += period;
+    if ((int32_t)(now - due) >= 0)
+      due += ((now - due) / period + 1) * period;
+    return true;
+  }
+
+  void doRun(size_t i, size_t x) {
+#ifdef FSM_STATS
+    call(_handlers[x].run, i, _inst[i].stats.states[x].run);
+#else
+    call(_handlers[x].run, i);
+#endif
+  }
+
+  void doAction(size_t i, size_t ti) {
+#ifdef FSM_STATS
+    _inst[i].stats.onFire(ti);
+    call(_transitions[ti].action, i, _inst[i].stats.action);
+#else
+    call(_transitions[ti].action, i);
+#endif
+  }
+
+  bool within(size_t x, size_t ancestor) const {
+    for (; x != kNoParent; x = _parent[x])
+      if (x == ancestor)
+        return true;
     return false;
   }
 
-  // Run the active logic for the current state (use find() to avoid accidental map insertion)
-  void run() {
-    auto it = _runMap.find(_current);
-    if (it != _runMap.end() && it->second)
-      it->second();
+  // Deepest proper ancestor of `to` that also contains `from`.
+  size_t commonAncestor(size_t from, size_t to) const {
+    for (size_t p = _parent[to]; p != kNoParent; p = _parent[p])
+      if (within(from, p))
+        return p;
+    return kNoParent;
+  }
+
+  void enter(size_t i, size_t lca, size_t x) {
+    if (x == lca)
+      return;
+    enter(i, lca, _parent[x]);
+    doEntry(i, x);
+    armRun(i, x, FSM_MILLIS());
+    for (size_t k = 0; k < _numTimeouts; ++k)
+      if (static_cast<size_t>(_timeouts[k].state) == x)
+        _inst[i].timers.start(FSM_MILLIS(), _timeouts[k].ms, _timeouts[k].event, static_cast<uint8_t>(x));
+  }
+
+  const Transition<StateT, EventT, Fn> *_transitions = nullptr;
+  const StateHandlers<StateT, Fn> *_handlers = nullptr;
+  const uint8_t *_dispatch = nullptr;
+  const uint8_t *_next = nullptr;
+  const uint8_t *_parent = nullptr;
+  size_t _numStates = 0;
+  size_t _numEvents = 0;
+  const StateTimeout<StateT, EventT> *_timeouts = nullptr;
+  size_t _numTimeouts = 0;
+  uint8_t _traceBase;
+  Instance _inst[N];
+};
+
+// A single state machine with a plain (ActionFn) table: a one-instance
+// StateMachineBank without the index arguments.
+template <typename StateT, typename EventT, size_t MaxTimers = 4, size_t MaxDeferred = 4>
+class StateMachine {
+public:
+  // traceId tags this machine's records in g_fsmTrace
+  explicit StateMachine(StateT init, uint8_t traceId = 0) : _bank(init, traceId) {}
+
+  template <size_t NumStates, size_t NumEvents, size_t NumTransitions>
+  void setTable(const StateTable<StateT, EventT, NumStates, NumEvents, NumTransitions> &table) {
+    _bank.setTable(table);
+  }
+  template <size_t N> void setTimeouts(const StateTimeout<StateT, EventT> (&timeouts)[N]) {
+    _bank.setTimeouts(timeouts);
   }
 
+  bool handleEvent(EventT ev) {
+    return _bank.handleEvent(0, ev);
+  }
+  bool post(EventT ev) {
+    return _bank.post(0, ev);
+  }
+  size_t processDeferred() {
+    return _bank.processDeferred();
+  }
+  size_t deferredPending() const {
+    return _bank.deferredPending(0);
+  }
+  uint32_t deferredOverflow() const {
+    return _bank.deferredOverflow(0);
+  }
+  uint8_t deferredHighWater() const {
+    return _bank.deferredHighWater(0);
+  }
+  void run() {
+    _bank.run(0);
+  }
   StateT getState() const {
-    return _current;
+    return _bank.getState(0);
+  }
+  bool after(uint32_t ms, EventT ev) {
+    return _bank.after(0, ms, ev);
+  }
+  void cancel(EventT ev) {
+    _bank.cancel(0, ev);
+  }
+  size_t pollTimers() {
+    return _bank.pollTimers();
+  }
+  bool nextDeadline(uint32_t &msOut) const {
+    return _bank.nextDeadline(msOut);
+  }
+  bool isIn(StateT s) const {
+    return _bank.isIn(0, s);
   }
 
-  void setRun(StateT s, ActionFn fn) {
-    _runMap[s] = fn;
+#ifdef FSM_STATS
+  const StateStats &stateStats(StateT s) const {
+    return _bank.stateStats(0, s);
+  }
+  uint32_t transitionFires(size_t index) const {
+    return _bank.transitionFires(0, index);
+  }
+  const CallbackStats &actionStats() const {
+    return _bank.actionStats(0);
   }
+  uint32_t guardRejects() const {
+    return _bank.guardRejects(0);
+  }
+  void resetStats() {
+    _bank.resetStats();
+  }
+#endif
 
 private:
-  StateT _current;
-  std::vector<Transition<StateT, EventT>> _transitions;
-  std::map<StateT, ActionFn> _entryMap;
-  std::map<StateT, ActionFn> _exitMap;
-  std::map<StateT, ActionFn> _runMap;
-  // Small cache to speed up repeated identical (state,event) dispatches
-  bool _hasCache = false;
-  StateT _cacheState{};
-  EventT _cacheEvent{};
-  size_t _cacheIndex = 0;
-};
\ No newline at end of file
+  StateMachineBank<StateT, EventT, 1, ActionFn, MaxTimers, MaxDeferred> _bank;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+// Optional StateMachine instrumentation, enabled with -DFSM_STATS. With the
+// flag unset nothing here is instantiated and StateMachine carries no extra
+// state or timing calls.
+
+// system includes
+#include <stddef.h>
+#include <stdint.h>
+
+// Cycle counter used to time callbacks; override for host builds.
+#ifndef FSM_CYCLES
+#include <Arduino.h>
+#define FSM_CYCLES() ESP.getCycleCount()
+#endif
+
+// Transitions beyond this index are not counted
+#ifndef FSM_STATS_MAX_TRANSITIONS
+#define FSM_STATS_MAX_TRANSITIONS 32
+#endif
+
+// Histogram bucket 0 holds calls under 2^(SHIFT+1) cycles; bucket b > 0 holds
+// [2^(b+SHIFT), 2^(b+SHIFT+1)); the last bucket is open-ended. At 240 MHz
+// that spans ~2 us to ~35 ms.
+constexpr size_t FSM_STATS_HIST_BUCKETS = 16;
+constexpr uint8_t FSM_STATS_HIST_SHIFT = 8;
+
+// Execution time of one kind of callback
+struct CallbackStats {
+  uint32_t calls;
+  uint32_t maxCycles;
+  uint64_t totalCycles;
+  uint16_t hist[FSM_STATS_HIST_BUCKETS];  // saturating counts
+
+  void record(uint32_t cycles) {
+    ++calls;
+    totalCycles += cycles;
+    if (cycles > maxCycles)
+      maxCycles = cycles;
+    size_t b = 0;
+    if (cycles >> (FSM_STATS_HIST_SHIFT + 1)) {
+      b = 31 - __builtin_clz(cycles) - FSM_STATS_HIST_SHIFT;
+      if (b >= FSM_STATS_HIST_BUCKETS)
+        b = FSM_STATS_HIST_BUCKETS - 1;
+    }
+    if (hist[b] != UINT16_MAX)
+      ++hist[b];
+  }
+};
+
+// Per-state counters. Dwell covers completed visits only.
+struct StateStats {
+  uint32_t entries;
+  uint32_t dwellTotalMs;
+  uint32_t dwellMaxMs;
+  CallbackStats entry;
+  CallbackStats exit;
+  CallbackStats run;
+};
+
+template <size_t NumStates> struct StateMachineStats {
+  StateStats states[NumStates];
+  uint32_t transitionFires[FSM_STATS_MAX_TRANSITIONS];
+  uint32_t guardRejects;
+  CallbackStats action;
+  uint32_t enteredMs[NumStates];  // entry time of each currently active state
+
+  void onEnter(size_t s, uint32_t nowMs) {
+    ++states[s].entries;
+    enteredMs[s] = nowMs;
+  }
+
+  void onExit(size_t s, uint32_t nowMs) {
+    uint32_t dwell = nowMs - enteredMs[s];
+    states[s].dwellTotalMs += dwell;
+    if (dwell > states[s].dwellMaxMs)
+      states[s].dwellMaxMs = dwell;
+  }
+
+  void onFire(size_t transition) {
+    if (transition < FSM_STATS_MAX_TRANSITIONS)
+      ++transitionFires[transition];
+  }
+};
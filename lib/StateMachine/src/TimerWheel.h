@@ -0,0 +1,164 @@
+#pragma once
+
+// system includes
+#include <stddef.h>
+#include <stdint.h>
+
+// Small hashed timer wheel with a fixed pool of one-shot timers. Each timer
+// hangs off the slot for its deadline tick, so poll() only visits the slots
+// for ticks that elapsed since the previous poll instead of every timer.
+// Deadlines are compared wrap-safely, so millis() rollover is harmless.
+// Not thread-safe: owned by the task that polls it.
+template <typename EventT, size_t Capacity, size_t NumSlots = 8, uint32_t TickMs = 100>
+class TimerWheel {
+  static_assert(Capacity > 0 && Capacity <= 32, "Capacity must fit the 32-bit active mask");
+  static_assert(NumSlots > 0 && NumSlots < 0xFF, "NumSlots must fit a uint8_t");
+
+public:
+  TimerWheel() {
+    for (auto &head : _slots)
+      head = kNil;
+  }
+
+  // Arm a timer that fires `ev` once `delayMs` after `now`. `tag` groups
+  // timers for cancelTag(). Returns false if every timer is in use.
+  bool start(uint32_t now, uint32_t delayMs, EventT ev, uint8_t tag) {
+    uint32_t freeMask = ~_activeMask & kAllMask;
+    if (!freeMask)
+      return false;
+    if (!_activeMask)
+      _nextTick = now / TickMs;
+    uint8_t i = static_cast<uint8_t>(__builtin_ctz(freeMask));
+    Entry &e = _entries[i];
+    e.deadline = now + delayMs;
+    e.event = ev;
+    e.tag = tag;
+    ++e.gen;
+    uint8_t &head = _slots[slotOf(e.deadline)];
+    e.next = head;
+    head = i;
+    _activeMask |= 1u << i;
+    return true;
+  }
+
+  // Cancel every timer with `tag`.
+  void cancelTag(uint8_t tag) {
+    for (uint32_t m = _activeMask; m; m &= m - 1) {
+      uint8_t i = static_cast<uint8_t>(__builtin_ctz(m));
+      if (_entries[i].tag == tag)
+        remove(i);
+    }
+  }
+
+  // Cancel timers with `tag` that would fire `ev`.
+  void cancel(uint8_t tag, EventT ev) {
+    for (uint32_t m = _activeMask; m; m &= m - 1) {
+      uint8_t i = static_cast<uint8_t>(__builtin_ctz(m));
+      if (_entries[i].tag == tag && _entries[i].event == ev)
+        remove(i);
+    }
+  }
+
+  // Fire every timer due at `now` through fire(event, tag), earliest first.
+  // fire() may start or cancel timers; a timer cancelled by an earlier fire
+  // in the same poll does not fire. Returns the number fired.
+  template <typename F> size_t poll(uint32_t now, F &&fire) {
+    uint32_t nowTick = now / TickMs;
+    if (!_activeMask) {
+      _nextTick = nowTick;
+      return 0;
+    }
+    // Visit the slots for [_nextTick, nowTick]; the current tick's slot is
+    // visited again next time since later timers in it are not yet due.
+    uint32_t span = nowTick - _nextTick;
+    size_t visits = span >= NumSlots ? NumSlots : span + 1;
+    uint8_t due[Capacity];
+    uint16_t dueGen[Capacity];
+    size_t n = 0;
+    for (size_t v = 0; v < visits; ++v) {
+      for (uint8_t i = _slots[(_nextTick + v) % NumSlots]; i != kNil; i = _entries[i].next) {
+        if (!isDue(_entries[i].deadline, now))
+          continue;
+        // Insertion sort keeps simultaneous expiries in deadline order
+        size_t k = n++;
+        for (; k > 0 && isBefore(_entries[i].deadline, _entries[due[k - 1]].deadline); --k) {
+          due[k] = due[k - 1];
+          dueGen[k] = dueGen[k - 1];
+        }
+        due[k] = i;
+        dueGen[k] = _entries[i].gen;
+      }
+    }
+    _nextTick = nowTick;
+
+    size_t fired = 0;
+    for (size_t k = 0; k < n; ++k) {
+      uint8_t i = due[k];
+      if (!(_activeMask & (1u << i)) || _entries[i].gen != dueGen[k])
+        continue;  // cancelled (or re-armed) by an earlier fire
+      EventT ev = _entries[i].event;
+      uint8_t tag = _entries[i].tag;
+      remove(i);
+      fire(ev, tag);
+      ++fired;
+    }
+    return fired;
+  }
+
+  // Milliseconds from `now` until the earliest timer (0 if already due).
+  // Returns false when no timer is armed.
+  bool nextDeadline(uint32_t now, uint32_t &msOut) const {
+    if (!_activeMask)
+      return false;
+    uint32_t best = UINT32_MAX;
+    for (uint32_t m = _activeMask; m; m &= m - 1) {
+      const Entry &e = _entries[__builtin_ctz(m)];
+      uint32_t left = isDue(e.deadline, now) ? 0 : e.deadline - now;
+      if (left < best)
+        best = left;
+    }
+    msOut = best;
+    return true;
+  }
+
+  bool empty() const {
+    return _activeMask == 0;
+  }
+
+private:
+  static constexpr uint8_t kNil = 0xFF;
+  static constexpr uint32_t kAllMask = Capacity == 32 ? 0xFFFFFFFFu : ((1u << Capacity) - 1);
+
+  struct Entry {
+    uint32_t deadline = 0;
+    EventT event{};
+    uint16_t gen = 0;
+    uint8_t tag = 0;
+    uint8_t next = kNil;
+  };
+
+  static size_t slotOf(uint32_t deadline) {
+    return (deadline / TickMs) % NumSlots;
+  }
+  static bool isDue(uint32_t deadline, uint32_t now) {
+    return static_cast<int32_t>(now - deadline) >= 0;
+  }
+  static bool isBefore(uint32_t a, uint32_t b) {
+    return static_cast<int32_t>(a - b) < 0;
+  }
+
+  void remove(uint8_t i) {
+    uint8_t *link = &_slots[slotOf(_entries[i].deadline)];
+    while (*link != kNil && *link != i)
+      link = &_entries[*link].next;
+    if (*link == i)
+      *link = _entries[i].next;
+    _entries[i].next = kNil;
+    _activeMask &= ~(1u << i);
+  }
+
+  Entry _entries[Capacity];
+  uint8_t _slots[NumSlots];
+  uint32_t _activeMask = 0;
+  uint32_t _nextTick = 0;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+// system includes
+#include <stddef.h>
+#include <stdint.h>
+
+// Cycle counter used to time transitions; override for host builds.
+#ifndef FSM_CYCLES
+#include <Arduino.h>
+#define FSM_CYCLES() ESP.getCycleCount()
+#endif
+
+// Number of transitions kept. 0 compiles tracing out of StateMachine.
+#ifndef FSM_TRACE_DEPTH
+#define FSM_TRACE_DEPTH 256
+#endif
+
+// One fired transition (12 bytes)
+struct TraceRecord {
+  uint32_t ms;      // FSM_MILLIS() when the transition fired
+  uint32_t cycles;  // exit + action + entry time in CPU cycles
+  uint8_t machine;  // StateMachine trace id
+  uint8_t from;     // state index
+  uint8_t event;    // event bit index (see eventIndex())
+  uint8_t to;       // state index
+};
+
+// Single-writer ring of the most recent transitions. The writer (the task
+// that runs the state machines) does a handful of stores per record;
+// snapshot() can run from any other task and drops records that were
+// overwritten while it copied. The global instance lives in .noinit RAM so
+// the previous boot's history survives a panic or watchdog reset.
+class TransitionTrace {
+public:
+  static constexpr size_t kDepth = FSM_TRACE_DEPTH > 0 ? FSM_TRACE_DEPTH : 1;
+
+  void record(uint8_t machine, uint8_t from, uint8_t event, uint8_t to, uint32_t ms,
+              uint32_t cycles) {
+    uint32_t seq = _head;
+    TraceRecord &r = _ring[seq % kDepth];
+    r.ms = ms;
+    r.cycles = cycles;
+    r.machine = machine;
+    r.from = from;
+    r.event = event;
+    r.to = to;
+    __atomic_store_n(&_head, seq + 1, __ATOMIC_RELEASE);
+  }
+
+  // Copy up to maxOut of the newest records into out, oldest first.
+  // Returns the number copied.
+  size_t snapshot(TraceRecord *out, size_t maxOut) const;
+
+  // Total records written since the ring was last cleared.
+  uint32_t total() const {
+    return __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+  }
+
+  // Keep the contents if they carry a valid marker (warm reset), otherwise
+  // clear. Returns true if history from before the reset was kept.
+  bool begin();
+  void clear();
+
+private:
+  uint32_t _magic;
+  uint32_t _head;
+  TraceRecord _ring[kDepth];
+};
+
+// Shared by every StateMachine (records carry the machine id)
+extern TransitionTrace g_fsmTrace;
+
+// Print the newest `count` records to Serial, oldest first.
+void fsmTraceDump(size_t count = TransitionTrace::kDepth);
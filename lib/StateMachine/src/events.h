@@ -17,13 +17,16 @@ enum class Event : uint32_t {
   ChargeDetected = 1 << 8,
   SensorTimeout = 1 << 9,
   SubFSMDone = 1 << 10,
-  Shoe0InitWet = 1 << 11,
-  Shoe0InitDry = 1 << 12,
-  Shoe1InitWet = 1 << 13,
-  Shoe1InitDry = 1 << 14,
-  UVTimer0 = 1 << 15,
-  UVTimer1 = 1 << 16,
-  DryCheckFailed = 1 << 17
+  // Initial wetness of one shoe; posted to that shoe's sub-FSM
+  InitWet = 1 << 11,
+  InitDry = 1 << 12,
+  UVTimer0 = 1 << 13,
+  UVTimer1 = 1 << 14,
+  DryCheckFailed = 1 << 15,
+  // Boot after a crash: continue the checkpointed cycle (global, then each sub)
+  Resume = 1 << 16,
+  // Start held down: step to the next drying recipe (Checking)
+  RecipeNext = 1 << 17
 };
 
 // Global FSM states
@@ -36,11 +39,37 @@ enum class GlobalState : uint8_t {
   LowBattery,
   Error,
   Debug,
+  // Super-states (never current): Root holds the catch-all Reset/Error
+  // transitions, Session covers Detecting/Checking/Running for BatteryLow.
+  Root,
+  Session,
   Count
 };
 
 // Sub-FSM states
-enum class SubState : uint8_t { S_IDLE, S_WAITING, S_WET, S_COOLING, S_DRY, S_DONE };
+// S_ROOT and S_FINISHING are super-states (never current): S_ROOT holds the
+// catch-all Reset, S_FINISHING groups S_COOLING/S_DRY for DryCheckFailed.
+enum class SubState : uint8_t {
+  S_IDLE,
+  S_WAITING,
+  S_WET,
+  S_COOLING,
+  S_DRY,
+  S_DONE,
+  S_ROOT,
+  S_FINISHING,
+  Count
+};
+
+// Payload of a shoe-addressed SubStart: why the shoe is being advanced
+enum class AdvanceReason : uint32_t {
+  None = 0,
+  DryThreshold,   // motor task saw the AH diff drop below the dry threshold
+  SafetyTimeout,  // motor task hit MOTOR_SAFETY_MS
+};
 
 constexpr uint8_t NUM_GLOBAL_STATES = static_cast<uint8_t>(GlobalState::Count);
+constexpr uint8_t NUM_SUB_STATES = static_cast<uint8_t>(SubState::Count);
+// Dispatch-table columns: one per Event bit position (highest is RecipeNext = bit 17)
+constexpr uint8_t NUM_EVENT_BITS = 18;
 constexpr uint32_t ALL_STATE_BITS = (1UL << NUM_GLOBAL_STATES) - 1;
\ No newline at end of file
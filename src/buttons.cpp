@@ -0,0 +1,73 @@
+// buttons.cpp - Interrupt-driven button input
+#include "buttons.h"
+#include "config.h"
+#include "tskFSM.h"
+#include <Arduino.h>
+#include <Debounce.h>
+#include <esp_timer.h>
+
+// Active-low button and the events it raises (Event::None = no long-press
+// action). A button whose long press must not also press posts the press on
+// release instead, once it is known to be short.
+struct ButtonDef {
+  int pin;
+  Event press;
+  Event longPress;
+  uint32_t longMs;
+  bool pressOnRelease;
+};
+
+static constexpr ButtonDef BUTTONS[] = {
+    {HW_START_PIN, Event::StartPressed, Event::RecipeNext, RECIPE_SELECT_HOLD_MS, true},
+    {HW_RESET_PIN, Event::ResetPressed, Event::Debug, BUTTON_LONG_PRESS_MS, false},
+};
+static constexpr size_t NUM_BUTTONS = sizeof(BUTTONS) / sizeof(BUTTONS[0]);
+
+static Debouncer s_debounce[NUM_BUTTONS];
+// One-shot per pin, restarted by every edge: it fires once the line has been
+// quiet for BUTTON_DEBOUNCE_MS
+static esp_timer_handle_t s_settleTimer[NUM_BUTTONS];
+
+static void IRAM_ATTR onButtonEdge(void *arg) {
+  size_t i = reinterpret_cast<size_t>(arg);
+  s_debounce[i].edge(millis());
+  esp_timer_stop(s_settleTimer[i]);  // not running is fine
+  esp_timer_start_once(s_settleTimer[i], BUTTON_DEBOUNCE_MS * 1000ull);
+}
+
+// esp_timer task: commit the settled level and post what it means
+static void onButtonSettled(void *arg) {
+  size_t i = reinterpret_cast<size_t>(arg);
+  const ButtonDef &b = BUTTONS[i];
+  uint32_t now = millis();
+  if (!s_debounce[i].due(now, BUTTON_DEBOUNCE_MS))
+    return;  // an edge restarted the window; its timer settles it
+  switch (s_debounce[i].settle(digitalRead(b.pin) == LOW, now, b.longMs)) {
+  case DebounceEdge::Press:
+    if (!b.pressOnRelease)
+      fsmExternalPost(b.press);
+    break;
+  case DebounceEdge::Release:
+    if (b.pressOnRelease)
+      fsmExternalPost(b.press);
+    break;
+  case DebounceEdge::LongRelease:
+    if (b.longPress != Event::None)
+      fsmExternalPost(b.longPress);
+    break;
+  case DebounceEdge::None:
+    break;
+  }
+}
+
+void buttonsInit() {
+  for (size_t i = 0; i < NUM_BUTTONS; ++i) {
+    esp_timer_create_args_t args = {};
+    args.callback = onButtonSettled;
+    args.arg = reinterpret_cast<void *>(i);
+    args.name = "btnSettle";
+    esp_timer_create(&args, &s_settleTimer[i]);
+    pinMode(BUTTONS[i].pin, INPUT_PULLUP);
+    attachInterruptArg(digitalPinToInterrupt(BUTTONS[i].pin), onButtonEdge, reinterpret_cast<void *>(i), CHANGE);
+  }
+}
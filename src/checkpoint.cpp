@@ -0,0 +1,82 @@
+// checkpoint.cpp - Cycle checkpoint storage (NVS via Preferences)
+#include "checkpoint.h"
+#include <Arduino.h>
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static const char *const NVS_NAMESPACE = "solecare";
+static const char *const NVS_KEY = "cycle";
+// Bump when CycleCheckpoint changes; an older record is then ignored
+static constexpr uint16_t CHECKPOINT_VERSION = 2;
+
+enum class CheckpointOp : uint8_t { None, Save, Clear };
+
+static TaskHandle_t s_writerTask = nullptr;
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static CheckpointOp s_op = CheckpointOp::None;
+static CycleCheckpoint s_pending;
+static uint16_t s_seq = 0;
+
+static void vCheckpointTask(void * /*pv*/) {
+  Preferences prefs;
+  prefs.begin(NVS_NAMESPACE, false);
+  CycleCheckpoint cp;
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    taskENTER_CRITICAL(&s_mux);
+    CheckpointOp op = s_op;
+    s_op = CheckpointOp::None;
+    if (op == CheckpointOp::Save)
+      cp = s_pending;
+    taskEXIT_CRITICAL(&s_mux);
+
+    if (op == CheckpointOp::Save)
+      prefs.putBytes(NVS_KEY, &cp, sizeof(cp));
+    else if (op == CheckpointOp::Clear && prefs.isKey(NVS_KEY))
+      prefs.remove(NVS_KEY);
+  }
+}
+
+// Hand one request to the writer; a pending one it has not taken is replaced
+static void submit(CheckpointOp op, const CycleCheckpoint *cp) {
+  taskENTER_CRITICAL(&s_mux);
+  s_op = op;
+  if (cp)
+    s_pending = *cp;
+  taskEXIT_CRITICAL(&s_mux);
+  if (s_writerTask)
+    xTaskNotifyGive(s_writerTask);
+}
+
+void checkpointInit() {
+  if (s_writerTask)
+    return;
+  // Core 0, at the UI and battery tasks' priority: the control tasks (FSM,
+  // motor, sensors, UV) all run on core 1, so a write never preempts them; a
+  // late write only loses a few seconds of progress
+  xTaskCreatePinnedToCore(vCheckpointTask, "Checkpoint", 3072, nullptr, 1, &s_writerTask, 0);
+}
+
+bool checkpointLoad(CycleCheckpoint &out) {
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, true))
+    return false;
+  bool ok = prefs.getBytesLength(NVS_KEY) == sizeof(out) &&
+            prefs.getBytes(NVS_KEY, &out, sizeof(out)) == sizeof(out) && out.version == CHECKPOINT_VERSION;
+  prefs.end();
+  if (ok)
+    s_seq = out.seq;
+  return ok;
+}
+
+void checkpointSave(const CycleCheckpoint &cp) {
+  CycleCheckpoint stamped = cp;
+  stamped.version = CHECKPOINT_VERSION;
+  stamped.seq = ++s_seq;
+  submit(CheckpointOp::Save, &stamped);
+}
+
+void checkpointClear() {
+  submit(CheckpointOp::Clear, nullptr);
+}
@@ -1,32 +1,39 @@
 #include "global.h"
 
 // raw readings
-volatile float g_dhtTemp[3] = {0};
-volatile float g_dhtHum[3] = {0};
+volatile float g_dhtTemp[NUM_DHT_SENSORS] = {0};
+volatile float g_dhtHum[NUM_DHT_SENSORS] = {0};
 
 // instantaneous AH
-volatile float g_dhtAH[3] = {0};
+volatile float g_dhtAH[NUM_DHT_SENSORS] = {0};
 
 // diffs vs. sensor0
-volatile float g_dhtAHDiff[2] = {0};
+volatile float g_dhtAHDiff[NUM_BAYS] = {0};
 
-// EMAs (seed to NAN so first sample initializes)
-volatile float g_dhtAH_ema[3] = {NAN, NAN, NAN};
-volatile float g_dhtAHDiff_ema[2] = {NAN, NAN};
+// EMAs (seeded to NAN by createSensorTask() so the first sample initializes)
+volatile float g_dhtAH_ema[NUM_DHT_SENSORS];
+volatile float g_dhtAHDiff_ema[NUM_BAYS];
 
 // boolean status: true == wet
-volatile bool g_dhtIsWet[2] = {false, false};
+volatile bool g_dhtIsWet[NUM_BAYS] = {false};
 
-// AH rate-of-change in g/m³/min for sensors 1 and 2
-float g_dhtAHRate[2] = {0.0f, 0.0f};
+// AH rate-of-change in g/m³/min per bay
+float g_dhtAHRate[NUM_BAYS] = {0.0f};
 
 // NaN counters per DHT sensor
-volatile uint32_t g_dhtNaNCount[3] = {0, 0, 0};
+volatile uint32_t g_dhtNaNCount[NUM_DHT_SENSORS] = {0};
+
+// Completed sensor passes
+volatile uint32_t g_dhtSampleSeq = 0;
 
 // Cached battery voltage
 volatile float g_lastBatteryVoltage = 0.0f;
 
-// Battery voltage monitoring implementation
+// Degradation ladder state (battery task)
+volatile BatteryRung g_batteryRung = BatteryRung::Normal;
+volatile float g_batteryRestV = 0.0f;
+
+// Battery voltage monitoring implementation (blocking; battery sampler task only)
 float readBatteryVoltage() {
   long sum = 0;
   for (int i = 0; i < BATTERY_ADC_SAMPLES; i++) {
@@ -46,13 +53,11 @@ float readBatteryVoltage() {
 }
 
 bool isBatteryOk() {
-  float voltage = readBatteryVoltage();
-  return voltage >= BATTERY_LOW_THRESHOLD;
+  return g_lastBatteryVoltage >= BATTERY_LOW_THRESHOLD;
 }
 
 bool isBatteryRecovered() {
-  float voltage = readBatteryVoltage();
-  return voltage >= BATTERY_RECOVERY_THRESHOLD;
+  return g_lastBatteryVoltage >= BATTERY_RECOVERY_THRESHOLD;
 }
 
 // LED status control - called from FSM
@@ -1,4 +1,5 @@
 #include "global.h"
+#include "tskBattery.h"
 #include "tskDHT.h"
 #include "tskFSM.h"
 #include "tskUI.h"
@@ -15,6 +16,7 @@ void setup() {
   digitalWrite(HW_ERROR_LED_PIN, LOW);
   
   createSensorTask();
+  createBatteryTask();
   createOledTasks();
   createStateMachineTask();
 }
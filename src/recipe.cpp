@@ -0,0 +1,81 @@
+// recipe.cpp - Built-in drying recipes
+#include "recipe.h"
+#include <math.h>
+
+static constexpr uint32_t S = 1000u;  // ms per second, keeps the tables readable
+
+// Tier columns: maxDiff, name, WET min / max, buffer, peak min time, peak rate,
+// rise min time, rise, re-evap min time, re-evap rise
+static constexpr Recipe RECIPES[NUM_RECIPES] = {
+    // Standard: the generic tuning from config.h
+    {"standard", "STD", HEATER_WET_TEMP_THRESHOLD_C, HEATER_WARMUP_MIN_MS, HEATER_WARMUP_EXTENDED_MS,
+     HEATER_WARMUP_COLD_C,
+     {{AH_DIFF_BARELY_WET, "BARELY_WET", WET_BARELY_WET_MS, WET_BARELY_WET_MAX_MS, WET_BUFFER_BARELY_WET_MS,
+       60 * S, 0.20f, 60 * S, 0.6f, RE_EVAP_MIN_TIME_BARE_MOD, RE_EVAP_RISE_BARE_MOD},
+      {AH_DIFF_MODERATE_WET, "MODERATE_WET", WET_MODERATE_MS, WET_MODERATE_MAX_MS, WET_BUFFER_MODERATE_MS,
+       AH_PEAK_NORMAL_MIN_TIME_MS, AH_RATE_NORMAL_PEAK_THRESHOLD, 90 * S, 0.6f, RE_EVAP_MIN_TIME_BARE_MOD,
+       RE_EVAP_RISE_BARE_MOD},
+      {AH_DIFF_VERY_WET, "VERY_WET", WET_VERY_WET_MS, WET_VERY_WET_MAX_MS, WET_BUFFER_VERY_WET_MS, 180 * S, 0.50f,
+       120 * S, 0.8f, RE_EVAP_MIN_TIME_VERY, RE_EVAP_RISE_VERY},
+      {INFINITY, "SOAKED", WET_SOAKED_MS, WET_SOAKED_MAX_MS, WET_BUFFER_SOAKED_MS, AH_PEAK_WET_MIN_TIME_MS,
+       AH_RATE_WET_PEAK_THRESHOLD, 150 * S, 1.0f, RE_EVAP_MIN_TIME_SOAKED, RE_EVAP_RISE_SOAKED}},
+     {{2.0f, DRY_COOL_MS_SOAKED, 75}, {1.2f, DRY_COOL_MS_WET, 72}, {-INFINITY, DRY_COOL_MS_BASE, 70}},
+     DRY_STABILIZE_MS, RE_EVAP_MAX_MS},
+    // Mesh running shoe: thin and open, little water held deep in the upper.
+    // It warms fast, the peak comes early and the buffer / cool-down can be short.
+    {"mesh", "MESH", 38.0f, 20 * S, 35 * S, 22.0f,
+     {{1.5f, "BARELY_WET", 90 * S, 180 * S, 25 * S, 45 * S, 0.25f, 45 * S, 0.5f, 30 * S, 0.5f},
+      {3.5f, "MODERATE_WET", 210 * S, 360 * S, 45 * S, 75 * S, 0.40f, 60 * S, 0.5f, 30 * S, 0.5f},
+      {5.0f, "VERY_WET", 300 * S, 480 * S, 60 * S, 120 * S, 0.55f, 90 * S, 0.7f, 60 * S, 0.7f},
+      {INFINITY, "SOAKED", 420 * S, 660 * S, 90 * S, 180 * S, 0.65f, 120 * S, 0.9f, 90 * S, 0.9f}},
+     {{2.0f, 120 * S, 70}, {1.2f, 90 * S, 65}, {-INFINITY, 60 * S, 60}},
+     60 * S, 45 * S},
+    // Leather: heat-sensitive (cracks, shrinks), so a lower heater cut-off and
+    // slower evaporation, with longer tiers and a longer stabilization
+    {"leather", "LTHR", 35.0f, 30 * S, 50 * S, 25.0f,
+     {{1.5f, "BARELY_WET", 240 * S, 420 * S, 60 * S, 90 * S, 0.20f, 90 * S, 0.6f, 60 * S, 0.6f},
+      {3.5f, "MODERATE_WET", 480 * S, 720 * S, 100 * S, 150 * S, 0.30f, 120 * S, 0.6f, 60 * S, 0.6f},
+      {5.0f, "VERY_WET", 600 * S, 900 * S, 120 * S, 210 * S, 0.45f, 150 * S, 0.8f, 90 * S, 0.8f},
+      {INFINITY, "SOAKED", 720 * S, 1080 * S, 150 * S, 270 * S, 0.55f, 180 * S, 1.0f, 120 * S, 1.0f}},
+     {{2.0f, 180 * S, 65}, {1.2f, 150 * S, 60}, {-INFINITY, 120 * S, 55}},
+     120 * S, 60 * S},
+    // Boots: thick uppers and insoles hold water deep and release it late;
+    // longer warmup (also for a cool boot), tiers and cool-down, higher fan duty
+    {"boots", "BOOT", 38.0f, 40 * S, 60 * S, 28.0f,
+     {{1.5f, "BARELY_WET", 240 * S, 360 * S, 60 * S, 90 * S, 0.20f, 90 * S, 0.6f, 60 * S, 0.6f},
+      {3.5f, "MODERATE_WET", 420 * S, 600 * S, 100 * S, 150 * S, 0.35f, 120 * S, 0.7f, 60 * S, 0.7f},
+      {5.0f, "VERY_WET", 540 * S, 780 * S, 120 * S, 210 * S, 0.50f, 150 * S, 0.9f, 90 * S, 0.9f},
+      {INFINITY, "SOAKED", 600 * S, 900 * S, 150 * S, 270 * S, 0.60f, 180 * S, 1.1f, 120 * S, 1.1f}},
+     {{2.0f, 210 * S, 80}, {1.2f, 180 * S, 75}, {-INFINITY, 120 * S, 72}},
+     120 * S, 75 * S},
+};
+
+static RecipeId s_selected = RECIPE_DEFAULT;
+
+const Recipe &recipe(RecipeId id) {
+  size_t i = static_cast<size_t>(id);
+  return RECIPES[i < NUM_RECIPES ? i : static_cast<size_t>(RECIPE_DEFAULT)];
+}
+
+const RecipeTier &recipeTier(const Recipe &r, float ahDiff) {
+  for (const RecipeTier &t : r.tiers)
+    if (ahDiff < t.maxDiff)
+      return t;
+  return r.tiers[RECIPE_TIERS - 1];  // NaN
+}
+
+const CoolingBand &recipeCoolingBand(const Recipe &r, float ahDiff) {
+  for (const CoolingBand &b : r.cooling)
+    if (ahDiff > b.minDiff)
+      return b;
+  return r.cooling[RECIPE_COOLING_BANDS - 1];  // NaN
+}
+
+RecipeId recipeSelected() {
+  return s_selected;
+}
+
+RecipeId recipeSelectNext() {
+  s_selected = static_cast<RecipeId>((static_cast<size_t>(s_selected) + 1) % NUM_RECIPES);
+  return s_selected;
+}
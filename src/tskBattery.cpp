@@ -0,0 +1,96 @@
+// tskBattery.cpp - Battery voltage sampler and degradation ladder
+#include "tskBattery.h"
+#include "global.h"
+#include "tskMotor.h"
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static_assert(BATTERY_CAP_FANS_V > BATTERY_HOLD_HEATERS_V && BATTERY_HOLD_HEATERS_V > BATTERY_PAUSE_V &&
+                  BATTERY_PAUSE_V > BATTERY_LOW_THRESHOLD,
+              "ladder rungs must step down in order, above the low-battery cutoff");
+
+// Resting voltage below which each rung applies (index = rung)
+static constexpr float RUNG_BELOW_V[] = {INFINITY, BATTERY_CAP_FANS_V, BATTERY_HOLD_HEATERS_V, BATTERY_PAUSE_V};
+static constexpr size_t NUM_RUNGS = sizeof(RUNG_BELOW_V) / sizeof(RUNG_BELOW_V[0]);
+
+// Load model: internal resistance estimate and the previous sample
+static float s_internalOhm = BATTERY_INTERNAL_OHM;
+static float s_lastV = NAN;
+static float s_lastA = 0.0f;
+static uint32_t s_rungSinceMs = 0;
+
+// Draw the supply sees now: heaters whose relay is on and fans at their
+// applied duty, on top of the always-on electronics
+static float loadW() {
+  float w = POWER_BASE_W;
+  for (uint8_t i = 0; i < NUM_BAYS; ++i) {
+    if (heaterIsPowered(i))
+      w += POWER_HEATER_W;
+    w += POWER_MOTOR_W * getMotorDutyCycle(i) / 100.0f;
+  }
+  return w;
+}
+
+// Refine the internal resistance from a load step between two samples (a
+// heater switching is ~3 A); small steps are mostly ADC noise
+static void learnResistance(float v, float amps) {
+  float dA = amps - s_lastA;
+  if (!isnan(s_lastV) && fabsf(dA) >= 1.0f) {
+    float ohm = (s_lastV - v) / dA;
+    if (ohm > 0.02f && ohm < 1.0f)
+      s_internalOhm += 0.2f * (ohm - s_internalOhm);
+  }
+  s_lastV = v;
+  s_lastA = amps;
+}
+
+// Step down at once to the rung the resting voltage calls for (one further if
+// the loaded reading sags below the floor anyway); step back up one rung at a
+// time, with hysteresis and a minimum dwell so a recovering pack does not chatter
+static BatteryRung nextRung(BatteryRung cur, float restV, float loadedV, uint32_t nowMs) {
+  size_t at = static_cast<size_t>(cur);
+  size_t want = 0;
+  for (size_t r = 1; r < NUM_RUNGS; ++r)
+    if (restV < RUNG_BELOW_V[r])
+      want = r;
+  if (loadedV < BATTERY_MIN_LOADED_V && at + 1 < NUM_RUNGS && want <= at)
+    want = at + 1;
+  if (want > at)
+    return static_cast<BatteryRung>(want);
+  if (at > 0 && restV >= RUNG_BELOW_V[at] + BATTERY_LADDER_HYST_V &&
+      (uint32_t)(nowMs - s_rungSinceMs) >= BATTERY_LADDER_DWELL_MS)
+    return static_cast<BatteryRung>(at - 1);
+  return cur;
+}
+
+// readBatteryVoltage() averages BATTERY_ADC_SAMPLES reads ~2 ms apart; it
+// blocks for that long, so only this task calls it.
+static void vBatteryTask(void * /*pv*/) {
+  analogReadResolution(12);
+  analogSetPinAttenuation(HW_BATTERY_ADC_PIN, ADC_11db);
+  pinMode(HW_BATTERY_ADC_PIN, INPUT);
+
+  while (true) {
+    float v = readBatteryVoltage();
+    g_lastBatteryVoltage = v;
+    if (v > 1.0f) {  // ignore an unpowered divider (USB bench supply)
+      float amps = loadW() / v;
+      learnResistance(v, amps);
+      float restV = v + amps * s_internalOhm;
+      g_batteryRestV = restV;
+      uint32_t now = millis();
+      BatteryRung rung = nextRung(g_batteryRung, restV, v, now);
+      if (rung != g_batteryRung) {
+        g_batteryRung = rung;
+        s_rungSinceMs = now;
+      }
+    }
+    vTaskDelay(pdMS_TO_TICKS(BATTERY_CHECK_INTERVAL_MS));
+  }
+}
+
+void createBatteryTask() {
+  // Low priority: a late reading only ages the cached value
+  xTaskCreatePinnedToCore(vBatteryTask, "BatteryTask", 2048, nullptr, 1, nullptr, 0);
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include "global.h"
+
+// Battery sampler: owns the battery ADC and keeps g_lastBatteryVoltage fresh
+// (one averaged reading every BATTERY_CHECK_INTERVAL_MS). Everyone else reads
+// the cached value instead of sampling the ADC themselves. Each reading also
+// updates the resting-voltage estimate and the degradation ladder rung
+// (g_batteryRestV, g_batteryRung).
+void createBatteryTask();
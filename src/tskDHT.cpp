@@ -6,7 +6,9 @@
 #include <DHT.h>
 #include "tskMotor.h"  // for optional EMI-aware adjustments and duty checks
 #include <Adafruit_Sensor.h>
+#include <array>
 #include <cstring>
+#include <utility>
 
 // Reject implausible spikes to avoid corrupt temps (e.g., -1645C bursts)
 static bool sanitizeDHTSample(int idx, float &t, float &h, bool hasPrev) {
@@ -21,10 +23,15 @@ static bool sanitizeDHTSample(int idx, float &t, float &h, bool hasPrev) {
   return true;
 }
 
-// Use Adafruit DHT directly (wrapper removed to reduce timing overhead)
-static DHT dht0(HW_DHT_PIN_0, DHT22);
-static DHT dht1(HW_DHT_PIN_1, DHT22);
-static DHT dht2(HW_DHT_PIN_2, DHT22);
+// Use Adafruit DHT directly (wrapper removed to reduce timing overhead).
+// Sensor 0 is ambient; sensor baySensor(i) belongs to bay i.
+static constexpr int dhtPin(size_t sensor) {
+  return sensor == 0 ? HW_DHT_PIN_0 : HW_BAYS[sensor - 1].dhtPin;
+}
+template <size_t... I> static std::array<DHT, sizeof...(I)> makeSensors(std::index_sequence<I...>) {
+  return {{DHT(dhtPin(I), DHT22)...}};
+}
+static std::array<DHT, NUM_DHT_SENSORS> s_dht = makeSensors(std::make_index_sequence<NUM_DHT_SENSORS>{});
 
 // Note: Avoid long critical sections around DHT reads on ESP32.
 // The Adafruit DHT library already manages timing/interrupts; wrapping reads
@@ -45,62 +52,33 @@ static inline void readDHTSafe(DHT &d, float &t, float &h) {
 }
 
 static void vSensorTask(void * /*pvParameters*/) {
-  dht0.begin();
-  dht1.begin();
-  dht2.begin();
+  for (auto &d : s_dht)
+    d.begin();
   // DHT22 needs at least 2s after power-up before first read
   vTaskDelay(pdMS_TO_TICKS(2000));
   // Track if we've ever had a valid sample per sensor (to avoid using 0.0 on cold start)
-  static bool s_hasValid[3] = {false, false, false};
+  static bool s_hasValid[NUM_DHT_SENSORS] = {false};
 
   while (true) {
-    // Sensor 0 (ambient)
-    float t0, h0;
-    readDHTSafe(dht0, t0, h0);
-    bool ok0 = sanitizeDHTSample(0, t0, h0, s_hasValid[0]);
-
-    DEV_DBG_PRINT("DHT0 GPIO"); DEV_DBG_PRINT(HW_DHT_PIN_0); DEV_DBG_PRINT(" -> T="); DEV_DBG_PRINT(t0); DEV_DBG_PRINT(" H="); DEV_DBG_PRINTLN(h0);
-    if (ok0) {
-      g_dhtTemp[0] = t0;
-      g_dhtHum[0] = h0;
-      s_hasValid[0] = true;
-    } else {
-      g_dhtNaNCount[0]++;
-    }
-    // Yield briefly to feed WDT/IDLE
-    vTaskDelay(pdMS_TO_TICKS(1));
-
-    // Sensor 1
-    float t1, h1;
-    readDHTSafe(dht1, t1, h1);
-    bool ok1 = sanitizeDHTSample(1, t1, h1, s_hasValid[1]);
+    for (size_t i = 0; i < NUM_DHT_SENSORS; ++i) {
+      float t, h;
+      readDHTSafe(s_dht[i], t, h);
+      bool ok = sanitizeDHTSample(i, t, h, s_hasValid[i]);
 
-    DEV_DBG_PRINT("DHT1 GPIO"); DEV_DBG_PRINT(HW_DHT_PIN_1); DEV_DBG_PRINT(" -> T="); DEV_DBG_PRINT(t1); DEV_DBG_PRINT(" H="); DEV_DBG_PRINTLN(h1);
-    if (ok1) {
-      g_dhtTemp[1] = t1;
-      g_dhtHum[1] = h1;
-      s_hasValid[1] = true;
-    } else {
-      g_dhtNaNCount[1]++;
-    }
-    vTaskDelay(pdMS_TO_TICKS(1));
-
-    // Sensor 2
-    float t2, h2;
-    readDHTSafe(dht2, t2, h2);
-    bool ok2 = sanitizeDHTSample(2, t2, h2, s_hasValid[2]);
-
-    DEV_DBG_PRINT("DHT2 GPIO"); DEV_DBG_PRINT(HW_DHT_PIN_2); DEV_DBG_PRINT(" -> T="); DEV_DBG_PRINT(t2); DEV_DBG_PRINT(" H="); DEV_DBG_PRINTLN(h2);
-    if (ok2) {
-      g_dhtTemp[2] = t2;
-      g_dhtHum[2] = h2;
-      s_hasValid[2] = true;
-    } else {
-      g_dhtNaNCount[2]++;
+      DEV_DBG_PRINT("DHT"); DEV_DBG_PRINT(i); DEV_DBG_PRINT(" GPIO"); DEV_DBG_PRINT(dhtPin(i)); DEV_DBG_PRINT(" -> T="); DEV_DBG_PRINT(t); DEV_DBG_PRINT(" H="); DEV_DBG_PRINTLN(h);
+      if (ok) {
+        g_dhtTemp[i] = t;
+        g_dhtHum[i] = h;
+        s_hasValid[i] = true;
+      } else {
+        g_dhtNaNCount[i]++;
+      }
+      // Yield briefly to feed WDT/IDLE
+      vTaskDelay(pdMS_TO_TICKS(1));
     }
 
     // Compute AH and simple wet flags (no EMA/no filtering)
-    for (int i = 0; i < 3; ++i) {
+    for (int i = 0; i < NUM_DHT_SENSORS; ++i) {
       if (s_hasValid[i]) {
         float ah = computeAH(g_dhtTemp[i], g_dhtHum[i]);
         if (i == 0) {
@@ -121,24 +99,31 @@ static void vSensorTask(void * /*pvParameters*/) {
       }
     }
 
-    for (int i = 1; i < 3; ++i) {
+    for (int b = 0; b < NUM_BAYS; ++b) {
+      int i = baySensor(b);
       if (!isnan(g_dhtAH[0]) && !isnan(g_dhtAH[i])) {
         float diff = g_dhtAH[i] - g_dhtAH[0];
-        g_dhtAHDiff[i - 1] = diff;
-        g_dhtAHDiff_ema[i - 1] = diff;
-        g_dhtIsWet[i - 1] = (diff > AH_WET_THRESHOLD);
+        g_dhtAHDiff[b] = diff;
+        g_dhtAHDiff_ema[b] = diff;
+        g_dhtIsWet[b] = (diff > AH_WET_THRESHOLD);
       } else {
         // Preserve last diff and wet state when either AH is invalid (hold-last)
         // Intentionally no updates here
       }
     }
 
+    g_dhtSampleSeq = g_dhtSampleSeq + 1;
+
     // 3s interval like your working sketch
     vTaskDelay(pdMS_TO_TICKS(3000));
   }
 }
 
 void createSensorTask() {
+  for (auto &v : g_dhtAH_ema)
+    v = NAN;
+  for (auto &v : g_dhtAHDiff_ema)
+    v = NAN;
   // Pin to core 1 to reduce contention with WiFi/IDLE on core 0 and avoid WDT
   xTaskCreatePinnedToCore(vSensorTask, "SensorTask", 4096, nullptr, 2, nullptr, 1);
 }
\ No newline at end of file
@@ -1,254 +1,506 @@
 #include "tskFSM.h"
+#include "buttons.h"
+#include "checkpoint.h"
 #include "global.h"
 #include "fsm_debug.h"
+#include "recipe.h"
 #include "tskMotor.h"
 #include "tskUV.h"
 #include "tskUI.h"
 #include "PIDcontrol.h"
 #include <Arduino.h>
 #include <events.h>
+#include <EventMailbox.h>
+#include <PhaseScript.h>
+#include <PowerBudget.h>
 #include <StateMachine.h>
+#include <esp_system.h>
 #include <freertos/FreeRTOS.h>
-#include <freertos/queue.h>
 
 // External PID control globals (defined in tskMotor.cpp)
-extern PIDcontrol g_motorPID[2];
-extern bool g_pidInitialized[2];
-
-// Button definitions (configurable in include/config.h)
-static constexpr int START_PIN = HW_START_PIN;
-static constexpr int RESET_PIN = HW_RESET_PIN;
+extern PIDcontrol g_motorPID[NUM_BAYS];
+extern bool g_pidInitialized[NUM_BAYS];
 
 // Timing/config
-static constexpr uint32_t DEBOUNCE_MS = 300u;
-static constexpr uint32_t FSM_LOOP_DELAY_MS = 50u;
-static constexpr size_t FSM_QUEUE_LEN = 8;
+static constexpr uint32_t LED_BLINK_MS = 500u;
 
-// Instantiate Global + two Sub-FSMs
-static StateMachine<GlobalState, Event> fsmGlobal(GlobalState::Idle);
-static StateMachine<SubState, Event> fsmSub1(SubState::S_IDLE);
-static StateMachine<SubState, Event> fsmSub2(SubState::S_IDLE);
+// Instantiate Global FSM + a bank of per-bay Sub-FSMs sharing one table
+// (trace id 0 is the global FSM, 1 + i is bay i in g_fsmTrace records)
+static StateMachine<GlobalState, Event> fsmGlobal(GlobalState::Idle, 0);
+static StateMachineBank<SubState, Event, NUM_BAYS> fsmSubs(SubState::S_IDLE, 1);
 
 // Sensor equalize timeout (milliseconds)
 static constexpr uint32_t SENSOR_EQUALIZE_MS = 6u * 1000u; // 6s
-// timestamp when we entered Detecting (0 = not active)
-static uint32_t detectingStartMs = 0;
-// Event queue for serializing FSM events
-struct EventMsg {
-  Event ev;
-  bool broadcastAll;
-};
-static QueueHandle_t g_fsmEventQ = nullptr;
+// Pending-event mailbox: posts from any task/ISR coalesce into one bit per
+// target. Target 0 goes through the global FSM; target 1 + i is sub i only.
+static constexpr uint8_t FSM_TARGET_ALL = 0;
+static constexpr size_t FSM_NUM_TARGETS = 1 + NUM_BAYS;
+static EventMailbox<Event, NUM_EVENT_BITS, FSM_NUM_TARGETS> g_fsmMailbox;
+// Payload of the event being dispatched (0 outside dispatchEvent())
+static uint32_t g_eventArg = 0;
+// Drain order: these first (in order), then remaining events lowest-bit-first
+static constexpr Event FSM_EVENT_PRIORITY[] = {Event::ResetPressed, Event::Error, Event::BatteryLow};
+// FSM task; every post notifies it, so it sleeps until a post or its next deadline
+static TaskHandle_t s_fsmTask = nullptr;
+
+#ifdef FSM_STATS
+// Loop wakeups (all / by notification) since g_wakeStatsSinceMs
+static uint32_t g_wakeups = 0;
+static uint32_t g_wakeupsNotified = 0;
+static uint32_t g_wakeStatsSinceMs = 0;
+// Post -> dispatched latency in microseconds. The stamp is written before the
+// post publishes the event bit; a coalesced post re-stamps it (newest wins).
+static uint32_t g_postUs[FSM_NUM_TARGETS][NUM_EVENT_BITS];
+static CallbackStats g_eventLatencyUs;
+// Busy time of one loop pass (timers, dispatch, run) in microseconds.
+// Callbacks must not block, so a pass should stay under the budget; FSM_DBG
+// serial output is the usual reason one does not.
+static constexpr uint32_t FSM_TICK_BUDGET_US = 1000;
+static CallbackStats g_tickUs;
+static uint32_t g_tickOverruns = 0;
+#endif
+
+// Consecutive loop passes that did not block; a few in a row are normal
+// (a deadline landing on this tick), this many mean one is stuck in the past
+static constexpr uint32_t FSM_SPIN_WARN_PASSES = 100;
+static uint32_t g_zeroSleeps = 0;
 
 // forward declaration
-static bool fsmPostEvent(Event ev, bool broadcastAll);
+static bool fsmPostEvent(Event ev);
 
-// Track which subs have reached S_DONE. Bit0 = sub1, Bit1 = sub2.
+// Track which subs have reached S_DONE: bit i = bay i.
+static_assert(NUM_BAYS <= 8, "g_subDoneMask holds one bit per bay");
+static constexpr uint8_t ALL_SUBS_MASK = (1u << NUM_BAYS) - 1;
 static uint8_t g_subDoneMask = 0;
-// timestamp when we entered Done (0 = not active). After 60s -> auto-reset
-static uint32_t g_doneStartMs = 0;
-// per-sub timestamps for managing time-based transitions
-static uint32_t g_subWetStartMs[2] = {0, 0};
-// g_subDryerStartMs removed; use g_subWetStartMs for wet runtime and g_subCoolingStartMs for
-// cooling
-static uint32_t g_subCoolingStartMs[2] = {0, 0};
-static uint32_t g_subCoolingStabilizeStartMs[2] = {0, 0};
-static bool g_coolingLocked[2] = {false, false};
-// Track if early dry exit already triggered to prevent repeated events
-static bool g_coolingEarlyExit[2] = {false, false};
-
-// Track AH rate-of-change during WET to detect peak evaporation
-// Used to exit WET state when drying rate starts declining
-static float g_prevAHRate[2] = {0.0f, 0.0f};  // Previous AH rate-of-change sample
-static uint32_t g_lastAHRateSampleMs[2] = {0, 0};  // Timestamp of last sample
-static int g_ahRateSampleCount[2] = {0, 0};  // Number of samples collected
-static int g_consecutiveNegativeCount[2] = {0, 0};  // Consecutive negative rate changes
-static bool g_peakDetected[2] = {false, false};  // Flag: peak evaporation detected, in post-peak buffer
-static uint32_t g_peakDetectedMs[2] = {0, 0};  // Timestamp when peak was first detected
-// Moving-average buffers for robust decline detection
-static float g_rateHistory[2][8] = {{0}}; // last 8 samples per shoe
-static int g_rateHistoryIdx[2] = {0, 0};
-static int g_rateHistoryCount[2] = {0, 0};
-static uint32_t g_coolingMotorDurationMs[2] = {DRY_COOL_MS_BASE, DRY_COOL_MS_BASE};  // Adaptive COOLING motor phase duration
-static uint8_t g_coolingRetryCount[2] = {0, 0};  // Number of cooling retries within a cycle
-static float g_coolingDiffSamples[2][6] = {{0.0f}};  // Last 6 AH diff samples during stabilization
-static int g_coolingDiffSampleIdx[2] = {0, 0};  // Current sample index
-static int g_coolingDiffSampleCount[2] = {0, 0};  // Number of samples collected
-// Re-evap short cycle tracking
-static bool g_inReEvap[2] = {false, false};
-static uint32_t g_reEvapStartMs[2] = {0, 0};
-static float g_reEvapMinDiff[2] = {999.0f, 999.0f};
-static uint32_t g_reEvapMinDiffMs[2] = {0, 0};
+
+// WET and COOLING run logic are PhaseScripts: linear bodies resumed every
+// SCRIPT_TICK_MS, the states' run period (sensors update every ~3 s; 500 ms
+// keeps the heater trend sampling at its original rate). Their position in
+// the script replaces the phase flags; what must survive a suspension lives
+// in these contexts.
+static constexpr uint32_t SCRIPT_TICK_MS = 500u;
+// COOLING runs a quarter tick after WET; with the bank's per-shoe stagger the
+// two shoes' scripts never share a wakeup.
+static constexpr uint32_t COOLING_RUN_OFFSET_MS = SCRIPT_TICK_MS / 4;
+// WAITING only re-checks the power budget, which changes on other states' exits
+static constexpr uint32_t WAITING_RUN_PERIOD_MS = 250u;
+
+struct WetScript {
+  PhaseScript ps;
+  uint32_t lastSampleMs;  // warmup start, then last AH-rate sample
+  uint32_t seenSeq;       // g_dhtSampleSeq at the last warmup check
+  uint32_t peakMs;        // when the evaporation peak was seen
+  float minDiff;          // minimum AH diff seen (true evaporation bottom)
+  uint32_t minDiffMs;
+  float lastValidDiff;    // last plausible AH diff (guards against glitches)
+  int negCount;           // consecutive declining rate averages
+  float rateHist[8];      // last 8 AH-rate samples, for moving-average decline
+  uint8_t rateIdx;
+  uint8_t rateCount;
+  bool skipWarmup;        // resumed after a reset: warmup / pre-peak already done
+  bool skipPrePeak;
+};
+
+enum class CoolingPhase : uint8_t { Motor, Stabilize, ReEvap, Finished };
+
+struct CoolingScript {
+  PhaseScript ps;
+  CoolingPhase phase;
+  uint32_t markMs;        // stabilization start, then re-evap start
+  uint32_t sampleMs;      // last stabilization sample
+  uint32_t lastHoldLogMs;
+  float lastTemp;         // previous early dry-check inputs (glitch filter)
+  float lastDiff;
+  float samples[6];       // last 6 AH diff samples during stabilization
+  uint8_t sampleIdx;
+  uint8_t sampleCount;
+  float reEvapMinDiff;
+  bool reEvapTimedOut;
+  uint8_t reEvapRetries;  // re-evap timeouts this cycle (see MAX_RE_EVAP_RETRIES)
+  bool skipMotor;         // resumed without a fan grant: stabilize at once, fan off
+};
+
+// Per-cycle phase profile: wall-clock time spent in each sub-phase and why it
+// last ended, printed as one [CYCLE] record when the shoe reaches S_DONE.
+// A phase visited again (COOLING after a re-evap, WAITING after a failed
+// dry-check) accumulates. Listed in record order.
+enum class CyclePhase : uint8_t {
+  None,
+  Waiting,      // queued for WET power
+  Warmup,       // heater warmup
+  PrePeak,      // trend-gated heating until the evaporation peak
+  Buffer,       // post-peak buffer
+  BufferRise,   // buffer extended: moisture rose during WET
+  BufferHot,    // buffer extended: shoe still hot
+  BufferMin,    // buffer over, waiting for the minimum WET time / sane AH
+  Cooling,      // COOLING motor phase
+  CoolingHold,  // motor phase extended while the shoe is hot
+  Stabilize,
+  ReEvapWait,   // re-evap waiting for heater + fan power
+  ReEvap,
+  DryWait,      // DRY, waiting for every shoe before the shared UV
+  Uv,
+  Count
+};
+static constexpr size_t NUM_CYCLE_PHASES = static_cast<size_t>(CyclePhase::Count);
+static const char *const CYCLE_PHASE_NAMES[NUM_CYCLE_PHASES] = {
+    "none", "wait", "warmup", "prepeak", "buf", "buf_rise", "buf_hot", "buf_min",
+    "cool", "cool_hold", "stab", "reevap_wait", "reevap", "dry_wait", "uv"};
+
+// Why a phase ended; the record prints the character
+enum class PhaseEnd : char {
+  None = '-',     // never entered
+  Granted = 'G',  // power granted
+  Hot = 'H',      // temperature threshold reached
+  Time = 'T',     // its duration ran out
+  Peak = 'P',     // evaporation peak detected
+  Timeout = 'X',  // safety or hard limit
+  Dry = 'D',      // shoe read dry
+  Wet = 'W',      // dry-check failed
+  Rise = 'R',     // re-evap moisture rise
+};
+
+// Re-evap attempts recorded one by one; later ones only add to the totals
+static constexpr uint8_t PROFILE_RE_EVAP_SLOTS = MAX_RE_EVAP_RETRIES + 1;
+
+struct CycleProfile {
+  uint32_t startMs;  // 0 = no cycle profiled yet
+  uint32_t markMs;   // start of the current phase
+  uint32_t pausedMs; // battery pauses (also counted in the phase they interrupted)
+  CyclePhase phase;
+  uint32_t phaseMs[NUM_CYCLE_PHASES];
+  PhaseEnd end[NUM_CYCLE_PHASES];
+  uint8_t waits;           // WAITING visits
+  uint8_t reEvaps;         // re-evap attempts
+  uint8_t reEvapTimeouts;
+  uint32_t reEvapMs[PROFILE_RE_EVAP_SLOTS];
+  PhaseEnd reEvapEnd[PROFILE_RE_EVAP_SLOTS];
+};
+
+// Everything the sub FSM keeps per bay. The WAITING/WET/COOLING/DRY logic is
+// written once against it; callbacks find theirs as g_shoes[idx].
+struct ShoeContext {
+  WetScript wet;
+  CoolingScript cooling;
+  // Heater trend tracking (maybeEarlyHeaterOff)
+  float heaterLastTemp = NAN;
+  uint32_t heaterLastCheckMs = 0;
+  uint8_t heaterTrendSamples = 0;  // temp samples confirming the trend
+  bool heaterTempRising = false;
+  bool heaterLastOn = false;       // last logged heater command
+  uint32_t heaterLastLogMs = 0;
+  bool heaterDenied = false;       // HEATER_INTERLEAVE: wants heat, another bay holds the power
+  // Cycle timing (UI progress reads these); 0 = phase not started this run
+  uint32_t wetStartMs = 0;
+  uint32_t coolingStartMs = 0;
+  uint32_t coolingMotorDurationMs = DRY_COOL_MS_BASE;  // adaptive COOLING motor phase
+  // Initial wetness at WET entry and the durations derived from it
+  float initialWetDiff = 0.0f;
+  uint32_t wetMinDurationMs = WET_MODERATE_MS;
+  uint32_t peakBufferMs = WET_BUFFER_MODERATE_MS;  // post-peak buffer
+  // Motor started during the current wet->..->dry cycle
+  bool motorStarted = false;
+  // Guard against repeated handleEvent in WAITING (watchdog protection)
+  bool waitingEventPosted = false;
+  // Time queued in S_WAITING this run: finished visits plus the current one
+  uint32_t queueWaitMs = 0;
+  uint32_t waitStartMs = 0;  // 0 = not waiting
+  CycleProfile profile = {};
+  RecipeId recipe = RECIPE_DEFAULT;  // chosen at Running entry
+  // Resumed after a reset: the WET / COOLING entry restores progress from
+  // `resume` (see resumeFromCheckpoint)
+  bool resuming = false;
+  ShoeCheckpoint resume = {};
+};
+static ShoeContext g_shoes[NUM_BAYS];
+
+// Debug label for a bay (matches the SUB1/SUB2 naming used in logs)
+static const char *subLabel(uint8_t idx) {
+  return HW_BAYS[idx].label;
+}
+
+// Temperature of a bay's shoe sensor
+static float shoeTempC(uint8_t idx) {
+  return g_dhtTemp[baySensor(idx)];
+}
+
+static const Recipe &shoeRecipe(uint8_t idx) {
+  return recipe(g_shoes[idx].recipe);
+}
+
+// The shoe's wetness tier, from its AH diff at WET entry
+static const RecipeTier &shoeTier(uint8_t idx) {
+  return recipeTier(shoeRecipe(idx), g_shoes[idx].initialWetDiff);
+}
+
+// Clear per-run timers and flags so nothing stale blocks the next run
+static void resetShoeCycle(ShoeContext &s) {
+  s.motorStarted = false;
+  s.wetStartMs = 0;
+  s.coolingStartMs = 0;
+  s.waitingEventPosted = false;
+  s.queueWaitMs = 0;
+  s.waitStartMs = 0;
+  s.profile = {};
+  s.resuming = false;
+}
+
+// A phase boundary changed what a checkpoint would hold (see checkpointTick)
+static bool g_checkpointDirty = false;
+
+// Close the shoe's current phase with `why` and open `next`; staying in the
+// same phase is a no-op. The first phase opened starts the cycle clock.
+static void profMark(uint8_t idx, CyclePhase next, PhaseEnd why) {
+  CycleProfile &p = g_shoes[idx].profile;
+  if (next == p.phase)
+    return;
+  uint32_t now = millis();
+  if (p.phase != CyclePhase::None) {
+    size_t cur = static_cast<size_t>(p.phase);
+    uint32_t ms = now - p.markMs;
+    p.phaseMs[cur] += ms;
+    p.end[cur] = why;
+    if (p.phase == CyclePhase::ReEvap) {
+      if (p.reEvaps < PROFILE_RE_EVAP_SLOTS) {
+        p.reEvapMs[p.reEvaps] = ms;
+        p.reEvapEnd[p.reEvaps] = why;
+      }
+      ++p.reEvaps;
+      if (why == PhaseEnd::Timeout)
+        ++p.reEvapTimeouts;
+    }
+  } else if (!p.startMs) {
+    p.startMs = now;
+  }
+  if (next == CyclePhase::Waiting)
+    ++p.waits;
+  p.phase = next;
+  p.markMs = now;
+  g_checkpointDirty = CHECKPOINT_RESUME;  // nothing ever writes it otherwise
+}
+
+// [CYCLE] CSV header, printed once at boot so logs are self-describing
+static void profPrintHeader() {
+  if (!Serial)
+    return;
+  Serial.print("[CYCLE] bay,total_ms,paused_ms");
+  for (size_t i = 1; i < NUM_CYCLE_PHASES; ++i)
+    Serial.printf(",%s_ms,%s_end", CYCLE_PHASE_NAMES[i], CYCLE_PHASE_NAMES[i]);
+  Serial.print(",waits,reevaps,reevap_timeouts");
+  for (size_t i = 0; i < PROFILE_RE_EVAP_SLOTS; ++i)
+    Serial.printf(",reevap%u_ms,reevap%u_end", (unsigned)(i + 1), (unsigned)(i + 1));
+  Serial.println();
+}
+
+// One fixed-layout record per shoe per completed cycle (see profPrintHeader)
+static void profEmit(uint8_t idx) {
+  const CycleProfile &p = g_shoes[idx].profile;
+  if (!Serial || !p.startMs)
+    return;
+  Serial.printf("[CYCLE] %s,%lu,%lu", subLabel(idx), (unsigned long)(millis() - p.startMs),
+                (unsigned long)p.pausedMs);
+  for (size_t i = 1; i < NUM_CYCLE_PHASES; ++i)
+    Serial.printf(",%lu,%c", (unsigned long)p.phaseMs[i],
+                  p.end[i] == PhaseEnd{} ? static_cast<char>(PhaseEnd::None) : static_cast<char>(p.end[i]));
+  Serial.printf(",%u,%u,%u", (unsigned)p.waits, (unsigned)p.reEvaps, (unsigned)p.reEvapTimeouts);
+  for (size_t i = 0; i < PROFILE_RE_EVAP_SLOTS; ++i)
+    Serial.printf(",%lu,%c", (unsigned long)p.reEvapMs[i],
+                  static_cast<char>(i < p.reEvaps ? p.reEvapEnd[i] : PhaseEnd::None));
+  Serial.println();
+}
+
+static void resetHeaterTrend(ShoeContext &s) {
+  s.heaterLastTemp = NAN;
+  s.heaterLastCheckMs = 0;
+  s.heaterTrendSamples = 0;
+  s.heaterTempRising = false;
+  s.heaterDenied = false;
+}
 constexpr int MIN_AH_RATE_SAMPLES = 5;  // Need at least this many samples before checking decline
 constexpr int MIN_CONSECUTIVE_NEGATIVE = 3;  // Need at least 3 consecutive negative samples to exit WET (robust to noise)
 constexpr float AH_RATE_DECLINE_THRESHOLD = -0.01f;  // Rate-of-change decline to trigger exit (g/m³/min²)
 // Additional robustness: for very wet shoes, require sustained decline over longer history
 constexpr int MIN_SAMPLES_FOR_DECLINE = 6;  // Track at least 6 samples before considering decline valid
 constexpr float AH_RATE_PEAK_MIN_THRESHOLD = 0.3f;  // Don't declare peak until rate drops below this (g/m³/min) - prevents early exit on very wet shoes
-// Track whether the UV timer expired while the sub was in the COOLING phase.
-static bool g_uvExpiredDuringCooling[2] = {false, false};
-// UV complete flag: set when a UV timer has finished for a sub. Prevents
-// restarting the UV timer on subsequent loops between cooling->wet.
-static bool g_uvComplete[2] = {false, false};
-// Track initial wetness per shoe to adapt minimum WET duration and peak criteria
-static float g_initialWetDiff[2] = {0.0f, 0.0f};
-static uint32_t g_wetMinDurationMs[2] = {WET_MODERATE_MS, WET_MODERATE_MS};  // Default to moderate; will be reassigned
-// Post-peak buffer duration (adaptive based on initial wetness)
-static uint32_t g_peakBufferMs[2] = {WET_BUFFER_MODERATE_MS, WET_BUFFER_MODERATE_MS};  // Default to moderate; will be reassigned
-// Track last AH diff during WET phase (for continuous monitoring)
-static float g_lastWetAHDiff[2] = {0.0f, 0.0f};
-// Prevent accidental early exit if AH diff jumps down (sensor noise)
-static uint32_t g_lastAHDiffCheckMs[2] = {0, 0};
-static float g_lastValidAHDiff[2] = {0.0f, 0.0f};  // Last stable AH diff reading
-// Track MINIMUM AH diff seen during WET (for detecting true evaporation peak)
-static float g_minAHDiffSeen[2] = {999.0f, 999.0f};  // Initialize high
-static uint32_t g_minAHDiffSeenMs[2] = {0, 0};  // When minimum was observed
-// Protect g_uvComplete access since it's read from UI (core 0) and written by FSM (core 1)
-// (g_uvComplete is internal to FSM)
-
-// Track whether we have started the motor for a sub during the current wet->..->dry cycle.
-static bool g_motorStarted[2] = {false, false};
-
-// Sequential WET lock: only one shoe can be in S_WET at a time
-// -1 = free, 0 = shoe 0 owns the lock, 1 = shoe 1 owns the lock
-static int g_wetLockOwner = -1;
-// Guard to prevent repeated handleEvent in WAITING run callbacks (watchdog protection)
-static bool g_waitingEventPosted[2] = {false, false};
-// Track re-evap retry count per cycle to prevent infinite loops
-static uint8_t g_reEvapRetryCount[2] = {0, 0};
-// Track WET phase start time for timeout enforcement
-static uint32_t g_wetPhaseStartMs[2] = {0, 0};
-// UV start guard: prevent race condition where both shoes call uvStart() simultaneously
+// UV complete flag: set when the (single, shared) UV timer has finished.
+// Prevents restarting the UV timer on subsequent loops between cooling->wet.
+static bool g_uvComplete = false;
+
+// Supply budget shared by the bays (clients 0 .. NUM_BAYS-1) and the UV lamp.
+// A bay holds heater + fan in WET and RE-EVAP, a fan share in the COOLING
+// motor phase (see PIPELINE_COOLING_OVERLAP).
+static constexpr size_t POWER_CLIENT_UV = NUM_BAYS;
+static constexpr uint16_t WET_DRAW_W = POWER_HEATER_W + POWER_MOTOR_W;
+static constexpr uint16_t FAN_DRAW_W =
+    PIPELINE_COOLING_OVERLAP ? POWER_MOTOR_W * (FAN_COMBINED_DUTY_MAX_PCT - 100) / 100 : POWER_MOTOR_W;
+static_assert(FAN_COMBINED_DUTY_MAX_PCT >= 100, "the fan cap must allow one fan at full duty");
+static_assert(WET_DRAW_W <= POWER_BUDGET_W, "the power budget must fit one heating bay");
+static_assert(POWER_UV_W <= POWER_BUDGET_W, "the power budget must fit the UV lamp");
+static PowerBudget<NUM_BAYS + 1> g_power(POWER_BUDGET_W, POWER_AGING_MS);
+// Start of the current Running session, for the pair throughput log
+static uint32_t g_runStartMs = 0;
+// Battery ladder as last seen by Running, and when its Pause rung froze the
+// cycle (0 = not paused)
+static BatteryRung g_rungSeen = BatteryRung::Normal;
+static uint32_t g_pauseStartMs = 0;
+static const char *const BATTERY_RUNG_NAMES[] = {"normal", "cap fans", "hold heaters", "pause"};
+// Crash resume (CHECKPOINT_RESUME): the checkpoint read at boot, waiting for
+// the first sensor pass; Resume then enters Running with g_resuming set
+static CycleCheckpoint g_resumeCp;
+static bool g_resumeWaitSensors = false;
+static bool g_resuming = false;
+static uint32_t g_uvResumeMs = 0;  // UV time left at the reset (0 = full run)
+static uint32_t g_checkpointMs = 0;  // last checkpoint write
+// UV start guard: prevent race condition where several shoes call uvStart() simultaneously
 static bool g_uvStartGuard = false;
 
 // Helper: Classify wetness level and assign adaptive durations
 static void assignAdaptiveWETDurations(uint8_t idx, float ahDiff) {
-  if (ahDiff < AH_DIFF_BARELY_WET) {
-    // Barely wet - quick dry
-    g_wetMinDurationMs[idx] = WET_BARELY_WET_MS;
-    g_peakBufferMs[idx] = WET_BUFFER_BARELY_WET_MS;
-    FSM_DBG_PRINT("BARELY_WET");
-  } else if (ahDiff < AH_DIFF_MODERATE_WET) {
-    // Moderately wet - normal dry
-    g_wetMinDurationMs[idx] = WET_MODERATE_MS;
-    g_peakBufferMs[idx] = WET_BUFFER_MODERATE_MS;
-    FSM_DBG_PRINT("MODERATE_WET");
-  } else if (ahDiff < AH_DIFF_VERY_WET) {
-    // Very wet - extended dry
-    g_wetMinDurationMs[idx] = WET_VERY_WET_MS;
-    g_peakBufferMs[idx] = WET_BUFFER_VERY_WET_MS;
-    FSM_DBG_PRINT("VERY_WET");
-  } else {
-    // Soaked - full dry
-    g_wetMinDurationMs[idx] = WET_SOAKED_MS;
-    g_peakBufferMs[idx] = WET_BUFFER_SOAKED_MS;
-    FSM_DBG_PRINT("SOAKED");
+  ShoeContext &s = g_shoes[idx];
+  const RecipeTier &t = recipeTier(shoeRecipe(idx), ahDiff);
+  s.wetMinDurationMs = t.wetMinMs;
+  s.peakBufferMs = t.bufferMs;
+  FSM_DBG_PRINT(shoeRecipe(idx).name); FSM_DBG_PRINT(" "); FSM_DBG_PRINT(t.name);
+}
+
+// Warmup the WET script will run for the shoe's current temperature: none if
+// it is already at the recipe's cut-off, the cold-shoe time below its cold
+// threshold, the minimum otherwise (see subWetRun)
+static uint32_t predictWarmupMs(uint8_t idx) {
+  const Recipe &r = shoeRecipe(idx);
+  float tempC = shoeTempC(idx);
+  if (isnan(tempC)) return r.warmupMinMs;
+  if (tempC >= r.heaterMaxC) return 0;
+  return tempC < r.coldBelowC ? r.warmupColdMs : r.warmupMinMs;
+}
+
+// Predicted WET + COOLING time of a shoe that has not started WET, from its
+// recipe: warmup from its temperature, WET tier and buffer from its AH diff, the COOLING motor
+// phase (held longer when there is a wide cool-down span to ambient) and
+// stabilization. Only the ordering of shoes relies on it.
+static uint32_t predictCycleMs(uint8_t idx) {
+  float diff = g_dhtAHDiff[idx];
+  const Recipe &r = shoeRecipe(idx);
+  const RecipeTier &t = recipeTier(r, diff);
+  uint32_t motorMs = recipeCoolingBand(r, diff).motorMs;
+  float ambC = g_dhtTemp[0];
+  if (!isnan(ambC)) {
+    float spanC = r.heaterMaxC - (ambC + COOLING_AMBIENT_DELTA_C);
+    uint32_t needMs = spanC > 0.0f ? (uint32_t)(spanC * SCHED_COOL_MS_PER_C) : 0;
+    if (needMs > motorMs + COOLING_TEMP_EXTEND_MAX_MS)
+      motorMs += COOLING_TEMP_EXTEND_MAX_MS;
+    else if (needMs > motorMs)
+      motorMs = needMs;
   }
+  return predictWarmupMs(idx) + t.wetMinMs + t.bufferMs + motorMs + r.stabilizeMs;
 }
 
-static inline bool coolingMotorPhaseActive(int idx) {
-  // Motor phase is active if cooling started and stabilization hasn't begun yet
-  return (g_subCoolingStartMs[idx] != 0 && g_subCoolingStabilizeStartMs[idx] == 0);
+// WAITING queue policies (see WaitPolicy): priority of bay idx, higher goes
+// first. PowerBudget adds one unit per POWER_AGING_MS waited.
+using WaitPriorityFn = float (*)(uint8_t idx);
+
+static float wettestFirst(uint8_t idx) {
+  return g_dhtAHDiff[idx];
 }
 
-// Compute adaptive heater warmup based on shoe temperature
-static uint32_t getAdaptiveWarmupMs(uint8_t idx) {
-  // Sensor indices: 0=ambient, 1=shoe0, 2=shoe1
-  float tempC = g_dhtTemp[idx + 1];
-  if (isnan(tempC)) return HEATER_WARMUP_MS;
-  if (tempC >= HEATER_WARMUP_FAST_35C) return HEATER_WARMUP_35C_MS;
-  if (tempC >= HEATER_WARMUP_FAST_30C) return HEATER_WARMUP_30C_MS;
-  if (tempC >= HEATER_WARMUP_FAST_25C) return HEATER_WARMUP_25C_MS;
-  return HEATER_WARMUP_MS;
+// Negative predicted time in aging units: a long job overtakes a shorter one
+// once it has waited longer than their difference, so it cannot starve
+static float shortestFirst(uint8_t idx) {
+  return -(float)predictCycleMs(idx) / POWER_AGING_MS;
 }
 
-// Early heater efficiency with smart trend-based control
-// Tracks temperature direction to prevent churn
-static float g_heaterLastTemp[2] = {NAN, NAN};
-static uint32_t g_heaterLastCheckMs[2] = {0, 0};
-static uint8_t g_heaterTrendSamples[2] = {0, 0};  // Count of temp samples to establish trend
-static bool g_heaterTempRising[2] = {false, false};  // true if temp is rising
+static constexpr WaitPriorityFn WAIT_POLICIES[] = {wettestFirst, shortestFirst};
 
-// Warmup phase (heater + motor): runs until shoe reaches threshold temp, capped by time
-// During this phase, maybeEarlyHeaterOff() is disabled to let heater warm shoe without interference
-constexpr uint32_t HEATER_WARMUP_MIN_MS = 30u * 1000u;  // 30 seconds minimum
-constexpr uint32_t HEATER_WARMUP_EXTENDED_MS = 50u * 1000u;  // 50 seconds for cold shoes
-static uint32_t g_heaterWarmupStartMs[2] = {0, 0};  // 0 = not in warmup phase
-static bool g_heaterWarmupDone[2] = {false, false};  // Track if warmup has been completed for this cycle
-static constexpr float HEATER_WET_TEMP_THRESHOLD_C = 38.0f; // Temp to end unconditional heater-on
+static float waitPriority(uint8_t idx) {
+  return WAIT_POLICIES[static_cast<size_t>(WAIT_POLICY)](idx);
+}
 
-static void maybeEarlyHeaterOff(uint8_t idx, uint32_t /*wetElapsedMs*/) {
+static void maybeEarlyHeaterOff(uint8_t idx) {
   // Smart bang-bang: OFF at 39°C, track trend (rising/falling), only turn ON if falling
   // This prevents churn and lets residual heat help evaporate before reheating
   // CRITICAL: Only run during WET phase warmup/post-warmup, NEVER during COOLING/DRY
-  
-  float tempC = g_dhtTemp[idx + 1];
+  // Tracks temperature direction (in the shoe's context) to prevent churn
+  ShoeContext &s = g_shoes[idx];
+  float tempC = shoeTempC(idx);
   if (isnan(tempC)) return;
   
   uint32_t now = millis();
   
   // ===== DETERMINE TEMPERATURE TREND (every 500ms) =====
-  if ((now - g_heaterLastCheckMs[idx]) >= 500) {
-    if (!isnan(g_heaterLastTemp[idx])) {
+  if ((now - s.heaterLastCheckMs) >= 500) {
+    if (!isnan(s.heaterLastTemp)) {
       // Compare to previous reading
-      bool rising = (tempC > g_heaterLastTemp[idx]);
-      if (rising == g_heaterTempRising[idx]) {
+      bool rising = (tempC > s.heaterLastTemp);
+      if (rising == s.heaterTempRising) {
         // Same direction, accumulate confidence
-        if (g_heaterTrendSamples[idx] < 5) g_heaterTrendSamples[idx]++;
+        if (s.heaterTrendSamples < 5) s.heaterTrendSamples++;
       } else {
         // Direction changed, reset confidence
-        g_heaterTempRising[idx] = rising;
-        g_heaterTrendSamples[idx] = 1;
+        s.heaterTempRising = rising;
+        s.heaterTrendSamples = 1;
       }
     }
-    g_heaterLastTemp[idx] = tempC;
-    g_heaterLastCheckMs[idx] = now;
+    s.heaterLastTemp = tempC;
+    s.heaterLastCheckMs = now;
   }
   
   // ===== HEATER CONTROL =====
   // OFF threshold: 38°C (single threshold). Force OFF, but only log and command on state change.
   // GUARD: Never turn heater ON outside of WET warmup/post-warmup phase
-  static uint32_t s_lastHeaterLogMs[2] = {0, 0};
-  static bool s_lastHeaterStateOn[2] = {false, false};
   bool hwHeaterOn = heaterIsOn(idx);
 
-  if (tempC >= HEATER_WET_TEMP_THRESHOLD_C) {
+  float maxC = shoeRecipe(idx).heaterMaxC;
+  if (tempC >= maxC) {
     if (hwHeaterOn) {
       uint32_t nowMs = millis();
       // Log only on state change (heater turning off), not every call
-      bool shouldLog = s_lastHeaterStateOn[idx];  // Log only if it was on before
+      bool shouldLog = s.heaterLastOn;  // Log only if it was on before
       if (shouldLog) {
-        FSM_DBG_PRINT("SUB"); FSM_DBG_PRINT(idx);
+        FSM_DBG_PRINT(subLabel(idx));
         FSM_DBG_PRINT(": Heater OFF at ");
         FSM_DBG_PRINT(tempC, 1);
         FSM_DBG_PRINTLN("C (threshold reached)");
-        s_lastHeaterLogMs[idx] = nowMs;
+        s.heaterLastLogMs = nowMs;
       }
-      s_lastHeaterStateOn[idx] = false;
+      s.heaterLastOn = false;
       heaterRun(idx, false);
+      // Coasting: hand the heater power to another WET bay
+      if (HEATER_INTERLEAVE)
+        g_power.reduce(idx, FAN_DRAW_W);
     }
     return;
   }
   
   // ON condition: Turn ON only if temp is falling (not rising/stable)
   // This prevents the heater from chasing upward or oscillating
-  // GUARD: Only activate during WET phase warmup (when g_heaterWarmupDone is actually being used)
+  // GUARD: Only called by the WET script after warmup
   // Never turn ON during COOLING/DRY phases - heater must stay OFF
-  if (!heaterIsOn(idx) && tempC < HEATER_WET_TEMP_THRESHOLD_C) {
+  if (!heaterIsOn(idx) && tempC < maxC) {
     // Temperature below 39°C and heater is OFF
     // Only turn ON if we have confidence that temp is FALLING
-    bool shouldTurnOn = (g_heaterTrendSamples[idx] >= 2) && !g_heaterTempRising[idx];
-    
+    bool shouldTurnOn = (s.heaterTrendSamples >= 2) && !s.heaterTempRising;
+    if (HEATER_INTERLEAVE && !shouldTurnOn)
+      g_power.cancel(idx);  // no stale heater request while the shoe still warms
+    if (HEATER_INTERLEAVE && shouldTurnOn &&
+        !g_power.request(idx, WET_DRAW_W, waitPriority(idx), millis())) {
+      if (!s.heaterDenied) {
+        FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINTLN(": Heater ON deferred, power in use by another bay");
+        s.heaterDenied = true;
+      }
+      return;
+    }
+    s.heaterDenied = false;
+
     if (shouldTurnOn && !hwHeaterOn) {
       uint32_t nowMs = millis();
-      bool shouldLog = (s_lastHeaterStateOn[idx] == false) || (nowMs - s_lastHeaterLogMs[idx] >= 5000);
+      bool shouldLog = (s.heaterLastOn == false) || (nowMs - s.heaterLastLogMs >= 5000);
       if (shouldLog) {
-        FSM_DBG_PRINT("SUB"); FSM_DBG_PRINT(idx);
+        FSM_DBG_PRINT(subLabel(idx));
         FSM_DBG_PRINT(": Heater ON: temp ");
         FSM_DBG_PRINT(tempC, 1);
         FSM_DBG_PRINTLN("C falling, resuming until 39C");
-        s_lastHeaterLogMs[idx] = nowMs;
-        s_lastHeaterStateOn[idx] = true;
+        s.heaterLastLogMs = nowMs;
+        s.heaterLastOn = true;
       }
       heaterRun(idx, true);
       return;
@@ -259,22 +511,22 @@ static void maybeEarlyHeaterOff(uint8_t idx, uint32_t /*wetElapsedMs*/) {
 // Reset heater logging state when exiting WET phase
 // Called at phase boundaries to prevent stale state from affecting next cycle
 static void resetHeaterLoggingState(uint8_t idx) {
-  // We cannot directly reset static locals in maybeEarlyHeaterOff()
-  // So we ensure heater is OFF and clear all trend tracking
+  // Ensure the heater is OFF and forget the last logged command
   // This prevents log spam on re-entry to WET
+  g_shoes[idx].heaterLastOn = false;
   heaterRun(idx, false);
 }
 
 // Check if AH diff is consistently declining during stabilization
-static bool isAHDiffDeclining(int idx) {
-  if (g_coolingDiffSampleCount[idx] < 4) return false;  // Need at least 4 samples
+static bool isAHDiffDeclining(const CoolingScript &c) {
+  if (c.sampleCount < 4) return false;  // Need at least 4 samples
   
   // Check last 4 samples for declining trend
   int declineCount = 0;
   for (int i = 1; i < 4; i++) {
-    int currIdx = (g_coolingDiffSampleIdx[idx] - i + 6) % 6;
-    int prevIdx = (g_coolingDiffSampleIdx[idx] - i - 1 + 6) % 6;
-    if (g_coolingDiffSamples[idx][currIdx] < g_coolingDiffSamples[idx][prevIdx]) {
+    int currIdx = (c.sampleIdx - i + 6) % 6;
+    int prevIdx = (c.sampleIdx - i - 1 + 6) % 6;
+    if (c.samples[currIdx] < c.samples[prevIdx]) {
       declineCount++;
     }
   }
@@ -282,2041 +534,1424 @@ static bool isAHDiffDeclining(int idx) {
 }
 
 // Configure cooling motor duty and duration based on moisture level and retry status
-static void startCoolingPhase(int idx, bool isRetry) {
+static void startCoolingPhase(uint8_t idx, bool isRetry) {
+  ShoeContext &s = g_shoes[idx];
   // Turn heater OFF during COOLING: temperature needs to drop for shoes to cool down
   // (keeping heater ON was causing temperature to hit 43°C and re-evaporate moisture)
   heaterRun(idx, false);
   
-  // Clear heater warmup and trend state so heater stays OFF during COOLING
-  // This prevents maybeEarlyHeaterOff() from turning heater back ON
-  g_heaterWarmupStartMs[idx] = 0;
-  g_heaterWarmupDone[idx] = false;
-  g_heaterLastTemp[idx] = NAN;  // Reset trend tracking
-  g_heaterLastCheckMs[idx] = 0;
-  g_heaterTrendSamples[idx] = 0;
-  g_heaterTempRising[idx] = false;
-  
+  // Clear heater trend state so a later WET starts fresh
+  resetHeaterTrend(s);
+
   // CRITICAL: Also reset heater logging state to prevent spam on re-entry to WET
-  // This ensures the static s_lastHeaterStateOn[] in maybeEarlyHeaterOff is fresh
   resetHeaterLoggingState(idx);
 
-  const char *label = (idx == 0) ? "SUB1" : "SUB2";
+  [[maybe_unused]] const char *label = subLabel(idx);  // verbose logs only
   float coolingDiff = g_dhtAHDiff[idx];
 
-  // Base selections - shorter since heavy lifting done in WET phase
-  uint32_t durationMs = DRY_COOL_MS_BASE;
-  int dutyPercent = 70;  // Moderate circulation (was 80, reduced to 70 to prevent excessive reheating)
-
-  if (coolingDiff > 2.0f) {
-    // Still very wet after extended WET: moderate cooling
-    dutyPercent = 75;  // Increased from 50-60 (was 100) - balance evaporation with preventing reheating
-    durationMs = DRY_COOL_MS_SOAKED;  // 180s
-    FSM_DBG_VPRINT(label);
-    FSM_DBG_VPRINT(" COOLING: Still very wet (diff=");
-    FSM_DBG_VPRINT(coolingDiff);
-    FSM_DBG_VPRINTLN(") -> 75% duty, extended timing");
-  } else if (coolingDiff > 1.2f) {
-    // Moderately wet: moderate cooling
-    dutyPercent = 72;  // Increased from 50-55 (was 90)
-    durationMs = DRY_COOL_MS_WET;  // 150s
-    FSM_DBG_VPRINT(label);
-    FSM_DBG_VPRINT(" COOLING: Moderate (diff=");
-    FSM_DBG_VPRINT(coolingDiff);
-    FSM_DBG_VPRINTLN(") -> 72% duty, standard timing");
-  } else {
-    // Nearly dry: light circulation
-    dutyPercent = 70;  // Increased from 50 (was 80)
-    durationMs = DRY_COOL_MS_BASE;  // 90s
-    FSM_DBG_VPRINT(label);
-    FSM_DBG_VPRINT(" COOLING: Nearly dry (diff=");
-    FSM_DBG_VPRINT(coolingDiff);
-    FSM_DBG_VPRINTLN(") -> 70% duty, base timing");
-  }
-
-  // Retry path: moderate increase
+  // Base selections - shorter since heavy lifting done in WET phase: the
+  // recipe's band for the AH diff left after WET
+  const Recipe &r = recipe(s.recipe);
+  const CoolingBand &band = recipeCoolingBand(r, coolingDiff);
+  uint32_t durationMs = band.motorMs;
+  int dutyPercent = band.duty;
+  FSM_DBG_VPRINT(label);
+  FSM_DBG_VPRINT(" COOLING: diff=");
+  FSM_DBG_VPRINT(coolingDiff);
+  FSM_DBG_VPRINT(" -> ");
+  FSM_DBG_VPRINT(dutyPercent);
+  FSM_DBG_VPRINT("% duty, ");
+  FSM_DBG_VPRINT(durationMs / 1000);
+  FSM_DBG_VPRINTLN("s");
+
+  // Retry path: moderate increase, up to the wettest band's duty (capped
+  // there to prevent excessive reheating) and at least the middle band's time
   if (isRetry) {
-    if (dutyPercent < 75) dutyPercent = 75;  // Cap at 75% to prevent excessive reheating
-    if (durationMs < DRY_COOL_MS_WET) durationMs = DRY_COOL_MS_WET;  // Max 150s on retry
+    if (dutyPercent < r.cooling[0].duty) dutyPercent = r.cooling[0].duty;
+    if (durationMs < r.cooling[1].motorMs) durationMs = r.cooling[1].motorMs;
     FSM_DBG_VPRINT(label);
-    FSM_DBG_VPRINTLN(" COOLING: Retry -> boosting to 75% duty, extended timing");
+    FSM_DBG_VPRINTLN(" COOLING: Retry -> boosting duty, extended timing");
   }
 
   motorSetDutyPercent(idx, dutyPercent);
-  g_coolingMotorDurationMs[idx] = durationMs;
-  g_subCoolingStartMs[idx] = millis();
-  g_subCoolingStabilizeStartMs[idx] = 0;
-  g_coolingLocked[idx] = true;
-  g_coolingEarlyExit[idx] = false;
-  g_coolingDiffSampleIdx[idx] = 0;
-  g_coolingDiffSampleCount[idx] = 0;
+  s.coolingMotorDurationMs = durationMs;
+  s.coolingStartMs = millis();
+  CoolingScript &c = s.cooling;
+  c.phase = CoolingPhase::Motor;
+  c.sampleIdx = 0;
+  c.sampleCount = 0;
 }
 
 // LED status tracking
 static uint32_t g_ledBlinkMs = 0;  // Timestamp for LED blinking
 static bool g_ledBlinkState = false;  // Current blink state
 
-// Battery check timestamp for LowBattery state
-static uint32_t g_lastBatteryCheckMs = 0;
+static void markSubDone(uint8_t idx) {
+  g_subDoneMask |= 1u << idx;
+  if (g_subDoneMask == ALL_SUBS_MASK)
+    fsmPostEvent(Event::SubFSMDone);
+}
+
+// Post an event to the FSM mailbox. Wait-free; safe from any task or ISR.
+// Returns false if the same event was already pending (it coalesces).
+static bool fsmPostTarget(Event ev, uint8_t target, uint32_t arg) {
+#ifdef FSM_STATS
+  if (eventIndex(ev) < NUM_EVENT_BITS)
+    g_postUs[target][eventIndex(ev)] = micros();
+#endif
+  bool fresh = g_fsmMailbox.post(ev, target, arg);
+  // Notify even on coalesce: the task may be about to block with it pending
+  if (s_fsmTask) {
+    if (xPortInIsrContext()) {
+      BaseType_t woken = pdFALSE;
+      vTaskNotifyGiveFromISR(s_fsmTask, &woken);
+      portYIELD_FROM_ISR(woken);
+    } else {
+      xTaskNotifyGive(s_fsmTask);
+    }
+  }
+  return fresh;
+}
+
+static bool fsmPostEvent(Event ev) {
+  return fsmPostTarget(ev, FSM_TARGET_ALL, 0);
+}
+
+// Allow external tasks to post events to the FSM mailbox
+bool fsmExternalPost(Event ev) {
+  return fsmPostEvent(ev);
+}
+
+bool fsmExternalPostTo(uint8_t shoeIdx, Event ev, uint32_t arg) {
+  if (shoeIdx >= NUM_BAYS)
+    return false;
+  return fsmPostTarget(ev, 1 + shoeIdx, arg);
+}
+
+uint32_t fsmEventOverflowCount(Event ev) {
+  return g_fsmMailbox.overflowCount(ev);
+}
+
+//------------------------------------------------------------------------------
+// Sub-FSM run callbacks (referenced from the state tables below)
+//------------------------------------------------------------------------------
+
+// S_WAITING run: request heater + fan power and start WET once granted.
+// WAIT_POLICY ranks the waiting shoes (lower bay index on a tie); PowerBudget
+// ages each request so none is starved.
+static void subWaitingRun(uint8_t idx) {
+  ShoeContext &s = g_shoes[idx];
+
+  // Guard against repeated event posting (watchdog protection)
+  if (s.waitingEventPosted)
+    return;
+
+  if (!g_power.request(idx, WET_DRAW_W, waitPriority(idx), millis()))
+    return;  // over budget, or a higher-ranked shoe goes first
+
+  bool contested = false;  // another shoe is still waiting
+  for (uint8_t other = 0; other < NUM_BAYS; ++other)
+    contested |= other != idx && g_power.pending(other);
+  FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(contested ? ": WET power granted (priority), " : ": WET power granted, ");
+  FSM_DBG_PRINT(g_power.usedW()); FSM_DBG_PRINT("/"); FSM_DBG_PRINT(g_power.budgetW()); FSM_DBG_PRINT(" W after ");
+  FSM_DBG_PRINT((millis() - s.waitStartMs) / 1000); FSM_DBG_PRINT(" s queued, predicted cycle ");
+  FSM_DBG_PRINT(predictCycleMs(idx) / 1000); FSM_DBG_PRINTLN(" s");
+  s.waitingEventPosted = true;
+  fsmSubs.handleEvent(idx, Event::SubStart);
+}
+
+// True once a sensor pass newer than `seen` has completed (and records it)
+static bool newSensorSample(uint32_t &seen) {
+  uint32_t seq = g_dhtSampleSeq;
+  if (seq == seen)
+    return false;
+  seen = seq;
+  return true;
+}
+
+static bool wetWarmupHot(uint8_t idx) {
+  float t = shoeTempC(idx);  // Sensor 1 = shoe 0, sensor 2 = shoe 1
+  return !isnan(t) && t >= shoeRecipe(idx).heaterMaxC;
+}
+
+// Cold shoes get the extended warmup
+static bool wetWarmupCold(uint8_t idx) {
+  float t = shoeTempC(idx);
+  return !isnan(t) && t < shoeRecipe(idx).coldBelowC;
+}
+
+// Every 2 s after warmup: true if an AH-rate sample is due and valid
+static bool wetSampleDue(uint8_t idx, WetScript &w) {
+  uint32_t now = millis();
+  if ((uint32_t)(now - w.lastSampleMs) < 2000)
+    return false;
+  w.lastSampleMs = now;
+  float rate = g_dhtAHRate[idx];
+  // Reject NaN/Inf from sensor glitches; wait for the next valid rate
+  return !isnan(rate) && !isinf(rate);
+}
+
+// Before the peak: track the AH minimum and the rate trend. Returns true
+// once the evaporation peak has been detected (w.peakMs is set).
+static bool wetPeakReached(uint8_t idx, WetScript &w) {
+  ShoeContext &s = g_shoes[idx];
+  uint32_t now = millis();
+  uint32_t wetElapsed = (uint32_t)(now - s.wetStartMs);
+  float currentRate = g_dhtAHRate[idx];  // Use actual AH rate-of-change from motor control
+  float currentAHDiff = g_dhtAHDiff[idx];
+
+  // Track minimum AH diff seen (to detect true evaporation bottom)
+  if (wetElapsed >= AH_ACCEL_WARMUP_MS && currentAHDiff < w.minDiff) {
+    w.minDiff = currentAHDiff;
+    w.minDiffMs = now;
+  }
+
+  // Early peak detection: if AH has risen significantly above minimum, we passed the peak
+  // Adaptive gate by initial wetness
+  const RecipeTier &tier = shoeTier(idx);
+  float riseThreshold = tier.rise;
+  if (wetElapsed >= tier.riseMinMs && w.minDiff < s.initialWetDiff - 0.5f) {
+    // We've seen a significant drop (good evaporation happened)
+    float riseFromMin = currentAHDiff - w.minDiff;
+    if (riseFromMin > riseThreshold) {
+      // AH has risen >riseThreshold g/m^3 from minimum - we missed the peak!
+      FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(": WET RISE detection - min was ");
+      FSM_DBG_PRINT(w.minDiff, 2);
+      FSM_DBG_PRINT(" now ");
+      FSM_DBG_PRINT(currentAHDiff, 2);
+      FSM_DBG_PRINT(" (rose +");
+      FSM_DBG_PRINT(riseFromMin, 2);
+      FSM_DBG_PRINTLN(") -> peak passed, starting buffer");
+      w.peakMs = w.minDiffMs;  // Use time when minimum was seen
+      w.lastValidDiff = currentAHDiff;
+      heaterRun(idx, false);
+      return true;
+    }
+  }
+
+  // Peak detection using moving-average decline
+  if (wetElapsed < AH_ACCEL_WARMUP_MS)
+    return false;
+  w.rateHist[w.rateIdx] = currentRate;
+  w.rateIdx = (w.rateIdx + 1) % 8;
+  if (w.rateCount < 8) w.rateCount++;
+  if (w.rateCount < 6) // need enough samples
+    return false;
 
-static void markSubDone(int idx) {
-  if (idx == 0)
-    g_subDoneMask |= 1u;
-  else if (idx == 1)
-    g_subDoneMask |= 2u;
-  if (g_subDoneMask == 0x03)
-    fsmPostEvent(Event::SubFSMDone, false);
+  // Compute averages for two windows: recent (last 3) vs previous (prior 3)
+  float recentAvg = (w.rateHist[(w.rateIdx - 1 + 8) % 8] + w.rateHist[(w.rateIdx - 2 + 8) % 8] +
+                     w.rateHist[(w.rateIdx - 3 + 8) % 8]) / 3.0f;
+  float previousAvg = (w.rateHist[(w.rateIdx - 4 + 8) % 8] + w.rateHist[(w.rateIdx - 5 + 8) % 8] +
+                       w.rateHist[(w.rateIdx - 6 + 8) % 8]) / 3.0f;
+
+  float avgChange = recentAvg - previousAvg;
+  FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(": WET avg recent="); FSM_DBG_PRINT(recentAvg);
+  FSM_DBG_PRINT(" prevAvg="); FSM_DBG_PRINT(previousAvg);
+  FSM_DBG_PRINT(" change="); FSM_DBG_PRINT(avgChange);
+  FSM_DBG_PRINT(" diff="); FSM_DBG_PRINT(currentAHDiff, 2);
+  FSM_DBG_PRINTLN("g/m^3");
+
+  if (avgChange < AH_RATE_DECLINE_THRESHOLD) {
+    w.negCount++;
+  } else {
+    w.negCount = 0;
+  }
+
+  // Robust peak detection with the tier's time and rate gates (wetter shoes
+  // wait longer and accept a higher rate)
+  uint32_t minPeakTimeMs = tier.peakMinMs;
+  float peakRateThreshold = tier.peakRate;
+
+  bool decliningEnough = (w.negCount >= MIN_CONSECUTIVE_NEGATIVE) && (avgChange < -0.05f);
+  bool rateIsLow = (recentAvg < peakRateThreshold);
+  bool hasSpentEnoughTime = (wetElapsed >= minPeakTimeMs);
+  if (!(decliningEnough && rateIsLow && hasSpentEnoughTime))
+    return false;
+
+  FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(": WET peak (rate=");
+  FSM_DBG_PRINT(recentAvg, 2);
+  FSM_DBG_PRINT("<");
+  FSM_DBG_PRINT(peakRateThreshold, 2);
+  FSM_DBG_PRINT(", time=");
+  FSM_DBG_PRINT(wetElapsed/1000);
+  FSM_DBG_PRINT("s>=");
+  FSM_DBG_PRINT(minPeakTimeMs/1000);
+  FSM_DBG_PRINT("s) -> ");
+  FSM_DBG_PRINT(s.peakBufferMs/1000);
+  FSM_DBG_PRINTLN("s buffer");
+  w.peakMs = now;
+  w.lastValidDiff = currentAHDiff;
+  // Heater continues during peak detection for extra heating time
+  FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINTLN(": WET peak detected, entering post-peak buffer (heater continues)");
+  return true;
 }
 
-// Helper to post an event to the FSM queue (safe from task context)
-static bool fsmPostEvent(Event ev, bool broadcastAll = false) {
-  if (!g_fsmEventQ)
+// Safety timeout: no peak within the wetness-dependent WET limit
+static bool wetTimedOut(uint8_t idx) {
+  ShoeContext &s = g_shoes[idx];
+  uint32_t wetElapsed = (uint32_t)(millis() - s.wetStartMs);
+
+  // Maximum WET duration from the initial wetness tier
+  uint32_t wetMaxMs = shoeTier(idx).wetMaxMs;
+  if (wetElapsed < wetMaxMs)
     return false;
-  // duplicate-guard for Start/SubStart
-  static Event lastEv = Event::None;
-  static uint32_t lastEvMs = 0;
-  if (ev == Event::StartPressed || ev == Event::SubStart) {
-    uint32_t now = millis();
-    if (lastEv == ev && (uint32_t)(now - lastEvMs) < DEBOUNCE_MS)
+
+  FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(": WET timeout (no peak detected after ");
+  FSM_DBG_PRINT(wetElapsed/1000);
+  FSM_DBG_PRINT("s, limit=");
+  FSM_DBG_PRINT(wetMaxMs/1000);
+  FSM_DBG_PRINTLN("s) -> COOLING");
+  return true;
+}
+
+// After the peak: true once the post-peak buffer (and any extension) is over
+// and the minimum WET duration and AH sanity checks pass.
+static bool wetBufferDone(uint8_t idx, WetScript &w) {
+  ShoeContext &s = g_shoes[idx];
+  uint32_t now = millis();
+  uint32_t wetElapsed = (uint32_t)(now - s.wetStartMs);
+  uint32_t bufferElapsed = (uint32_t)(now - w.peakMs);
+  float currentAHDiff = g_dhtAHDiff[idx];
+
+  // SAFETY CHECK: Verify AH diff hasn't dropped to unexpected low values (sensor noise/glitch)
+  if (!isnan(currentAHDiff) && currentAHDiff > 0.1f)
+    w.lastValidDiff = currentAHDiff;
+
+  // Still in post-peak buffer period
+  if (bufferElapsed < s.peakBufferMs) {
+    // Continue monitoring evaporation during buffer
+    uint32_t bufferRemaining = s.peakBufferMs - bufferElapsed;
+    FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(": WET in post-peak buffer (");
+    FSM_DBG_PRINT(bufferRemaining);
+    FSM_DBG_PRINT("ms remaining, diff=");
+    FSM_DBG_PRINT(currentAHDiff, 2);
+    FSM_DBG_PRINTLN("g/m^3)");
+    return false;
+  }
+
+  // Buffer period expired - check safety conditions before exiting to COOLING
+  uint32_t minDurationRemaining = (wetElapsed >= s.wetMinDurationMs) ? 0 : (s.wetMinDurationMs - wetElapsed);
+
+  // Dynamic buffer extension: if current AH rose above initial, extend buffer duration
+  // This handles shoes that got wetter during WET phase
+  if (currentAHDiff > s.initialWetDiff + 0.5f) {
+    // Shoe got significantly wetter during WET phase - extend buffer
+    // Use the tier buffer for the CURRENT moisture level
+    uint32_t adaptiveBufferMs = recipeTier(shoeRecipe(idx), currentAHDiff).bufferMs;
+
+    // Re-check if buffer has actually expired with the new duration
+    if (bufferElapsed < adaptiveBufferMs) {
+      uint32_t adaptiveRemaining = adaptiveBufferMs - bufferElapsed;
+      FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(": WET buffer extended (moisture rose: ");
+      FSM_DBG_PRINT(s.initialWetDiff, 1);
+      FSM_DBG_PRINT(" -> ");
+      FSM_DBG_PRINT(currentAHDiff, 1);
+      FSM_DBG_PRINT("g/m^3), remaining=");
+      FSM_DBG_PRINT(adaptiveRemaining);
+      FSM_DBG_PRINTLN("ms");
+      profMark(idx, CyclePhase::BufferRise, PhaseEnd::Time);
+      return false;
+    }
+  }
+
+  // Temperature-based buffer hold: if shoe is still hot, extend buffer by 30s
+  float tC = shoeTempC(idx);
+  if (!isnan(tC) && tC >= WET_BUFFER_TEMP_HOT_C) {
+    if (bufferElapsed < s.peakBufferMs + WET_BUFFER_TEMP_EXTEND_MS) {
+      uint32_t remain = (s.peakBufferMs + WET_BUFFER_TEMP_EXTEND_MS) - bufferElapsed;
+      FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(": WET buffer temp-hold (t=");
+      FSM_DBG_PRINT(tC, 1);
+      FSM_DBG_PRINT("C), remaining=");
+      FSM_DBG_PRINT(remain);
+      FSM_DBG_PRINTLN("ms");
+      profMark(idx, CyclePhase::BufferHot, PhaseEnd::Time);
       return false;
-    lastEv = ev;
-    lastEvMs = now;
+    }
   }
-  EventMsg m{ev, broadcastAll};
-  return xQueueSend(g_fsmEventQ, &m, 0) == pdTRUE;
+
+  // SAFETY: Require AH diff to still be reasonable (not accidental low reading)
+  bool safeAHLevel = (currentAHDiff > AH_DIFF_SAFETY_MARGIN) || (w.lastValidDiff > AH_DIFF_SAFETY_MARGIN + 0.2f);
+  bool minDurationMet = (minDurationRemaining == 0);
+
+  if (minDurationMet && safeAHLevel) {
+    FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(": WET peak + buffer complete, diff=");
+    FSM_DBG_PRINT(currentAHDiff, 2);
+    FSM_DBG_PRINTLN("g/m^3 -> transition to COOLING");
+    return true;
+  } else if (minDurationMet) {
+    // AH diff dropped too low - might be sensor glitch, wait longer
+    FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(": WET safety check - diff dropped to ");
+    FSM_DBG_PRINT(currentAHDiff, 2);
+    FSM_DBG_PRINTLN("g/m^3 (below safety margin), waiting for stabilization...");
+  } else {
+    // Minimum duration not yet reached
+    FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(": WET waiting for minimum duration (");
+    FSM_DBG_PRINT(minDurationRemaining);
+    FSM_DBG_PRINT("ms remaining, diff=");
+    FSM_DBG_PRINT(currentAHDiff, 2);
+    FSM_DBG_PRINTLN("g/m^3)");
+  }
+  profMark(idx, CyclePhase::BufferMin, PhaseEnd::Time);
+  return false;
 }
 
-// Allow external tasks to post events to the FSM queue
-bool fsmExternalPost(Event ev) {
-  return fsmPostEvent(ev, false);
+// S_WET script: WARMUP (30-50s at 60% motor + heater), then trend-gated heating
+// until the evaporation peak, then the post-peak buffer, then COOLING.
+static void subWetRun(uint8_t idx) {
+  ShoeContext &s = g_shoes[idx];
+  WetScript &w = s.wet;
+  PS_BEGIN(w.ps);
+
+  w.peakMs = 0;
+  w.minDiff = s.initialWetDiff;  // Start tracking minimum from initial value
+  w.minDiffMs = s.wetStartMs;
+  w.lastValidDiff = s.initialWetDiff;
+  w.negCount = 0;
+  w.rateIdx = w.rateCount = 0;
+  // Resumed: skip the stages already done before the reset. Warmup is redone
+  // if it was cut short; the peak keeps its age for the buffer.
+  w.skipWarmup = s.resuming && s.resume.phase > static_cast<uint8_t>(CyclePhase::Warmup);
+  w.skipPrePeak = s.resuming && s.resume.phase >= static_cast<uint8_t>(CyclePhase::Buffer);
+  if (w.skipPrePeak)
+    w.peakMs = millis() - s.resume.peakAgoMs;
+  s.resuming = false;
+
+  // ==================== WARMUP PHASE ====================
+  // Heater warms the shoe WITHOUT trend-gated control interference. Motor runs
+  // at a fixed 60% to avoid friction heating.
+  // NOTE: Do NOT call motorStart() yet - only set duty directly at 60%
+  // motorStart() initializes PID which immediately overrides our 60% setpoint
+  if (!w.skipWarmup) {
+    w.lastSampleMs = millis();  // warmup start
+    w.seenSeq = g_dhtSampleSeq - 1;  // check the current sample on the first resume
+    heaterRun(idx, true);
+    motorSetDutyPercent(idx, 60);
+    FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINTLN(": Warmup phase START (30-50s at 60% motor + heater)");
+
+    // The shoe temperature only moves with a new sensor pass
+    PS_WAIT_UNTIL(w.ps, (newSensorSample(w.seenSeq) && wetWarmupHot(idx)) ||
+                            (uint32_t)(millis() - w.lastSampleMs) >= shoeRecipe(idx).warmupMinMs);
+    if (!wetWarmupHot(idx) && wetWarmupCold(idx)) {
+      FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(": Cold shoe detected (");
+      FSM_DBG_PRINT(shoeTempC(idx), 1);
+      FSM_DBG_PRINT("C) -> extended warmup "); FSM_DBG_PRINT(shoeRecipe(idx).warmupColdMs / 1000);
+      FSM_DBG_PRINTLN("s");
+      PS_WAIT_UNTIL(w.ps, (newSensorSample(w.seenSeq) && (wetWarmupHot(idx) || !wetWarmupCold(idx))) ||
+                              (uint32_t)(millis() - w.lastSampleMs) >= shoeRecipe(idx).warmupColdMs);
+    }
+    if (wetWarmupHot(idx)) {
+      FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(": Warmup threshold reached (");
+      FSM_DBG_PRINT(shoeTempC(idx), 1);
+      FSM_DBG_PRINTLN("C) -> heater OFF, switch to trend-gated control");
+    } else {
+      FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINTLN(": Warmup time complete -> transition to trend-gated WET (PID motor control)");
+    }
+  }
+  profMark(idx, CyclePhase::PrePeak,
+           w.skipWarmup ? PhaseEnd::None : wetWarmupHot(idx) ? PhaseEnd::Hot : PhaseEnd::Time);
+  // Heater OFF at the end of warmup; trend gating manages it from here
+  heaterRun(idx, false);
+  motorStart(idx);
+  w.lastSampleMs = millis();
+
+  // ==================== TREND-GATED HEATING UNTIL THE PEAK ====================
+  // Sample the AH rate every 2 s; wait AH_ACCEL_WARMUP_MS after WET start
+  // before looking for a decline
+  while (!w.skipPrePeak) {
+    PS_YIELD(w.ps);
+    maybeEarlyHeaterOff(idx);
+    if (!wetSampleDue(idx, w))
+      continue;
+    if (wetPeakReached(idx, w))
+      break;
+    if (wetTimedOut(idx)) {
+      heaterRun(idx, false);
+      motorStop(idx);
+      profMark(idx, CyclePhase::Cooling, PhaseEnd::Timeout);
+      fsmSubs.handleEvent(idx, Event::SubStart);
+      PS_EXIT(w.ps);
+    }
+  }
+
+  // ==================== POST-PEAK BUFFER ====================
+  profMark(idx, CyclePhase::Buffer, w.skipPrePeak ? PhaseEnd::None : PhaseEnd::Peak);
+  for (;;) {
+    PS_YIELD(w.ps);
+    maybeEarlyHeaterOff(idx);
+    if (wetSampleDue(idx, w) && wetBufferDone(idx, w))
+      break;
+  }
+  profMark(idx, CyclePhase::Cooling, PhaseEnd::Time);
+  fsmSubs.handleEvent(idx, Event::SubStart);
+  PS_END(w.ps);
 }
 
-static bool readStart() {
-  static bool last = HIGH;
-  static uint32_t t0 = 0;
-  bool raw = digitalRead(START_PIN);
-  if (raw != last && (millis() - t0) > DEBOUNCE_MS) {
-    t0 = millis();
-    last = raw;
-    return raw == LOW;
+// Leaving COOLING for DRY: the script raises its own SubStart (see the
+// coolingFinished guard). `why` ends the current profiled phase.
+static void coolingAdvance(uint8_t idx, CoolingScript &c, PhaseEnd why) {
+  profMark(idx, CyclePhase::DryWait, why);
+  g_shoes[idx].coolingStartMs = 0;
+  c.phase = CoolingPhase::Finished;
+  fsmSubs.handleEvent(idx, Event::SubStart);
+}
+
+// Check if shoe is already dry, rejecting sudden drops as sensor glitches
+static bool coolingAlreadyDry(uint8_t idx, CoolingScript &c) {
+  float tempCurr = shoeTempC(idx);
+  bool tempGlitch = !isnan(tempCurr) && !isnan(c.lastTemp) && tempCurr < c.lastTemp - 4.0f;
+  float earlyDiff = g_dhtAHDiff[idx];
+  bool diffGlitch = !isnan(earlyDiff) && !isnan(c.lastDiff) &&
+                    earlyDiff < c.lastDiff - MAX_AH_DELTA_PER_SAMPLE;
+
+  if (!tempGlitch && !diffGlitch && earlyDiff <= AH_DRY_THRESHOLD) {
+    FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(": COOLING early dry-check -> already dry (diff=");
+    FSM_DBG_PRINT(earlyDiff);
+    FSM_DBG_PRINTLN("), advancing immediately");
+    return true;
   }
+  if (!isnan(tempCurr)) c.lastTemp = tempCurr;
+  if (!isnan(earlyDiff)) c.lastDiff = earlyDiff;
   return false;
 }
 
-static bool readReset() {
-  static bool last = HIGH;
-  static uint32_t t0 = 0;
-  bool raw = digitalRead(RESET_PIN);
-  if (raw != last && (millis() - t0) > DEBOUNCE_MS) {
-    t0 = millis();
-    last = raw;
-    return raw == LOW;
+// One motor-phase tick: duty follows the shoe-vs-ambient delta, and the phase
+// is extended (bounded) while the shoe is still hot. Returns false once the
+// motor phase is over. The delta-to-duty steps are airflow physics and stay
+// the same for every recipe; the recipe sets the phase's length and the
+// starting duty (CoolingBand).
+static bool coolingMotorTick(uint8_t idx, CoolingScript &c) {
+  ShoeContext &s = g_shoes[idx];
+  uint32_t nowMs = millis();
+  uint32_t motorElapsed = (uint32_t)(nowMs - s.coolingStartMs);
+  float tempC = shoeTempC(idx);
+  float ambC = g_dhtTemp[0];
+  float targetC = (!isnan(ambC) ? (ambC + COOLING_AMBIENT_DELTA_C) : COOLING_TEMP_RELEASE_C);
+  PhaseEnd why = PhaseEnd::Time;
+
+  // Goal: Use motor to cool when shoe is HOT; OFF when ambient is warmer (passive cooling/heating sufficient)
+  // Heater is already OFF; motor circulation is the ONLY cooling mechanism
+  if (!isnan(tempC) && !isnan(ambC)) {
+    float delta = tempC - ambC;  // Positive = shoe hotter, negative = ambient hotter
+    int duty = 0;  // Default: motor OFF
+
+    if (delta > 5.0f) {
+      // Shoe much hotter than ambient: aggressive motor cooling needed
+      duty = 90;  // Increased to speed cooling
+    } else if (delta > 2.0f) {
+      // Shoe moderately hotter: medium-high motor speed
+      duty = 75;  // Increased from 60
+    } else if (delta > 0.5f) {
+      // Shoe slightly hotter: ensure meaningful airflow
+      duty = 55;  // Increased from 40
+    }
+    // If delta <= 0.5: ambient is at least as warm as shoe, motor OFF (duty = 0)
+
+    motorSetDutyPercent(idx, duty);
+  } else if (!isnan(tempC) && tempC >= COOLING_TEMP_FAN_BOOST_ON) {
+    // Fallback: high shoe temp detected, use moderate cooling (60%)
+    motorSetDutyPercent(idx, 60);
+  } else {
+    // Safety: if can't determine temperature reliably, use low motor (40%)
+    motorSetDutyPercent(idx, 40);
+  }
+  if (motorElapsed < s.coolingMotorDurationMs) {
+    return true; // Still in motor-run phase
+  }
+
+  // If motor phase time elapsed but shoe is still hot, extend motor phase (bounded to prevent watchdog timeout)
+  if (!isnan(tempC) && tempC > targetC) {
+    // Hard timeout check: prevent indefinite motor running that could cause watchdog reset
+    if (motorElapsed >= COOLING_MOTOR_ABSOLUTE_MAX_MS) {
+      FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(": COOLING -> hard motor timeout (");
+      FSM_DBG_PRINT(motorElapsed);
+      FSM_DBG_PRINTLN("ms) reached, forcing stabilization");
+      // Force transition to stabilization immediately but keep motor at low duty for airflow
+      // The fan keeps running, so the bay keeps its fan share until COOLING exits
+      motorSetDutyPercent(idx, 60);
+      profMark(idx, CyclePhase::Stabilize, PhaseEnd::Timeout);
+      return false;
+    }
+    if (motorElapsed < s.coolingMotorDurationMs + COOLING_TEMP_EXTEND_MAX_MS) {
+      if ((uint32_t)(nowMs - c.lastHoldLogMs) >= 10000u || c.lastHoldLogMs == 0) {
+        c.lastHoldLogMs = nowMs;
+        FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(": COOLING hold - temp=");
+        FSM_DBG_PRINT(tempC, 1);
+        FSM_DBG_PRINT("C, target=");
+        FSM_DBG_PRINT(targetC, 1);
+        FSM_DBG_PRINTLN("C, extending motor run");
+      }
+      // Adjust motor duty based on current temp delta during extension
+      float delta = tempC - ambC;
+      if (delta > 5.0f) {
+        motorSetDutyPercent(idx, 80);  // Still hot, use high duty
+      } else if (delta > 2.0f) {
+        motorSetDutyPercent(idx, 60);  // Moderately hot
+      } else {
+        motorSetDutyPercent(idx, 40);  // Just barely above target
+      }
+      profMark(idx, CyclePhase::CoolingHold, PhaseEnd::Time);
+      return true;
+    }
+    // Max extension reached: force stabilization to prevent infinite watchdog timeout
+    FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(": COOLING -> max motor extension (");
+    FSM_DBG_PRINT(motorElapsed);
+    FSM_DBG_PRINTLN("ms) reached, forcing stabilization to prevent watchdog");
+    why = PhaseEnd::Timeout;
   }
+
+  FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINTLN(": COOLING -> motor phase done, starting stabilization");
+  motorStop(idx);
+  g_power.release(idx);
+  profMark(idx, CyclePhase::Stabilize, why);
   return false;
 }
 
-// Variadic broadcast helper
-template <typename StateT, typename EventT>
-static void broadcast(EventT ev, StateMachine<StateT, EventT> &first) {
-  first.handleEvent(ev);
+// Stabilization complete: dry-check with an adaptive threshold. Returns true
+// if the shoe is still wet.
+static bool coolingStillWet(uint8_t idx, CoolingScript &c) {
+  float diff = g_dhtAHDiff[idx];
+  bool isDeclining = isAHDiffDeclining(c);
+  float threshold = isDeclining ? AH_DRY_THRESHOLD_LENIENT : AH_DRY_THRESHOLD;
+  // Use median of last 3 stabilization samples if available to reduce noise
+  float evalDiff = diff;
+  if (c.sampleCount >= 3) {
+    float a = c.samples[(c.sampleIdx - 1 + 6) % 6];
+    float b = c.samples[(c.sampleIdx - 2 + 6) % 6];
+    float cc = c.samples[(c.sampleIdx - 3 + 6) % 6];
+    // median of a,b,cc
+    float minab = (a < b) ? a : b;
+    float maxab = (a > b) ? a : b;
+    float med = (cc < minab) ? minab : (cc > maxab ? maxab : cc);
+    evalDiff = med;
+  }
+  bool stillWet = (evalDiff > threshold);
+  // Temperature guard: don't declare dry if still warm (> 36.5C)
+  float tC_final = shoeTempC(idx);
+  float tC_amb = g_dhtTemp[0];
+  float tC_target = (!isnan(tC_amb) ? (tC_amb + COOLING_AMBIENT_DELTA_C) : (COOLING_TEMP_RELEASE_C - 0.5f));
+  if (!isnan(tC_final) && tC_final > tC_target) {
+    stillWet = true;
+  }
+  FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(": COOLING stabilization done -> dry-check, diff=");
+  FSM_DBG_PRINT(evalDiff);
+  FSM_DBG_PRINT(isDeclining ? " (declining, lenient threshold=" : " (threshold=");
+  FSM_DBG_PRINT(threshold);
+  FSM_DBG_PRINTLN(")");
+  return stillWet;
 }
-template <typename StateT, typename EventT, typename... Fs>
-static void broadcast(EventT ev, StateMachine<StateT, EventT> &first, Fs &...rest) {
-  first.handleEvent(ev);
-  broadcast<StateT, EventT>(ev, rest...);
+
+// One re-evap tick (heater + fan power held): heater bang-bang, fixed motor duty and
+// the rise/timeout exit gates. Returns true when the cycle is over.
+static bool reEvapTick(uint8_t idx, CoolingScript &c) {
+  const Recipe &r = shoeRecipe(idx);
+  float t = shoeTempC(idx);
+  if (!isnan(t) && t >= r.heaterMaxC) {
+    heaterRun(idx, false);
+  } else {
+    heaterRun(idx, true);
+  }
+  motorSetDutyPercent(idx, RE_EVAP_MOTOR_DUTY);
+  uint32_t elapsed = (uint32_t)(millis() - c.markMs);
+  float d = g_dhtAHDiff[idx];
+  if (!isnan(d) && d < c.reEvapMinDiff) c.reEvapMinDiff = d;
+  // Adaptive lenient gates from the initial wetness tier
+  const RecipeTier &tier = shoeTier(idx);
+  c.reEvapTimedOut = (elapsed >= r.reEvapMaxMs);
+  bool risePassed = (elapsed >= tier.reEvapMinMs) && (d - c.reEvapMinDiff > tier.reEvapRise);
+  return c.reEvapTimedOut || risePassed;
+}
+
+// S_COOLING script: motor phase, stabilization with AH sampling, dry-check;
+// a wet result runs a short RE-EVAP cycle and starts over. The entry action
+// has already called startCoolingPhase().
+static void subCoolingRun(uint8_t idx) {
+  ShoeContext &s = g_shoes[idx];
+  CoolingScript &c = s.cooling;
+  PS_BEGIN(c.ps);
+
+  c.lastTemp = c.lastDiff = NAN;
+  c.lastHoldLogMs = 0;
+
+  for (;;) {
+    // ================= MOTOR PHASE =================
+    // The heater is re-sent OFF every tick outside RE-EVAP to ensure it stays OFF
+    while (!c.skipMotor) {
+      PS_YIELD(c.ps);
+      heaterRun(idx, false);
+      if (coolingAlreadyDry(idx, c)) {
+        motorStop(idx);
+        coolingAdvance(idx, c, PhaseEnd::Dry);
+        PS_EXIT(c.ps);
+      }
+      if (!coolingMotorTick(idx, c))
+        break;
+    }
+    if (c.skipMotor) {
+      c.skipMotor = false;
+      profMark(idx, CyclePhase::Stabilize, PhaseEnd::None);
+    }
+
+    // ================= STABILIZATION =================
+    // After a hard motor timeout the motor keeps its low duty for airflow
+    c.phase = CoolingPhase::Stabilize;
+    c.markMs = c.sampleMs = millis();
+    for (;;) {
+      PS_YIELD(c.ps);
+      heaterRun(idx, false);
+      if (coolingAlreadyDry(idx, c)) {
+        motorStop(idx);
+        coolingAdvance(idx, c, PhaseEnd::Dry);
+        PS_EXIT(c.ps);
+      }
+      if ((uint32_t)(millis() - c.markMs) >= shoeRecipe(idx).stabilizeMs)
+        break;
+      // Sample AH diff every 15 seconds during stabilization
+      if ((uint32_t)(millis() - c.sampleMs) >= 15000) {
+        c.sampleMs = millis();
+        c.samples[c.sampleIdx] = g_dhtAHDiff[idx];
+        c.sampleIdx = (c.sampleIdx + 1) % 6;
+        if (c.sampleCount < 6) c.sampleCount++;
+      }
+    }
+
+    if (!coolingStillWet(idx, c)) {
+      FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINTLN(": COOLING dry-check -> dry, advancing to DRY");
+      coolingAdvance(idx, c, PhaseEnd::Time);
+      PS_EXIT(c.ps);
+    }
+
+    // ================= RE-EVAP SHORT CYCLE =================
+    profMark(idx, CyclePhase::ReEvapWait, PhaseEnd::Wet);
+    FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINTLN(": COOLING -> invoking RE-EVAP short cycle");
+    s.coolingStartMs = 0;
+    c.phase = CoolingPhase::ReEvap;
+    c.reEvapMinDiff = g_dhtAHDiff[idx];
+    // Acquire heater + fan power first - don't waste heater power if the motor can't run
+    for (;;) {
+      PS_YIELD(c.ps);
+      if (g_power.request(idx, WET_DRAW_W, waitPriority(idx), millis()))
+        break;
+      heaterRun(idx, false);
+    }
+    profMark(idx, CyclePhase::ReEvap, PhaseEnd::Granted);
+    c.markMs = millis();  // Start the timer only once powered
+    FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINTLN(": RE-EVAP power granted, timer started");
+    motorStart(idx);
+    s.motorStarted = true;
+    while (!reEvapTick(idx, c))
+      PS_YIELD(c.ps);
+
+    FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(": RE-EVAP done (" ); FSM_DBG_PRINT(c.reEvapTimedOut ? "timeout" : "rise"); FSM_DBG_PRINTLN(") -> back to COOLING");
+    heaterRun(idx, false);
+    g_power.release(idx);
+    // Limit re-evap retries to prevent infinite loops
+    if (c.reEvapTimedOut && ++c.reEvapRetries >= MAX_RE_EVAP_RETRIES) {
+      FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(": MAX RE-EVAP RETRIES (");
+      FSM_DBG_PRINT(c.reEvapRetries);
+      FSM_DBG_PRINTLN(") reached, forcing DRY");
+      motorStop(idx);
+      coolingAdvance(idx, c, PhaseEnd::Timeout);  // Force to DRY
+      PS_EXIT(c.ps);
+    }
+    // Restart COOLING motor phase fresh (retry semantics)
+    profMark(idx, CyclePhase::Cooling, c.reEvapTimedOut ? PhaseEnd::Timeout : PhaseEnd::Rise);
+    startCoolingPhase(idx, true);
+  }
+  PS_END(c.ps);
 }
 
 //------------------------------------------------------------------------------
 // Configure all transitions and run-callbacks
 //------------------------------------------------------------------------------
-static void setupStateMachines() {
-  // Transition tables
-  Transition<GlobalState, Event> global_trans[] = {
-      {GlobalState::Idle, Event::StartPressed, GlobalState::Detecting,
-       []() { FSM_DBG_PRINTLN("GLOBAL: Detecting start"); }},
-      {GlobalState::Detecting, Event::SensorTimeout, GlobalState::Checking,
-       []() { FSM_DBG_PRINTLN("GLOBAL: Sensor timeout -> Checking"); }},
-      {GlobalState::Checking, Event::StartPressed, GlobalState::Running,
-       []() { FSM_DBG_PRINTLN("GLOBAL: Checking -> Running"); }},
-      {GlobalState::Checking, Event::BatteryLow, GlobalState::LowBattery,
-       []() { FSM_DBG_PRINTLN("GLOBAL: Battery low -> LowBattery"); }},
-      {GlobalState::LowBattery, Event::BatteryRecovered, GlobalState::Idle,
-       []() { FSM_DBG_PRINTLN("GLOBAL: Battery recovered -> Idle"); }},
-      {GlobalState::Running, Event::SubFSMDone, GlobalState::Done,
-       []() { FSM_DBG_PRINTLN("GLOBAL: All subs done -> Done"); }},
-      {GlobalState::Idle, Event::Error, GlobalState::Error,
-       []() { FSM_DBG_PRINTLN("GLOBAL: Error"); }},
-  };
+// Catch-all ResetPressed actions (one table row per state)
+static void onSubReset(uint8_t idx) {
+  g_subDoneMask &= ~(1u << idx);
+  g_power.release(idx);
+}
 
-  Transition<SubState, Event> sub1_trans[] = {
-      {SubState::S_IDLE, Event::Shoe0InitWet, SubState::S_WAITING,
-       []() { FSM_DBG_PRINTLN("SUB1: S_IDLE -> S_WAITING (wet shoe)"); }},
-      {SubState::S_IDLE, Event::Shoe0InitDry, SubState::S_DRY,
-       []() { FSM_DBG_PRINTLN("SUB1: S_IDLE -> S_DRY (dry shoe)"); }},
-      // S_WAITING -> S_WET (when lock acquired)
-      {SubState::S_WAITING, Event::SubStart, SubState::S_WET,
-       []() { FSM_DBG_PRINTLN("SUB1: S_WAITING -> S_WET (lock acquired)"); }},
-      // New flow: S_WET -> S_COOLING (heater off, motor continues) -> S_DRY
-      {SubState::S_WET, Event::SubStart, SubState::S_COOLING,
-       []() { FSM_DBG_PRINTLN("SUB1: Wet→Cooling (SubStart)"); }},
-      {SubState::S_COOLING, Event::DryCheckFailed, SubState::S_WAITING,
-       []() { FSM_DBG_PRINTLN("SUB1: Cooling->Waiting (DryCheckFailed - return to queue)"); }},
-      {SubState::S_COOLING, Event::SubStart, SubState::S_DRY,
-       []() { FSM_DBG_PRINTLN("SUB1: Cooling→Dry (SubStart)"); }},
-      {SubState::S_DRY, Event::SubStart, SubState::S_DONE,
-       []() {
-         FSM_DBG_PRINTLN("SUB1: Dry→Done (SubStart)");
-         markSubDone(0);
-       }},
-      // If dry-check fails, return to waiting queue
-      {SubState::S_DRY, Event::DryCheckFailed, SubState::S_WAITING,
-       []() { FSM_DBG_PRINTLN("SUB1: Dry->Waiting (DryCheckFailed - return to queue)"); }},
+// WET -> COOLING; an addressed SubStart carries the motor task's reason
+static void onWetAdvance(uint8_t idx) {
+  switch (static_cast<AdvanceReason>(g_eventArg)) {
+  case AdvanceReason::DryThreshold:
+    FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINTLN(": WET advanced by motor task (dry threshold)");
+    profMark(idx, CyclePhase::Cooling, PhaseEnd::Dry);
+    break;
+  case AdvanceReason::SafetyTimeout:
+    FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINTLN(": WET advanced by motor task (safety timeout)");
+    profMark(idx, CyclePhase::Cooling, PhaseEnd::Timeout);
+    break;
+  default:
+    break;
+  }
+}
+
+// DRY -> DONE on the (single, shared) UV timer
+static void onSubUvDone(uint8_t idx) {
+  FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINTLN(": UV timer expired in DRY, advancing to DONE");
+  markSubDone(idx);
+  // Mark UV complete so we don't restart it, and free the start guard
+  g_uvComplete = true;
+  g_uvStartGuard = false;
+  g_power.release(POWER_CLIENT_UV);
+  profMark(idx, CyclePhase::None, PhaseEnd::Time);
+}
+
+// Transition guards: a guarded row only fires while its guard returns true
+static bool hasWetPower(uint8_t idx) {
+  return g_power.granted(idx) >= WET_DRAW_W;
+}
+// COOLING advances only when its own script has finished
+static bool coolingFinished(uint8_t idx) {
+  return g_shoes[idx].cooling.phase == CoolingPhase::Finished;
+}
+static bool allSubsIn(SubState st) {
+  for (size_t i = 0; i < NUM_BAYS; ++i)
+    if (fsmSubs.getState(i) != st)
+      return false;
+  return true;
+}
+static bool allSubsDone() {
+  return allSubsIn(SubState::S_DONE);
+}
+// The shared UV starts once every shoe is waiting in DRY
+static bool allSubsDry() {
+  return allSubsIn(SubState::S_DRY);
+}
+
+// A paused cycle resumes where it stopped: move every time base the WAITING,
+// WET and COOLING logic measures against forward by the pause
+static void shiftShoeClocks(ShoeContext &s, uint32_t ms) {
+  auto shift = [ms](uint32_t &t) {
+    if (t)
+      t += ms;
   };
+  shift(s.waitStartMs);
+  shift(s.wetStartMs);
+  shift(s.coolingStartMs);
+  shift(s.heaterLastCheckMs);
+  shift(s.heaterLastLogMs);
+  shift(s.wet.lastSampleMs);
+  shift(s.wet.peakMs);
+  shift(s.wet.minDiffMs);
+  shift(s.cooling.markMs);
+  shift(s.cooling.sampleMs);
+  shift(s.cooling.lastHoldLogMs);
+}
 
-  Transition<SubState, Event> sub2_trans[] = {
-      {SubState::S_IDLE, Event::Shoe1InitWet, SubState::S_WAITING,
-       []() { FSM_DBG_PRINTLN("SUB2: S_IDLE -> S_WAITING (wet shoe)"); }},
-      {SubState::S_IDLE, Event::Shoe1InitDry, SubState::S_DRY,
-       []() { FSM_DBG_PRINTLN("SUB2: S_IDLE -> S_DRY (dry shoe)"); }},
-      // S_WAITING -> S_WET (when lock acquired)
-      {SubState::S_WAITING, Event::SubStart, SubState::S_WET,
-       []() { FSM_DBG_PRINTLN("SUB2: S_WAITING -> S_WET (lock acquired)"); }},
-      {SubState::S_WET, Event::SubStart, SubState::S_COOLING,
-       []() { FSM_DBG_PRINTLN("SUB2: Wet→Cooling (SubStart)"); }},
-      {SubState::S_COOLING, Event::DryCheckFailed, SubState::S_WAITING,
-       []() { FSM_DBG_PRINTLN("SUB2: Cooling->Waiting (DryCheckFailed - return to queue)"); }},
-      {SubState::S_COOLING, Event::SubStart, SubState::S_DRY,
-       []() { FSM_DBG_PRINTLN("SUB2: Cooling→Dry (SubStart)"); }},
-      {SubState::S_DRY, Event::SubStart, SubState::S_DONE,
-       []() {
-         FSM_DBG_PRINTLN("SUB2: Dry→Done (SubStart)");
-         markSubDone(1);
-       }},
-      {SubState::S_DRY, Event::DryCheckFailed, SubState::S_WAITING,
-       []() { FSM_DBG_PRINTLN("SUB2: Dry->Waiting (DryCheckFailed - return to queue)"); }},
-      {SubState::S_DONE, Event::SubStart, SubState::S_DONE, []() { /* end */ }}};
-
-  // Register transitions
-  for (auto &t : global_trans)
-    fsmGlobal.addTransition(t);
-  for (auto &t : sub1_trans)
-    fsmSub1.addTransition(t);
-  for (auto &t : sub2_trans)
-    fsmSub2.addTransition(t);
-
-  // Make ResetPressed a catch-all: Global -> Idle
-  for (uint8_t s = 0; s < static_cast<uint8_t>(GlobalState::Count); ++s) {
-    fsmGlobal.addTransition({static_cast<GlobalState>(s), Event::ResetPressed, GlobalState::Idle,
-                             []() { FSM_DBG_PRINTLN("GLOBAL: Reset (Idle)"); }});
+// Running: follow the battery ladder. The battery task picks the rung and the
+// motor task caps the fans / holds the heaters; here the rung change is logged
+// and the Pause rung freezes the sub scripts (the shared UV timer keeps running).
+static void followBatteryRung() {
+  BatteryRung rung = g_batteryRung;
+  if (rung == g_rungSeen)
+    return;
+  FSM_DBG_PRINT("GLOBAL: battery "); FSM_DBG_PRINT(g_lastBatteryVoltage, 2);
+  FSM_DBG_PRINT(" V (rest "); FSM_DBG_PRINT(g_batteryRestV, 2); FSM_DBG_PRINT(" V) -> ");
+  FSM_DBG_PRINTLN(BATTERY_RUNG_NAMES[static_cast<size_t>(rung)]);
+  if (rung == BatteryRung::Pause) {
+    g_pauseStartMs = millis();
+  } else if (g_pauseStartMs) {
+    uint32_t pausedMs = millis() - g_pauseStartMs;
+    for (ShoeContext &s : g_shoes) {
+      shiftShoeClocks(s, pausedMs);
+      s.profile.pausedMs += pausedMs;
+    }
+    g_power.holdAging(pausedMs);  // queued bays keep their place, not extra priority
+    g_pauseStartMs = 0;
+  }
+  g_rungSeen = rung;
+}
+
+// Stop every motor, heater and UV lamp and drop every power grant
+static void stopAllOutputs() {
+  for (uint8_t i = 0; i < NUM_BAYS; ++i) {
+    motorStop(i);
+    heaterRun(i, false);
+  }
+  for (uint8_t i = 0; i < NUM_UV_CHANNELS; ++i)
+    uvStop(i);
+  g_power.releaseAll();
+}
+
+static void onRecipeNext() {
+  RecipeId id = recipeSelectNext();
+  FSM_DBG_PRINT("GLOBAL: recipe -> "); FSM_DBG_PRINTLN(recipe(id).name);
+}
+
+// Resets that cut a cycle short by accident; only these resume it
+static bool resetWasCrash() {
+  switch (esp_reset_reason()) {
+  case ESP_RST_PANIC:
+  case ESP_RST_INT_WDT:
+  case ESP_RST_TASK_WDT:
+  case ESP_RST_WDT:
+  case ESP_RST_BROWNOUT:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Every shoe is in a state the resume rows can re-enter
+static bool checkpointResumable(const CycleCheckpoint &cp) {
+  if (static_cast<size_t>(cp.recipe) >= NUM_RECIPES)
+    return false;
+  for (const ShoeCheckpoint &sc : cp.shoes)
+    if (sc.state != SubState::S_WAITING && sc.state != SubState::S_WET && sc.state != SubState::S_COOLING &&
+        sc.state != SubState::S_DRY)
+      return false;
+  return true;
+}
+
+static void cancelResume() {
+  if (!g_resumeWaitSensors)
+    return;
+  FSM_DBG_PRINTLN("GLOBAL: checkpoint discarded");
+  g_resumeWaitSensors = false;
+  checkpointClear();
+}
+
+// Running entry after Resume: restore the run clock and the UV time, then send
+// each shoe back to its state. A WET shoe takes its heater power here; if it
+// does not fit it queues in WAITING and resumes WET once granted.
+static void resumeFromCheckpoint() {
+  const CycleCheckpoint &cp = g_resumeCp;
+  uint32_t now = millis();
+  g_runStartMs = now - cp.runElapsedMs;
+  g_uvResumeMs = cp.uvRemainingMs;
+  FSM_DBG_PRINT("GLOBAL: resuming checkpoint #"); FSM_DBG_PRINT(cp.seq); FSM_DBG_PRINT(" at ");
+  FSM_DBG_PRINT(cp.runElapsedMs / 1000); FSM_DBG_PRINTLN(" s");
+  for (uint8_t i = 0; i < NUM_BAYS; ++i) {
+    ShoeContext &s = g_shoes[i];
+    const ShoeCheckpoint &sc = cp.shoes[i];
+    resetShoeCycle(s);
+    s.recipe = cp.recipe;
+    s.queueWaitMs = sc.queueWaitMs;
+    s.profile.startMs = g_runStartMs;  // totals span the reset; phases restart here
+    s.resuming = sc.state == SubState::S_WET || sc.state == SubState::S_COOLING;
+    s.resume = sc;
+    if (sc.state == SubState::S_WET && !g_power.request(i, WET_DRAW_W, waitPriority(i), now)) {
+      FSM_DBG_PRINT(subLabel(i)); FSM_DBG_PRINTLN(": resumed WET queued for power");
+    }
+  }
+  // Fans after heaters: a COOLING shoe whose fan does not fit skips the rest of
+  // its motor phase and stabilizes with the fan off (see resumeCooling) rather
+  // than hold a heater back
+  for (uint8_t i = 0; i < NUM_BAYS; ++i)
+    if (cp.shoes[i].state == SubState::S_COOLING && !g_power.request(i, FAN_DRAW_W, 0.0f, now))
+      g_power.cancel(i);
+  for (uint8_t i = 0; i < NUM_BAYS; ++i)
+    fsmSubs.post(i, Event::Resume);
+}
+
+// COOLING entry after Resume: continue the motor phase where it stopped. A
+// shoe that had reached stabilization or re-evap ends the motor phase at once
+// and stabilizes again, as the reset lost its samples. Without a fan grant
+// (resumeFromCheckpoint) the motor phase is skipped and the fan stays off.
+static void resumeCooling(uint8_t idx) {
+  ShoeContext &s = g_shoes[idx];
+  const ShoeCheckpoint &sc = s.resume;
+  bool pastMotor = sc.phase >= static_cast<uint8_t>(CyclePhase::Stabilize);
+  s.coolingMotorDurationMs = sc.coolingMotorDurationMs;
+  s.coolingStartMs = millis() - (pastMotor ? sc.coolingMotorDurationMs : sc.coolingElapsedMs);
+  s.cooling.reEvapRetries = sc.reEvapRetries;
+  s.cooling.skipMotor = g_power.granted(idx) < FAN_DRAW_W;
+  if (s.cooling.skipMotor) {
+    motorStop(idx);
+    FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINTLN(": resumed COOLING without fan power, stabilizing");
+  }
+  s.resuming = false;
+}
+
+// Snapshot of the Running cycle, times relative to now
+static void fillCheckpoint(CycleCheckpoint &cp) {
+  uint32_t now = millis();
+  auto ago = [now](uint32_t t) { return t ? now - t : 0u; };
+  cp = {};
+  cp.runElapsedMs = now - g_runStartMs;
+  cp.uvRemainingMs = uvIsStarted(0) ? uvRemainingMs(0) : 0;
+  cp.recipe = g_shoes[0].recipe;
+  for (uint8_t i = 0; i < NUM_BAYS; ++i) {
+    const ShoeContext &s = g_shoes[i];
+    ShoeCheckpoint &sc = cp.shoes[i];
+    sc.state = fsmSubs.getState(i);
+    sc.phase = static_cast<uint8_t>(s.profile.phase);
+    sc.reEvapRetries = s.cooling.reEvapRetries;
+    sc.initialWetDiff = s.initialWetDiff;
+    sc.queueWaitMs = s.queueWaitMs + ago(s.waitStartMs);
+    sc.wetElapsedMs = ago(s.wetStartMs);
+    sc.peakAgoMs = ago(s.wet.peakMs);
+    sc.coolingElapsedMs = ago(s.coolingStartMs);
+    sc.coolingMotorDurationMs = s.coolingMotorDurationMs;
   }
-  // Reset for subs -> S_IDLE
-  for (int s = 0; s <= static_cast<int>(SubState::S_DONE); ++s) {
-    fsmSub1.addTransition({static_cast<SubState>(s), Event::ResetPressed, SubState::S_IDLE, []() {
-                             FSM_DBG_PRINTLN("SUB1: Reset (S_Idle)");
-                             g_subDoneMask &= ~1u;
-                           }});
-    fsmSub2.addTransition({static_cast<SubState>(s), Event::ResetPressed, SubState::S_IDLE, []() {
-                             FSM_DBG_PRINTLN("SUB2: Reset (S_Idle)");
-                             g_subDoneMask &= ~2u;
-                           }});
+}
+
+// A shoe is in a phase whose elapsed time a checkpoint would lose
+static bool timedPhaseActive() {
+  for (size_t i = 0; i < NUM_BAYS; ++i) {
+    SubState st = fsmSubs.getState(i);
+    if (st == SubState::S_WET || st == SubState::S_COOLING)
+      return true;
   }
+  return uvIsStarted(0);
+}
+
+// Running: write a checkpoint after phase boundaries (batched by
+// CHECKPOINT_MIN_GAP_MS) and every CHECKPOINT_INTERVAL_MS in a timed phase.
+// The write itself runs on the checkpoint task.
+static void checkpointTick() {
+  if (!CHECKPOINT_RESUME)
+    return;
+  uint32_t since = millis() - g_checkpointMs;
+  if (g_checkpointDirty ? since < CHECKPOINT_MIN_GAP_MS : since < CHECKPOINT_INTERVAL_MS || !timedPhaseActive())
+    return;
+  CycleCheckpoint cp;
+  fillCheckpoint(cp);
+  checkpointSave(cp);
+  g_checkpointMs = millis();
+  g_checkpointDirty = false;
+}
+
+// Transition guards for the Resume rows: the shoe's checkpointed state
+template <SubState St> static bool resumesIn(uint8_t idx) {
+  return g_shoes[idx].resume.state == St;
+}
+static bool resumesWet(uint8_t idx) {
+  return resumesIn<SubState::S_WET>(idx) && hasWetPower(idx);
+}
 
-  // Run callback for Running: poll subs
-  fsmGlobal.setRun(GlobalState::Running, []() {
-    fsmSub1.run();
-    fsmSub2.run();
-    
-    // TODO: Issue #10 - Add periodic battery monitoring during Running state
-    // Currently disabled to avoid interrupting cycles mid-operation
-    // Future: Check battery every BATTERY_CHECK_INTERVAL_MS to detect mid-cycle battery drain
-    // and post BatteryLow event if voltage drops below threshold
-  });
-
-  // Register entry/exit callbacks
-  struct StateCBG {
-    GlobalState s;
-    void (*entry)();
-    void (*exit)();
+static void setupStateMachines() {
+  // Transition tables (constexpr: dispatch arrays are built at compile time and live in flash).
+  // Actions only do work; every fired transition is recorded in g_fsmTrace. Rows are
+  // {from, event, to, action, guard}; for one (state, event) the first row whose guard
+  // passes fires, so event routing lives here rather than in dispatchEvent().
+  static constexpr Transition<GlobalState, Event> global_trans[] = {
+      {GlobalState::Idle, Event::StartPressed, GlobalState::Detecting, nullptr},
+      {GlobalState::Detecting, Event::SensorTimeout, GlobalState::Checking, nullptr},
+      {GlobalState::Checking, Event::StartPressed, GlobalState::Running, nullptr},
+      // Start held down in Checking picks the recipe the run will use
+      {GlobalState::Checking, Event::RecipeNext, GlobalState::Checking, onRecipeNext},
+      // Crash resume: straight back into the checkpointed cycle
+      {GlobalState::Idle, Event::Resume, GlobalState::Running, []() { g_resuming = true; }},
+      // Any in-session state can drop to LowBattery
+      {GlobalState::Session, Event::BatteryLow, GlobalState::LowBattery, nullptr},
+      {GlobalState::LowBattery, Event::BatteryRecovered, GlobalState::Idle, nullptr},
+      {GlobalState::Running, Event::SubFSMDone, GlobalState::Done, nullptr, allSubsDone},
+      // Catch-alls on Root: every state -> Error / Idle
+      {GlobalState::Root, Event::Error, GlobalState::Error, nullptr},
+      {GlobalState::Root, Event::ResetPressed, GlobalState::Idle, nullptr},
   };
-  struct StateCBS {
-    SubState s;
-    void (*entry)();
-    void (*exit)();
+
+  // One table for every bay; callbacks and guards get the bay index. A
+  // broadcast event reaches every sub; guards pick the sub(s) it applies to.
+  static constexpr Transition<SubState, Event, IndexedFn> sub_trans[] = {
+      // Init events are posted to one sub
+      {SubState::S_IDLE, Event::InitWet, SubState::S_WAITING, nullptr},
+      {SubState::S_IDLE, Event::InitDry, SubState::S_DRY, nullptr},
+      // Resume re-enters the checkpointed state; a WET shoe without heater
+      // power yet queues in WAITING (as does a shoe that was waiting)
+      {SubState::S_IDLE, Event::Resume, SubState::S_WET, nullptr, resumesWet},
+      {SubState::S_IDLE, Event::Resume, SubState::S_COOLING, nullptr, resumesIn<SubState::S_COOLING>},
+      {SubState::S_IDLE, Event::Resume, SubState::S_DRY, nullptr, resumesIn<SubState::S_DRY>},
+      {SubState::S_IDLE, Event::Resume, SubState::S_WAITING, nullptr},
+      // S_WAITING -> S_WET once this sub holds heater + fan power
+      {SubState::S_WAITING, Event::SubStart, SubState::S_WET, nullptr, hasWetPower},
+      // New flow: S_WET -> S_COOLING (heater off, motor continues) -> S_DRY
+      {SubState::S_WET, Event::SubStart, SubState::S_COOLING, onWetAdvance},
+      {SubState::S_COOLING, Event::SubStart, SubState::S_DRY, nullptr, coolingFinished},
+      // The single UV timer finishes every sub waiting in DRY
+      {SubState::S_DRY, Event::UVTimer0, SubState::S_DONE, onSubUvDone},
+      // If the dry-check fails in COOLING or DRY, return to waiting queue
+      {SubState::S_FINISHING, Event::DryCheckFailed, SubState::S_WAITING, nullptr},
+      // ResetPressed is a catch-all on S_ROOT: every state -> S_IDLE
+      {SubState::S_ROOT, Event::ResetPressed, SubState::S_IDLE, onSubReset},
   };
 
-  static StateCBG global_cbs[] = {
-       {GlobalState::Detecting,
+  // Per-state entry/exit/run callbacks
+  static constexpr StateHandlers<GlobalState> global_cbs[] = {
+      // Idle: full reset, status LED on, error LED off
+      {GlobalState::Idle,
        []() {
-         detectingStartMs = millis();
-         FSM_DBG_PRINTLN("GLOBAL ENTRY: Detecting - equalize timer started");
+         // Full reset when entering Idle
+         FSM_DBG_PRINTLN("GLOBAL ENTRY: Idle - full reset");
+
+         stopAllOutputs();
+         g_uvComplete = false;
+         g_uvStartGuard = false;
+
+         // Clear per-sub cooling/wet timers, flags and heater trend tracking
+         // (WET/COOLING script state restarts on state entry)
+         for (ShoeContext &s : g_shoes) {
+           resetShoeCycle(s);
+           resetHeaterTrend(s);
+         }
+
+         // Play entry-only SOLE/CARE splash on Idle entry (after reset)
+         triggerSplashEntryOnly();
+
+         // Reset substates to IDLE via ResetPressed (handled after this step)
+         for (size_t i = 0; i < NUM_BAYS; ++i)
+           fsmSubs.post(i, Event::ResetPressed);
+
+         // LEDs: Status on (idle), Error off
+         digitalWrite(HW_STATUS_LED_PIN, HIGH);
+         digitalWrite(HW_ERROR_LED_PIN, LOW);
        },
+       nullptr, nullptr},
+      // Detecting: equalize timer is the Detecting state timeout (see global_timeouts)
+      {GlobalState::Detecting, []() { FSM_DBG_PRINTLN("GLOBAL ENTRY: Detecting - equalize timer started"); },
+       []() { FSM_DBG_PRINTLN("GLOBAL EXIT: Detecting - equalize timer cleared"); }, nullptr},
+      // Checking: check the battery immediately on entry (sampler's cached
+      // voltage, at most BATTERY_CHECK_INTERVAL_MS old)
+      {GlobalState::Checking,
        []() {
-         detectingStartMs = 0;
-         FSM_DBG_PRINTLN("GLOBAL EXIT: Detecting - equalize timer cleared");
-       }},
-      {GlobalState::Done,
-       []() {
-         FSM_DBG_PRINTLN("GLOBAL ENTRY: Done - resetting subs (local)");
-         fsmSub1.handleEvent(Event::ResetPressed);
-         fsmSub2.handleEvent(Event::ResetPressed);
-         uvStop(0);
-         uvStop(1);
-         g_subDoneMask = 0;
-         g_uvComplete[0] = g_uvComplete[1] = false;
-         g_doneStartMs = millis();
-         // Blink status LED in Done state, ensure error LED is off
+         FSM_DBG_PRINTLN("GLOBAL ENTRY: Checking - verifying battery voltage");
+         // Turn on status LED when checking
+         digitalWrite(HW_STATUS_LED_PIN, HIGH);
          digitalWrite(HW_ERROR_LED_PIN, LOW);
-         digitalWrite(HW_STATUS_LED_PIN, LOW);
+         if (!isBatteryOk()) {
+           FSM_DBG_PRINT("GLOBAL: Battery voltage low: ");
+           if (Serial) Serial.printf("%.2f V\n", g_lastBatteryVoltage);
+           fsmPostEvent(Event::BatteryLow);
+         }
+       },
+       nullptr, nullptr},
+      // Running: status LED off, error LED blinking + initialize subs; run polls subs
+      {GlobalState::Running,
+       []() {
+         // Initialize substates
+         FSM_DBG_PRINTLN("GLOBAL ENTRY: Running - initializing subs");
+         g_uvComplete = false;
+         g_power.releaseAll();  // Clear grants for new run
+         g_runStartMs = millis();
+         g_rungSeen = BatteryRung::Normal;  // the first run applies the current rung
+         g_pauseStartMs = 0;
+         g_checkpointMs = millis();
+         // Ensure no stale cooling/wet state blocks WET acquisition, then
+         // classify each shoe. Init events bypass the mailbox; the subs
+         // handle them as soon as this transition completes
+         if (g_resuming) {
+           g_resuming = false;
+           resumeFromCheckpoint();
+         } else {
+           // Both shoes of the pair run the recipe chosen in Checking
+           FSM_DBG_PRINT("GLOBAL: recipe "); FSM_DBG_PRINTLN(recipe(recipeSelected()).name);
+           for (uint8_t i = 0; i < NUM_BAYS; ++i) {
+             resetShoeCycle(g_shoes[i]);
+             g_shoes[i].recipe = recipeSelected();
+             fsmSubs.post(i, g_dhtIsWet[i] ? Event::InitWet : Event::InitDry);
+           }
+         }
+
+         // LED initialization for running state
+         digitalWrite(HW_STATUS_LED_PIN, LOW);   // Status LED off when running
+         digitalWrite(HW_ERROR_LED_PIN, LOW);    // Start with error LED off
          g_ledBlinkMs = millis();
          g_ledBlinkState = false;
        },
-       []() { g_doneStartMs = 0; }}};
-
-  static StateCBS sub1_cbs[] = {
-      // S_WAITING: waiting for WET lock to become available
-      {SubState::S_WAITING,
        []() {
-         FSM_DBG_PRINTLN("SUB1 ENTRY: WAITING for WET lock");
-         g_waitingEventPosted[0] = false;  // Reset guard on entry
+         // The cycle is over (done, reset or low battery): nothing to resume
+         g_pauseStartMs = 0;
+         g_checkpointDirty = false;
+         checkpointClear();
        },
        []() {
-         FSM_DBG_PRINTLN("SUB1 EXIT: leaving WAITING");
+         // Mid-cycle battery: degrade instead of browning out; a near-empty
+         // pack finishes the pair slower rather than losing the cycle
+         followBatteryRung();
+         // Below the bottom rung: the ladder cannot help any more, end the run
+         if (g_batteryRestV < BATTERY_LOW_THRESHOLD) {
+           fsmPostEvent(Event::BatteryLow);
+           return;
+         }
+         if (g_pauseStartMs)
+           return;
+         checkpointTick();
+         // Cheap when nothing is due: the sub states declare their run periods
+         for (size_t i = 0; i < NUM_BAYS; ++i)
+           fsmSubs.run(i);
        }},
-      // S_WET: warmup (30-50s), then normal WET with trend-gated heater control
-      {SubState::S_WET,
+      // Done: stop UVs but keep subs in their final states (COOLING/DRY/etc).
+      // Subs will reset when user presses Start again (goes back to Idle first).
+      // Auto-reset after DONE_TIMEOUT_MS is the Done state timeout.
+      {GlobalState::Done,
        []() {
-         FSM_DBG_PRINTLN("SUB1 ENTRY: WET");
-         // Initialize warmup phase
-         g_heaterWarmupStartMs[0] = 0;  // Will be set on first run iteration
-         g_heaterWarmupDone[0] = false;
-         // Reset heater trend tracking (will be re-initialized during warmup)
-         g_heaterLastTemp[0] = NAN;
-         g_heaterLastCheckMs[0] = 0;
-         g_heaterTrendSamples[0] = 0;
-         g_heaterTempRising[0] = false;
-         // Start WET timer for timeout enforcement
-         g_wetPhaseStartMs[0] = millis();
-         g_reEvapRetryCount[0] = 0;  // Reset retry count on new WET cycle
-         
-         motorStop(0);
-         g_motorStarted[0] = false;
-         motorSetDutyPercent(0, 0);
-         g_subWetStartMs[0] = millis();
-         g_initialWetDiff[0] = g_dhtAHDiff[0];
-         assignAdaptiveWETDurations(0, g_initialWetDiff[0]);
-         g_lastValidAHDiff[0] = g_initialWetDiff[0];
-         g_lastAHDiffCheckMs[0] = g_subWetStartMs[0];
-         // Reset peak detection for new WET cycle
-         g_peakDetected[0] = false;
-         g_peakDetectedMs[0] = 0;
-         g_minAHDiffSeen[0] = g_initialWetDiff[0];  // Start tracking minimum from initial value
-         g_minAHDiffSeenMs[0] = g_subWetStartMs[0];
-         g_coolingRetryCount[0] = 0;  // Reset cooling retries for new cycle
-         FSM_DBG_PRINT("SUB1: WET entry ("); FSM_DBG_PRINT(g_initialWetDiff[0], 2);
-         FSM_DBG_PRINT("g/m^3) -> ");
-         // (classification printed in helper function)
-         FSM_DBG_PRINT(", minDuration="); FSM_DBG_PRINT(g_wetMinDurationMs[0]/1000); FSM_DBG_PRINT("s, buffer="); 
-         FSM_DBG_PRINT(g_peakBufferMs[0]/1000); FSM_DBG_PRINTLN("s");
+         FSM_DBG_PRINTLN("GLOBAL ENTRY: Done - stopping UVs");
+         for (uint8_t i = 0; i < NUM_UV_CHANNELS; ++i)
+           uvStop(i);
+         g_power.release(POWER_CLIENT_UV);
+         g_subDoneMask = 0;
+         // Pair throughput: compare budgets by running the same loads through both
+         uint32_t elapsedMs = millis() - g_runStartMs;
+         FSM_DBG_PRINT("GLOBAL: cycle done in "); FSM_DBG_PRINT(elapsedMs / 1000);
+         FSM_DBG_PRINT(" s at "); FSM_DBG_PRINT(g_power.budgetW()); FSM_DBG_PRINT(" W budget, ");
+         FSM_DBG_PRINT(elapsedMs ? NUM_BAYS * 3600000.0f / elapsedMs : 0.0f, 1); FSM_DBG_PRINTLN(" shoes/h");
        },
+       nullptr, nullptr},
+      // LowBattery: status LED off, error LED on; run keeps checking for recovery.
+      // BatteryLow is inherited from Session, so this can be entered mid-run.
+      {GlobalState::LowBattery,
        []() {
-         FSM_DBG_PRINTLN("SUB1 EXIT: WET -> resetting PID and releasing lock");
-         g_pidInitialized[0] = false;
-         g_motorPID[0].reset();
-         // Release WET lock since COOLING doesn't need it
-         if (g_wetLockOwner == 0) {
-           g_wetLockOwner = -1;
-           FSM_DBG_PRINTLN("SUB1: Released WET lock on exit to COOLING");
-         }
-       }},
-      // S_COOLING: heater off, motor continues; start cooling timer
-      {SubState::S_COOLING,
-       []() {
-         FSM_DBG_PRINTLN("SUB1 ENTRY: COOLING"); /* turn heater off, motor kept running */
-         // CRITICAL: Turn heater OFF immediately before starting cooling phase
-         // This ensures heater OFF is processed before motor task gets busy
-         heaterRun(0, false);
-         vTaskDelay(pdMS_TO_TICKS(5));  // Brief delay to ensure message is processed
-         heaterRun(0, false);  // Double-check: send OFF again
-         startCoolingPhase(0, false);
+         FSM_DBG_PRINTLN("GLOBAL ENTRY: LowBattery - waiting for battery recovery");
+         stopAllOutputs();
+         digitalWrite(HW_STATUS_LED_PIN, LOW);   // Status LED off
+         digitalWrite(HW_ERROR_LED_PIN, HIGH);   // Error LED solid on
        },
        []() {
-         FSM_DBG_PRINTLN("SUB1 EXIT: leaving COOLING"); /* leaving cooling */
-         // Stop motor explicitly when leaving COOLING to ensure fan is off in DRY
-         motorStop(0);
-         g_motorStarted[0] = false;
-         g_coolingLocked[0] = false;
-       }},
-      // S_DRY: on entry stop motor; start single UV (GPIO14) when BOTH shoes reach DRY
-      {SubState::S_DRY,
+         FSM_DBG_PRINTLN("GLOBAL EXIT: LowBattery");
+         digitalWrite(HW_ERROR_LED_PIN, LOW);  // Turn off error LED
+       },
        []() {
-         FSM_DBG_PRINTLN("SUB1 ENTRY: DRY");
-         // CRITICAL: Ensure heater is absolutely OFF in DRY state
-         heaterRun(0, false);
-         motorStop(0);
-         g_motorStarted[0] = false;
-         // Atomic UV start guard: prevent both shoes from calling uvStart()
-         if (fsmSub2.getState() == SubState::S_DRY && !g_uvComplete[0] && !uvIsStarted(0) && !g_uvStartGuard) {
-           g_uvStartGuard = true;  // Set guard BEFORE calling uvStart()
-           FSM_DBG_PRINTLN("SUB1 ENTRY: DRY -> Both shoes dry, starting single UV on GPIO14");
-           uvStart(0, 0);
-         } else {
-           FSM_DBG_PRINTLN("SUB1 ENTRY: DRY -> Waiting for other shoe or UV to complete");
+         if (isBatteryRecovered()) {
+           FSM_DBG_PRINT("GLOBAL: Battery recovered: ");
+           if (Serial) Serial.printf("%.2f V\n", g_lastBatteryVoltage);
+           fsmPostEvent(Event::BatteryRecovered);
          }
        },
-       nullptr},
-      // S_DONE: release WET lock when done
-      {SubState::S_DONE,
+       BATTERY_CHECK_INTERVAL_MS, 0},
+      // Error: everything off (Error can be raised mid-run, and nothing steps
+      // the subs outside Running), status LED off, error LED solid on
+      {GlobalState::Error,
        []() {
-         FSM_DBG_PRINTLN("SUB1 ENTRY: DONE - releasing WET lock");
-         if (g_wetLockOwner == 0) {
-           g_wetLockOwner = -1;
-           FSM_DBG_PRINTLN("SUB1: Released WET lock on DONE");
-         }
+         FSM_DBG_PRINTLN("GLOBAL ENTRY: Error");
+         stopAllOutputs();
+         digitalWrite(HW_STATUS_LED_PIN, LOW);
+         digitalWrite(HW_ERROR_LED_PIN, HIGH);  // Solid on for error
        },
-       nullptr}
-  };
+       nullptr, nullptr}};
 
-  static StateCBS sub2_cbs[] = {
-      // S_WAITING: waiting for WET lock to become available
+  static constexpr StateHandlers<SubState, IndexedFn> sub_cbs[] = {
+      // S_WAITING: waiting for heater + fan power to fit the budget
       {SubState::S_WAITING,
-       []() {
-         FSM_DBG_PRINTLN("SUB2 ENTRY: WAITING for WET lock");
-         g_waitingEventPosted[1] = false;  // Reset guard on entry
+       [](uint8_t idx) {
+         FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINTLN(" ENTRY: WAITING for WET power");
+         g_shoes[idx].waitingEventPosted = false;  // Reset guard on entry
+         g_shoes[idx].waitStartMs = millis();
+         profMark(idx, CyclePhase::Waiting, PhaseEnd::Wet);  // re-queued: the dry-check failed
+         // Queue now: shoes entering together rank against each other from
+         // the first WAITING run, whichever bay polls first
+         g_power.enqueue(idx, WET_DRAW_W, waitPriority(idx), millis());
        },
-       []() {
-         FSM_DBG_PRINTLN("SUB2 EXIT: leaving WAITING");
-       }},
+       [](uint8_t idx) {
+         FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINTLN(" EXIT: leaving WAITING");
+         ShoeContext &s = g_shoes[idx];
+         s.queueWaitMs += millis() - s.waitStartMs;
+         s.waitStartMs = 0;
+       },
+       subWaitingRun, WAITING_RUN_PERIOD_MS, 0},
+      // S_WET: warmup (30-50s), then normal WET with trend-gated heater control
       {SubState::S_WET,
-       []() {
-         FSM_DBG_PRINTLN("SUB2 ENTRY: WET");
-         // Initialize warmup phase
-         g_heaterWarmupStartMs[1] = 0;  // Will be set on first run iteration
-         g_heaterWarmupDone[1] = false;
+       [](uint8_t idx) {
+         FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINTLN(" ENTRY: WET");
+         ShoeContext &s = g_shoes[idx];
+         // The WET script starts with warmup on the first run iteration
+         s.wet.ps.reset();
+         profMark(idx, CyclePhase::Warmup, PhaseEnd::Granted);
          // Reset heater trend tracking (will be re-initialized during warmup)
-         g_heaterLastTemp[1] = NAN;
-         g_heaterLastCheckMs[1] = 0;
-         g_heaterTrendSamples[1] = 0;
-         g_heaterTempRising[1] = false;
-         // Start WET timer for timeout enforcement
-         g_wetPhaseStartMs[1] = millis();
-         g_reEvapRetryCount[1] = 0;  // Reset retry count on new WET cycle
-         
-         motorStop(1);
-         g_motorStarted[1] = false;
-         motorSetDutyPercent(1, 0);
-         g_subWetStartMs[1] = millis();
-         g_initialWetDiff[1] = g_dhtAHDiff[1];
-         assignAdaptiveWETDurations(1, g_initialWetDiff[1]);
-         g_lastValidAHDiff[1] = g_initialWetDiff[1];
-         g_lastAHDiffCheckMs[1] = g_subWetStartMs[1];
-         // Reset peak detection for new WET cycle
-         g_peakDetected[1] = false;
-         g_peakDetectedMs[1] = 0;
-         g_minAHDiffSeen[1] = g_initialWetDiff[1];  // Start tracking minimum from initial value
-         g_minAHDiffSeenMs[1] = g_subWetStartMs[1];
-         g_coolingRetryCount[1] = 0;  // Reset cooling retries for new cycle
-         FSM_DBG_PRINT("SUB2: WET entry ("); FSM_DBG_PRINT(g_initialWetDiff[1], 2);
+         resetHeaterTrend(s);
+
+         motorStop(idx);
+         s.motorStarted = false;
+         motorSetDutyPercent(idx, 0);
+         // WET start: UI progress and timeout enforcement. A resumed WET
+         // keeps its start and tier; the script skips what was done.
+         if (s.resuming) {
+           s.wetStartMs = millis() - s.resume.wetElapsedMs;
+           s.initialWetDiff = s.resume.initialWetDiff;
+         } else {
+           s.wetStartMs = millis();
+           s.initialWetDiff = g_dhtAHDiff[idx];
+         }
+         assignAdaptiveWETDurations(idx, s.initialWetDiff);
+         FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(": WET entry ("); FSM_DBG_PRINT(s.initialWetDiff, 2);
          FSM_DBG_PRINT("g/m^3) -> ");
          // (classification printed in helper function)
-         FSM_DBG_PRINT(", minDuration="); FSM_DBG_PRINT(g_wetMinDurationMs[1]/1000); FSM_DBG_PRINT("s, buffer="); 
-         FSM_DBG_PRINT(g_peakBufferMs[1]/1000); FSM_DBG_PRINTLN("s");
+         FSM_DBG_PRINT(", minDuration="); FSM_DBG_PRINT(s.wetMinDurationMs/1000); FSM_DBG_PRINT("s, buffer=");
+         FSM_DBG_PRINT(s.peakBufferMs/1000); FSM_DBG_PRINTLN("s");
        },
-       []() {
-         FSM_DBG_PRINTLN("SUB2 EXIT: WET -> resetting PID and releasing lock");
-         g_pidInitialized[1] = false;
-         g_motorPID[1].reset();
-         // Release WET lock since COOLING doesn't need it
-         if (g_wetLockOwner == 1) {
-           g_wetLockOwner = -1;
-           FSM_DBG_PRINTLN("SUB2: Released WET lock on exit to COOLING");
-         }
-       }},
+       [](uint8_t idx) {
+         FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINTLN(" EXIT: WET -> resetting PID, releasing heater power");
+         g_pidInitialized[idx] = false;
+         g_motorPID[idx].reset();
+         // COOLING keeps only the fan running
+         g_power.reduce(idx, FAN_DRAW_W);
+       },
+       subWetRun, SCRIPT_TICK_MS, 0},
+      // S_COOLING: heater off, motor continues; start cooling timer
       {SubState::S_COOLING,
-       []() {
-         FSM_DBG_PRINTLN("SUB2 ENTRY: COOLING");
-         // CRITICAL: Turn heater OFF immediately before starting cooling phase
-         // This ensures heater OFF is processed before motor task gets busy
-         heaterRun(1, false);
-         vTaskDelay(pdMS_TO_TICKS(5));  // Brief delay to ensure message is processed
-         heaterRun(1, false);  // Double-check: send OFF again
-         startCoolingPhase(1, false);
+       [](uint8_t idx) {
+         FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINTLN(" ENTRY: COOLING"); /* turn heater off, motor kept running */
+         // Heater OFF is the first command queued; the motor task drains its
+         // whole queue each pass, so it lands before the new fan duty
+         ShoeContext &s = g_shoes[idx];
+         startCoolingPhase(idx, false);
+         s.cooling.reEvapRetries = 0;
+         s.cooling.skipMotor = false;
+         if (s.resuming)
+           resumeCooling(idx);
+         s.cooling.ps.reset();
+         profMark(idx, CyclePhase::Cooling, PhaseEnd::None);  // no-op unless resumed
        },
-       []() {
-         FSM_DBG_PRINTLN("SUB2 EXIT: leaving COOLING");
+       [](uint8_t idx) {
+         FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINTLN(" EXIT: leaving COOLING"); /* leaving cooling */
          // Stop motor explicitly when leaving COOLING to ensure fan is off in DRY
-         motorStop(1);
-         g_motorStarted[1] = false;
-         g_coolingLocked[1] = false;
-       }},
+         motorStop(idx);
+         g_shoes[idx].motorStarted = false;
+         g_power.release(idx);
+       },
+       subCoolingRun, SCRIPT_TICK_MS, COOLING_RUN_OFFSET_MS},
+      // S_DRY: on entry stop motor; start single UV (GPIO14) when BOTH shoes reach DRY
       {SubState::S_DRY,
-       []() {
-         FSM_DBG_PRINTLN("SUB2 ENTRY: DRY");
+       [](uint8_t idx) {
+         FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINT(" ENTRY: DRY after ");
+         FSM_DBG_PRINT((millis() - g_runStartMs) / 1000); FSM_DBG_PRINT(" s, queued ");
+         FSM_DBG_PRINT(g_shoes[idx].queueWaitMs / 1000); FSM_DBG_PRINTLN(" s");
          // CRITICAL: Ensure heater is absolutely OFF in DRY state
-         heaterRun(1, false);
-         motorStop(1);
-         g_motorStarted[1] = false;
-         // Atomic UV start guard: prevent both shoes from calling uvStart()
-         if (fsmSub1.getState() == SubState::S_DRY && !g_uvComplete[0] && !uvIsStarted(0) && !g_uvStartGuard) {
+         heaterRun(idx, false);
+         motorStop(idx);
+         g_shoes[idx].motorStarted = false;
+         profMark(idx, CyclePhase::DryWait, PhaseEnd::Dry);  // opens the cycle on the DRY-only path
+         // Atomic UV start guard: prevent several shoes from calling uvStart()
+         if (allSubsDry() && !g_uvComplete && !uvIsStarted(0) && !g_uvStartGuard) {
            g_uvStartGuard = true;  // Set guard BEFORE calling uvStart()
-           FSM_DBG_PRINTLN("SUB2 ENTRY: DRY -> Both shoes dry, starting single UV on GPIO14");
-           uvStart(0, 0);
+           // Every bay is in DRY with no grant left, so the UV share always fits
+           g_power.request(POWER_CLIENT_UV, POWER_UV_W, 0.0f, millis());
+           for (uint8_t i = 0; i < NUM_BAYS; ++i)
+             profMark(i, CyclePhase::Uv, PhaseEnd::Dry);
+           FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINTLN(" ENTRY: DRY -> All shoes dry, starting single UV on GPIO14");
+           uvStart(0, g_uvResumeMs);  // a resumed cycle runs only the UV time left
+           g_uvResumeMs = 0;
          } else {
-           FSM_DBG_PRINTLN("SUB2 ENTRY: DRY -> Waiting for other shoe or UV to complete");
+           FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINTLN(" ENTRY: DRY -> Waiting for other shoes or UV to complete");
          }
        },
-       nullptr},
-      // S_DONE: release WET lock when done
+       nullptr, nullptr},
+      // S_DONE: drop any power grant left over
       {SubState::S_DONE,
-       []() {
-         FSM_DBG_PRINTLN("SUB2 ENTRY: DONE - releasing WET lock");
-         if (g_wetLockOwner == 1) {
-           g_wetLockOwner = -1;
-           FSM_DBG_PRINTLN("SUB2: Released WET lock on DONE");
-         }
+       [](uint8_t idx) {
+         FSM_DBG_PRINT(subLabel(idx)); FSM_DBG_PRINTLN(" ENTRY: DONE - releasing power");
+         g_power.release(idx);
+         profEmit(idx);
        },
-       nullptr}};
-
-  for (auto &c : global_cbs) {
-    if (c.entry)
-      fsmGlobal.setEntry(c.s, c.entry);
-    if (c.exit)
-      fsmGlobal.setExit(c.s, c.exit);
-  }
-  for (auto &c : sub1_cbs) {
-    if (c.entry)
-      fsmSub1.setEntry(c.s, c.entry);
-    if (c.exit)
-      fsmSub1.setExit(c.s, c.exit);
-  }
-  for (auto &c : sub2_cbs) {
-    if (c.entry)
-      fsmSub2.setEntry(c.s, c.entry);
-    if (c.exit)
-      fsmSub2.setExit(c.s, c.exit);
-  }
-
-  // Per-state run callbacks to handle time-based progression and checks
-  // S_WAITING run: priority-based WET lock acquisition
-  // If WET lock is free, acquire it and transition to WET
-  // Priority: wetter shoe (higher AH diff) gets lock first
-  fsmSub1.setRun(SubState::S_WAITING, []() {
-    // Guard against repeated event posting (watchdog protection)
-    if (g_waitingEventPosted[0])
-      return;
-
-    // Do not start WET if the other shoe is in COOLING motor phase (avoid motor overlap)
-    if (coolingMotorPhaseActive(1))
-      return;
-
-    if (g_wetLockOwner == -1) {
-      // Lock is free, check priority vs sub2
-      if (fsmSub2.getState() == SubState::S_WAITING) {
-        // Both waiting, give priority to wetter shoe
-        float diff0 = g_dhtAHDiff[0];
-        float diff1 = g_dhtAHDiff[1];
-        if (diff0 >= diff1) {
-          // SUB1 is wetter or equal, acquire lock
-          g_wetLockOwner = 0;
-          FSM_DBG_PRINTLN("SUB1: Acquired WET lock (priority)");
-          g_waitingEventPosted[0] = true;
-          fsmSub1.handleEvent(Event::SubStart);
-        }
-        // else: wait for SUB2 to acquire lock
-
-          // Read and cache battery voltage for UI display
-          g_lastBatteryVoltage = readBatteryVoltage();
-      } else {
-        // SUB2 not waiting, acquire lock
-        g_wetLockOwner = 0;
-        FSM_DBG_PRINTLN("SUB1: Acquired WET lock");
-        g_waitingEventPosted[0] = true;
-        fsmSub1.handleEvent(Event::SubStart);
-      }
-    }
-  });
-
-  fsmSub2.setRun(SubState::S_WAITING, []() {
-    // Guard against repeated event posting (watchdog protection)
-    if (g_waitingEventPosted[1])
-      return;
-
-    // Do not start WET if the other shoe is in COOLING motor phase (avoid motor overlap)
-    if (coolingMotorPhaseActive(0))
-      return;
-
-    if (g_wetLockOwner == -1) {
-      // Lock is free, check priority vs sub1
-      if (fsmSub1.getState() == SubState::S_WAITING) {
-        // Both waiting, give priority to wetter shoe
-        float diff0 = g_dhtAHDiff[0];
-        float diff1 = g_dhtAHDiff[1];
-        if (diff1 > diff0) {
-          // SUB2 is wetter, acquire lock
-          g_wetLockOwner = 1;
-          FSM_DBG_PRINTLN("SUB2: Acquired WET lock (priority)");
-          g_waitingEventPosted[1] = true;
-          fsmSub2.handleEvent(Event::SubStart);
-        }
-        // else: wait for SUB1 to acquire lock
-      } else {
-        // SUB1 not waiting, acquire lock
-        g_wetLockOwner = 1;
-        FSM_DBG_PRINTLN("SUB2: Acquired WET lock");
-        g_waitingEventPosted[1] = true;
-        fsmSub2.handleEvent(Event::SubStart);
-      }
-    }
-  });
-
-  // S_WET run: WARMUP PHASE (30-50s), then normal WET with trend-gated heater control
-  fsmSub1.setRun(SubState::S_WET, []() {
-    uint32_t now = millis();
-    uint32_t wetElapsed = (g_subWetStartMs[0] != 0) ? (now - g_subWetStartMs[0]) : 0;
-    
-    // ==================== WARMUP PHASE (30-50s at 60% motor + heater) ====================
-    // During this phase, heater warms shoe WITHOUT trend-gated control interference
-    // Motor runs at fixed 60% to avoid friction heating
-    if (g_heaterWarmupStartMs[0] == 0 && !g_heaterWarmupDone[0]) {
-      // First time entering WET - start warmup
-      g_heaterWarmupStartMs[0] = now;
-      heaterRun(0, true);  // Heater ON
-      // NOTE: Do NOT call motorStart() yet - only set duty directly at 60%
-      // motorStart() initializes PID which immediately overrides our 60% setpoint
-      motorSetDutyPercent(0, 60);  // Manual 60% duty without PID
-      FSM_DBG_PRINTLN("SUB1: Warmup phase START (30-50s at 60% motor + heater)");
-    }
-    
-    // Monitor heater warmup phase progression
-    if (g_heaterWarmupStartMs[0] != 0 && !g_heaterWarmupDone[0]) {
-      uint32_t warmupElapsed = now - g_heaterWarmupStartMs[0];
-      
-      // Determine warmup duration (cold shoe gets extra time)
-      uint32_t targetWarmupMs = HEATER_WARMUP_MIN_MS;  // 30s default
-      float shoeTemp = g_dhtTemp[1];  // Sensor 1 = shoe 0
-      if (!isnan(shoeTemp) && shoeTemp < 25.0f) {
-        targetWarmupMs = HEATER_WARMUP_EXTENDED_MS;  // 50s for cold shoes
-        if (warmupElapsed == 0 || (warmupElapsed >= HEATER_WARMUP_MIN_MS - 1000 && warmupElapsed < HEATER_WARMUP_MIN_MS)) {
-          FSM_DBG_PRINT("SUB1: Cold shoe detected (");
-          FSM_DBG_PRINT(shoeTemp, 1);
-          FSM_DBG_PRINTLN("C) -> extended warmup 50s");
-        }
-      }
-
-      // ===== EXPLICIT IF/ELSE STRUCTURE TO PREVENT DOUBLE MOTORSTART =====
-      if (!isnan(shoeTemp) && shoeTemp >= HEATER_WET_TEMP_THRESHOLD_C) {
-        // Temperature threshold met - end warmup immediately
-        FSM_DBG_PRINT("SUB1: Warmup threshold reached (");
-        FSM_DBG_PRINT(shoeTemp, 1);
-        FSM_DBG_PRINTLN("C) -> heater OFF, switch to trend-gated control");
-        g_heaterWarmupDone[0] = true;
-        // Turn heater OFF at threshold, then allow trend gating to manage it
-        heaterRun(0, false);
-        // Start motor PID control now
-        motorStart(0);
-        // Reset AH rate tracking when starting PID control
-        g_ahRateSampleCount[0] = 0;
-        g_consecutiveNegativeCount[0] = 0;
-        g_lastAHRateSampleMs[0] = now;
-        g_prevAHRate[0] = 0.0f;
-      } else if (warmupElapsed < targetWarmupMs) {
-        // Still in warmup phase - keep heater ON, motor at 60%
-        return;  // Skip the rest of WET logic until warmup is done
-      } else {
-        // Time threshold met - time-based completion fallback
-        FSM_DBG_PRINTLN("SUB1: Warmup time complete -> transition to trend-gated WET (PID motor control)");
-        g_heaterWarmupDone[0] = true;
-        heaterRun(0, false);  // Ensure heater OFF before starting motor control
-        motorStart(0);
-        g_ahRateSampleCount[0] = 0;
-        g_consecutiveNegativeCount[0] = 0;
-        g_lastAHRateSampleMs[0] = now;
-        g_prevAHRate[0] = 0.0f;
-      }
-    }
-    
-    // ==================== NORMAL WET PHASE (after warmup) ====================
-    // Heater is now controlled by trend-gating (maybeEarlyHeaterOff)
-    // Motor duty will be managed by PID control (AH rate monitoring)
-
-    if (g_heaterWarmupDone[0] && g_subWetStartMs[0] != 0) {
-      // Apply trend-based heater control throughout the remainder of WET
-      maybeEarlyHeaterOff(0, wetElapsed);
-    }
-
-    // Sample AH rate every 2 seconds and check for peak (declining rate)
-    // But wait AH_ACCEL_WARMUP_MS (30s) after WET start before checking for decline
-    if (g_heaterWarmupDone[0] && g_subWetStartMs[0] != 0) {
-      // Early return if sampling interval hasn't elapsed (prevent tight loop)
-      if ((uint32_t)(now - g_lastAHRateSampleMs[0]) < 2000) {
-        return;
-      }
-      
-      g_lastAHRateSampleMs[0] = now;
-      float currentRate = g_dhtAHRate[0];  // Use actual AH rate-of-change from motor control
-      float currentAHDiff = g_dhtAHDiff[0];  // Get current AH diff for safety checks
-      
-      // Validate rate before processing (reject NaN/Inf from sensor glitches)
-      if (isnan(currentRate) || isinf(currentRate)) {
-        return;  // Skip this sample, wait for next valid rate
-      }
-      
-      // ==================== PEAK-DETECTED: IN POST-PEAK BUFFER PHASE ====================
-      if (g_peakDetected[0]) {
-        uint32_t bufferElapsed = (uint32_t)(now - g_peakDetectedMs[0]);
-        
-        // SAFETY CHECK: Verify AH diff hasn't dropped to unexpected low values (sensor noise/glitch)
-        if (!isnan(currentAHDiff) && currentAHDiff > 0.1f) {
-          g_lastValidAHDiff[0] = currentAHDiff;
-          g_lastAHDiffCheckMs[0] = now;
-        }
-        
-        // Still in post-peak buffer period
-        if (bufferElapsed < g_peakBufferMs[0]) {
-          // Continue monitoring evaporation during buffer
-          uint32_t bufferRemaining = g_peakBufferMs[0] - bufferElapsed;
-          FSM_DBG_PRINT("SUB1: WET in post-peak buffer (");
-          FSM_DBG_PRINT(bufferRemaining);
-          FSM_DBG_PRINT("ms remaining, diff=");
-          FSM_DBG_PRINT(currentAHDiff, 2);
-          FSM_DBG_PRINTLN("g/m^3)");
-          return;
-        }
-        
-        // Buffer period expired - check safety conditions before exiting to COOLING
-        uint32_t minDurationRemaining = (wetElapsed >= g_wetMinDurationMs[0]) ? 0 : (g_wetMinDurationMs[0] - wetElapsed);
-        
-        // Dynamic buffer extension: if current AH rose above initial, extend buffer duration
-        // This handles shoes that got wetter during WET phase
-        uint32_t adaptiveBufferMs = g_peakBufferMs[0];
-        if (currentAHDiff > g_initialWetDiff[0] + 0.5f) {
-          // Shoe got significantly wetter during WET phase - extend buffer
-          // Use 4-tier thresholds based on CURRENT moisture level
-          if (currentAHDiff < 1.5f) {
-            adaptiveBufferMs = WET_BUFFER_BARELY_WET_MS;  // 40s
-          } else if (currentAHDiff < 3.5f) {
-            adaptiveBufferMs = WET_BUFFER_MODERATE_MS;    // 75s (normal)
-          } else if (currentAHDiff < 5.0f) {
-            adaptiveBufferMs = WET_BUFFER_VERY_WET_MS;    // 100s
-          } else {
-            adaptiveBufferMs = WET_BUFFER_SOAKED_MS;      // 120s
-          }
-          
-          // Re-check if buffer has actually expired with the new duration
-          if (bufferElapsed < adaptiveBufferMs) {
-            uint32_t adaptiveRemaining = adaptiveBufferMs - bufferElapsed;
-            FSM_DBG_PRINT("SUB1: WET buffer extended (moisture rose: ");
-            FSM_DBG_PRINT(g_initialWetDiff[0], 1);
-            FSM_DBG_PRINT(" -> ");
-            FSM_DBG_PRINT(currentAHDiff, 1);
-            FSM_DBG_PRINT("g/m^3), remaining=");
-            FSM_DBG_PRINT(adaptiveRemaining);
-            FSM_DBG_PRINTLN("ms");
-            return;
-          }
-        }
-      
-        // Temperature-based buffer hold: if shoe is still hot, extend buffer by 30s
-        float tC0 = g_dhtTemp[1];
-        if (!isnan(tC0) && tC0 >= WET_BUFFER_TEMP_HOT_C) {
-          if (bufferElapsed < g_peakBufferMs[0] + WET_BUFFER_TEMP_EXTEND_MS) {
-            uint32_t remain = (g_peakBufferMs[0] + WET_BUFFER_TEMP_EXTEND_MS) - bufferElapsed;
-            FSM_DBG_PRINT("SUB1: WET buffer temp-hold (t=");
-            FSM_DBG_PRINT(tC0, 1);
-            FSM_DBG_PRINT("C), remaining=");
-            FSM_DBG_PRINT(remain);
-            FSM_DBG_PRINTLN("ms");
-            return;
-          }
-        }
-        
-        // SAFETY: Require AH diff to still be reasonable (not accidental low reading)
-        bool safeAHLevel = (currentAHDiff > AH_DIFF_SAFETY_MARGIN) || (g_lastValidAHDiff[0] > AH_DIFF_SAFETY_MARGIN + 0.2f);
-        bool minDurationMet = (minDurationRemaining == 0);
-        
-        if (minDurationMet && safeAHLevel) {
-          FSM_DBG_PRINT("SUB1: WET peak + buffer complete, diff=");
-          FSM_DBG_PRINT(currentAHDiff, 2);
-          FSM_DBG_PRINTLN("g/m^3 -> transition to COOLING");
-          fsmSub1.handleEvent(Event::SubStart);
-          g_ahRateSampleCount[0] = 0;
-          g_consecutiveNegativeCount[0] = 0;
-          g_peakDetected[0] = false;
-          g_peakDetectedMs[0] = 0;
-          return;
-        } else if (minDurationMet && !safeAHLevel) {
-          // AH diff dropped too low - might be sensor glitch, wait longer
-          FSM_DBG_PRINT("SUB1: WET safety check - diff dropped to ");
-          FSM_DBG_PRINT(currentAHDiff, 2);
-          FSM_DBG_PRINTLN("g/m^3 (below safety margin), waiting for stabilization...");
-          return;
-        } else {
-          // Minimum duration not yet reached
-          FSM_DBG_PRINT("SUB1: WET waiting for minimum duration (");
-          FSM_DBG_PRINT(minDurationRemaining);
-          FSM_DBG_PRINT("ms remaining, diff=");
-          FSM_DBG_PRINT(currentAHDiff, 2);
-          FSM_DBG_PRINTLN("g/m^3)");
-          return;
-        }
-      }
-      
-      // ==================== BEFORE PEAK: MONITOR EVAPORATION RATE ====================
-      // Track minimum AH diff seen (to detect true evaporation bottom)
-      if (wetElapsed >= AH_ACCEL_WARMUP_MS && currentAHDiff < g_minAHDiffSeen[0]) {
-        g_minAHDiffSeen[0] = currentAHDiff;
-        g_minAHDiffSeenMs[0] = now;
-      }
-      
-      // Early peak detection: if AH has risen significantly above minimum, we passed the peak
-      // Adaptive gate by initial wetness
-      uint32_t minRiseTime0;
-      float riseThreshold0;
-      if (g_initialWetDiff[0] < AH_DIFF_BARELY_WET) { // barely wet
-        minRiseTime0 = 60000u; riseThreshold0 = 0.6f;
-      } else if (g_initialWetDiff[0] < AH_DIFF_MODERATE_WET) { // moderate
-        minRiseTime0 = 90000u; riseThreshold0 = 0.6f;
-      } else if (g_initialWetDiff[0] < AH_DIFF_VERY_WET) { // very wet
-        minRiseTime0 = 120000u; riseThreshold0 = 0.8f;
-      } else { // soaked
-        minRiseTime0 = 150000u; riseThreshold0 = 1.0f;
-      }
-      if (wetElapsed >= minRiseTime0 && g_minAHDiffSeen[0] < g_initialWetDiff[0] - 0.5f) {
-        // We've seen a significant drop (good evaporation happened)
-        float riseFromMin = currentAHDiff - g_minAHDiffSeen[0];
-        if (riseFromMin > riseThreshold0) {
-          // AH has risen >riseThreshold g/m^3 from minimum - we missed the peak!
-          FSM_DBG_PRINT("SUB1: WET RISE detection - min was ");
-          FSM_DBG_PRINT(g_minAHDiffSeen[0], 2);
-          FSM_DBG_PRINT(" now ");
-          FSM_DBG_PRINT(currentAHDiff, 2);
-          FSM_DBG_PRINT(" (rose +");
-          FSM_DBG_PRINT(riseFromMin, 2);
-          FSM_DBG_PRINTLN(") -> peak passed, starting buffer");
-          g_peakDetected[0] = true;
-          g_peakDetectedMs[0] = g_minAHDiffSeenMs[0];  // Use time when minimum was seen
-          g_consecutiveNegativeCount[0] = 0;
-          g_lastValidAHDiff[0] = currentAHDiff;
-          heaterRun(0, false);
-          return;
-        }
-      }
-      
-      // Peak detection using moving-average decline
-      if (wetElapsed >= AH_ACCEL_WARMUP_MS) {
-        // Update rate history buffer
-        g_rateHistory[0][g_rateHistoryIdx[0]] = currentRate;
-        g_rateHistoryIdx[0] = (g_rateHistoryIdx[0] + 1) % 8;
-        if (g_rateHistoryCount[0] < 8) g_rateHistoryCount[0]++;
-
-        if (g_rateHistoryCount[0] >= 6) { // need enough samples
-          // Compute averages for two windows: recent (last 3) vs previous (prior 3)
-          float recentAvg = 0.0f, previousAvg = 0.0f;
-          // Indices for last 3 samples
-          int i2 = (g_rateHistoryIdx[0] - 1 + 8) % 8;
-          int i1 = (g_rateHistoryIdx[0] - 2 + 8) % 8;
-          int i0 = (g_rateHistoryIdx[0] - 3 + 8) % 8;
-          // Indices for previous 3 samples
-          int j2 = (g_rateHistoryIdx[0] - 4 + 8) % 8;
-          int j1 = (g_rateHistoryIdx[0] - 5 + 8) % 8;
-          int j0 = (g_rateHistoryIdx[0] - 6 + 8) % 8;
-          recentAvg = (g_rateHistory[0][i0] + g_rateHistory[0][i1] + g_rateHistory[0][i2]) / 3.0f;
-          previousAvg = (g_rateHistory[0][j0] + g_rateHistory[0][j1] + g_rateHistory[0][j2]) / 3.0f;
-
-          float avgChange = recentAvg - previousAvg;
-          FSM_DBG_PRINT("SUB1: WET avg recent="); FSM_DBG_PRINT(recentAvg);
-          FSM_DBG_PRINT(" prevAvg="); FSM_DBG_PRINT(previousAvg);
-          FSM_DBG_PRINT(" change="); FSM_DBG_PRINT(avgChange);
-          FSM_DBG_PRINT(" diff="); FSM_DBG_PRINT(currentAHDiff, 2);
-          FSM_DBG_PRINTLN("g/m^3");
-
-          if (avgChange < AH_RATE_DECLINE_THRESHOLD) {
-            g_consecutiveNegativeCount[0]++;
-          } else {
-            g_consecutiveNegativeCount[0] = 0;
-          }
-
-          // Robust peak detection with 4-tier adaptive thresholds
-          uint32_t minPeakTimeMs;
-          float peakRateThreshold;
-          
-          if (g_initialWetDiff[0] < AH_DIFF_BARELY_WET) {
-            // Barely wet: quick peak detection to save power
-            minPeakTimeMs = 60u * 1000u;  // 60s
-            peakRateThreshold = 0.2f;     // Low threshold
-          } else if (g_initialWetDiff[0] < AH_DIFF_MODERATE_WET) {
-            // Moderate: normal thresholds
-            minPeakTimeMs = AH_PEAK_NORMAL_MIN_TIME_MS;           // 120s
-            peakRateThreshold = AH_RATE_NORMAL_PEAK_THRESHOLD;    // 0.35
-          } else if (g_initialWetDiff[0] < AH_DIFF_VERY_WET) {
-            // Very wet: stricter thresholds
-            minPeakTimeMs = 180u * 1000u;    // 180s
-            peakRateThreshold = 0.50f;       // 0.50
-          } else {
-            // Soaked: most stringent thresholds
-            minPeakTimeMs = AH_PEAK_WET_MIN_TIME_MS;        // 240s
-            peakRateThreshold = AH_RATE_WET_PEAK_THRESHOLD; // 0.60
-          }
-
-          bool decliningEnough = (g_consecutiveNegativeCount[0] >= MIN_CONSECUTIVE_NEGATIVE) && (avgChange < -0.05f);
-          bool rateIsLow = (recentAvg < peakRateThreshold);
-          bool hasSpentEnoughTime = (wetElapsed >= minPeakTimeMs);
-          
-          if (decliningEnough && rateIsLow && hasSpentEnoughTime) {
-            FSM_DBG_PRINT("SUB1: WET peak (rate=");
-            FSM_DBG_PRINT(recentAvg, 2);
-            FSM_DBG_PRINT("<");
-            FSM_DBG_PRINT(peakRateThreshold, 2);
-            FSM_DBG_PRINT(", time=");
-            FSM_DBG_PRINT(wetElapsed/1000);
-            FSM_DBG_PRINT("s>=");
-            FSM_DBG_PRINT(minPeakTimeMs/1000);
-            FSM_DBG_PRINT("s) -> ");
-            FSM_DBG_PRINT(g_peakBufferMs[0]/1000);
-            FSM_DBG_PRINTLN("s buffer");
-            g_peakDetected[0] = true;
-            g_peakDetectedMs[0] = now;
-            g_consecutiveNegativeCount[0] = 0;
-            g_lastValidAHDiff[0] = currentAHDiff;
-            // Heater continues during peak detection for extra heating time
-            FSM_DBG_PRINTLN("SUB1: WET peak detected, entering post-peak buffer (heater continues)");
-          }
-        }
-      }
-      g_prevAHRate[0] = currentRate;
-      g_ahRateSampleCount[0]++;
-    }
-    
-    // ==================== WET PHASE SAFETY TIMEOUT ====================
-    // Prevent indefinite WET phase if peak detection never triggers or succeeds
-    if (g_heaterWarmupDone[0] && g_subWetStartMs[0] != 0) {
-      uint32_t now = millis();
-      uint32_t wetElapsed = (uint32_t)(now - g_wetPhaseStartMs[0]);
-      
-      // Determine maximum WET duration based on initial wetness level
-      uint32_t wetMaxMs = WET_BARELY_WET_MAX_MS;
-      if (g_initialWetDiff[0] < AH_DIFF_BARELY_WET) {
-        wetMaxMs = WET_BARELY_WET_MAX_MS;         // 5 min
-      } else if (g_initialWetDiff[0] < AH_DIFF_MODERATE_WET) {
-        wetMaxMs = WET_MODERATE_MAX_MS;           // 9 min
-      } else if (g_initialWetDiff[0] < AH_DIFF_VERY_WET) {
-        wetMaxMs = WET_VERY_WET_MAX_MS;           // 12 min
-      } else {
-        wetMaxMs = WET_SOAKED_MAX_MS;             // 15 min
-      }
-      
-      if (wetElapsed >= wetMaxMs && !g_peakDetected[0]) {
-        // Timeout reached and no peak detected - force transition to COOLING
-        FSM_DBG_PRINT("SUB1: WET timeout (no peak detected after ");
-        FSM_DBG_PRINT(wetElapsed/1000);
-        FSM_DBG_PRINT("s, limit=");
-        FSM_DBG_PRINT(wetMaxMs/1000);
-        FSM_DBG_PRINTLN("s) -> COOLING");
-        heaterRun(0, false);
-        motorStop(0);
-        g_ahRateSampleCount[0] = 0;
-        g_consecutiveNegativeCount[0] = 0;
-        startCoolingPhase(0, false);
-        return;
-      }
-    }
-  });
-  fsmSub2.setRun(SubState::S_WET, []() {
-    uint32_t now = millis();
-    uint32_t wetElapsed = (g_subWetStartMs[1] != 0) ? (now - g_subWetStartMs[1]) : 0;
-    
-    // ==================== WARMUP PHASE (30-50s at 60% motor + heater) ====================
-    // During this phase, heater warms shoe WITHOUT trend-gated control interference
-    // Motor runs at fixed 60% to avoid friction heating
-    if (g_heaterWarmupStartMs[1] == 0 && !g_heaterWarmupDone[1]) {
-      // First time entering WET - start warmup
-      g_heaterWarmupStartMs[1] = now;
-      heaterRun(1, true);  // Heater ON
-      // NOTE: Do NOT call motorStart() yet - only set duty directly at 60%
-      // motorStart() initializes PID which immediately overrides our 60% setpoint
-      motorSetDutyPercent(1, 60);  // Manual 60% duty without PID
-      FSM_DBG_PRINTLN("SUB2: Warmup phase START (30-50s at 60% motor + heater)");
-    }
-    
-    // Monitor heater warmup phase progression
-    if (g_heaterWarmupStartMs[1] != 0 && !g_heaterWarmupDone[1]) {
-      uint32_t warmupElapsed = now - g_heaterWarmupStartMs[1];
-      
-      // Determine warmup duration (cold shoe gets extra time)
-      uint32_t targetWarmupMs = HEATER_WARMUP_MIN_MS;  // 30s default
-      float shoeTemp = g_dhtTemp[2];  // Sensor 2 = shoe 1
-      if (!isnan(shoeTemp) && shoeTemp < 25.0f) {
-        targetWarmupMs = HEATER_WARMUP_EXTENDED_MS;  // 50s for cold shoes
-        if (warmupElapsed == 0 || (warmupElapsed >= HEATER_WARMUP_MIN_MS - 1000 && warmupElapsed < HEATER_WARMUP_MIN_MS)) {
-          FSM_DBG_PRINT("SUB2: Cold shoe detected (");
-          FSM_DBG_PRINT(shoeTemp, 1);
-          FSM_DBG_PRINTLN("C) -> extended warmup 50s");
-        }
-      }
-
-      // ===== EXPLICIT IF/ELSE STRUCTURE TO PREVENT DOUBLE MOTORSTART =====
-      if (!isnan(shoeTemp) && shoeTemp >= HEATER_WET_TEMP_THRESHOLD_C) {
-        // Temperature threshold met - end warmup immediately
-        FSM_DBG_PRINT("SUB2: Warmup threshold reached (");
-        FSM_DBG_PRINT(shoeTemp, 1);
-        FSM_DBG_PRINTLN("C) -> heater OFF, switch to trend-gated control");
-        g_heaterWarmupDone[1] = true;
-        heaterRun(1, false);
-        motorStart(1);
-        g_ahRateSampleCount[1] = 0;
-        g_consecutiveNegativeCount[1] = 0;
-        g_lastAHRateSampleMs[1] = now;
-        g_prevAHRate[1] = 0.0f;
-      } else if (warmupElapsed < targetWarmupMs) {
-        // Still in warmup phase - keep heater ON, motor at 60%
-        return;  // Skip the rest of WET logic until warmup is done
-      } else {
-        // Time threshold met - time-based completion fallback
-        FSM_DBG_PRINTLN("SUB2: Warmup time complete -> transition to trend-gated WET (PID motor control)");
-        g_heaterWarmupDone[1] = true;
-        heaterRun(1, false);  // Ensure heater OFF before starting motor control
-        motorStart(1);
-        g_ahRateSampleCount[1] = 0;
-        g_consecutiveNegativeCount[1] = 0;
-        g_lastAHRateSampleMs[1] = now;
-        g_prevAHRate[1] = 0.0f;
-      }
-    }
-    
-    // ==================== NORMAL WET PHASE (after warmup) ====================
-    // Heater is now controlled by trend-gating (maybeEarlyHeaterOff)
-    // Motor duty will be managed by PID control (AH rate monitoring)
-    
-    if (g_heaterWarmupDone[1] && g_subWetStartMs[1] != 0) {
-      // Apply trend-based heater control throughout the remainder of WET
-      maybeEarlyHeaterOff(1, wetElapsed);
-    }
-
-    // Sample AH rate every 2 seconds and check for peak (declining rate)
-    // But wait AH_ACCEL_WARMUP_MS (30s) after WET start before checking for decline
-    if (g_heaterWarmupDone[1] && g_subWetStartMs[1] != 0) {
-      // Early return if sampling interval hasn't elapsed (prevent tight loop)
-      if ((uint32_t)(now - g_lastAHRateSampleMs[1]) < 2000) {
-        return;
-      }
-      
-      g_lastAHRateSampleMs[1] = now;
-      float currentRate = g_dhtAHRate[1];  // Use actual AH rate-of-change from motor control
-      float currentAHDiff = g_dhtAHDiff[1];  // Get current AH diff for safety checks
-      
-      // Validate rate before processing (reject NaN/Inf from sensor glitches)
-      if (isnan(currentRate) || isinf(currentRate)) {
-        return;  // Skip this sample, wait for next valid rate
-      }
-      
-      // ==================== PEAK-DETECTED: IN POST-PEAK BUFFER PHASE ====================
-      if (g_peakDetected[1]) {
-        uint32_t bufferElapsed = (uint32_t)(now - g_peakDetectedMs[1]);
-        
-        // SAFETY CHECK: Verify AH diff hasn't dropped to unexpected low values (sensor noise/glitch)
-        if (!isnan(currentAHDiff) && currentAHDiff > 0.1f) {
-          g_lastValidAHDiff[1] = currentAHDiff;
-          g_lastAHDiffCheckMs[1] = now;
-        }
-        
-        // Still in post-peak buffer period
-        if (bufferElapsed < g_peakBufferMs[1]) {
-          // Continue monitoring evaporation during buffer
-          uint32_t bufferRemaining = g_peakBufferMs[1] - bufferElapsed;
-          FSM_DBG_PRINT("SUB2: WET in post-peak buffer (");
-          FSM_DBG_PRINT(bufferRemaining);
-          FSM_DBG_PRINT("ms remaining, diff=");
-          FSM_DBG_PRINT(currentAHDiff, 2);
-          FSM_DBG_PRINTLN("g/m^3)");
-          return;
-        }
-        
-        // Buffer period expired - check safety conditions before exiting to COOLING
-        uint32_t minDurationRemaining = (wetElapsed >= g_wetMinDurationMs[1]) ? 0 : (g_wetMinDurationMs[1] - wetElapsed);
-        
-        // Dynamic buffer extension: if current AH rose above initial, extend buffer duration
-        // This handles shoes that got wetter during WET phase
-        uint32_t adaptiveBufferMs = g_peakBufferMs[1];
-        if (currentAHDiff > g_initialWetDiff[1] + 0.5f) {
-          // Shoe got significantly wetter during WET phase - extend buffer
-          // Use 4-tier thresholds based on CURRENT moisture level
-          if (currentAHDiff < 1.5f) {
-            adaptiveBufferMs = WET_BUFFER_BARELY_WET_MS;  // 40s
-          } else if (currentAHDiff < 3.5f) {
-            adaptiveBufferMs = WET_BUFFER_MODERATE_MS;    // 75s (normal)
-          } else if (currentAHDiff < 5.0f) {
-            adaptiveBufferMs = WET_BUFFER_VERY_WET_MS;    // 100s
-          } else {
-            adaptiveBufferMs = WET_BUFFER_SOAKED_MS;      // 120s
-          }
-          
-          // Re-check if buffer has actually expired with the new duration
-          if (bufferElapsed < adaptiveBufferMs) {
-            uint32_t adaptiveRemaining = adaptiveBufferMs - bufferElapsed;
-            FSM_DBG_PRINT("SUB2: WET buffer extended (moisture rose: ");
-            FSM_DBG_PRINT(g_initialWetDiff[1], 1);
-            FSM_DBG_PRINT(" -> ");
-            FSM_DBG_PRINT(currentAHDiff, 1);
-            FSM_DBG_PRINT("g/m^3), remaining=");
-            FSM_DBG_PRINT(adaptiveRemaining);
-            FSM_DBG_PRINTLN("ms");
-            return;
-          }
-        }
-        
-        // Temperature-based buffer hold: if shoe is still hot, extend buffer by 30s
-        float tC1 = g_dhtTemp[2];
-        if (!isnan(tC1) && tC1 >= WET_BUFFER_TEMP_HOT_C) {
-          if (bufferElapsed < g_peakBufferMs[1] + WET_BUFFER_TEMP_EXTEND_MS) {
-            uint32_t remain = (g_peakBufferMs[1] + WET_BUFFER_TEMP_EXTEND_MS) - bufferElapsed;
-            FSM_DBG_PRINT("SUB2: WET buffer temp-hold (t=");
-            FSM_DBG_PRINT(tC1, 1);
-            FSM_DBG_PRINT("C), remaining=");
-            FSM_DBG_PRINT(remain);
-            FSM_DBG_PRINTLN("ms");
-            return;
-          }
-        }
-        
-        // SAFETY: Require AH diff to still be reasonable (not accidental low reading)
-        bool safeAHLevel = (currentAHDiff > AH_DIFF_SAFETY_MARGIN) || (g_lastValidAHDiff[1] > AH_DIFF_SAFETY_MARGIN + 0.2f);
-        bool minDurationMet = (minDurationRemaining == 0);
-        
-        if (minDurationMet && safeAHLevel) {
-          FSM_DBG_PRINT("SUB2: WET peak + buffer complete, diff=");
-          FSM_DBG_PRINT(currentAHDiff, 2);
-          FSM_DBG_PRINTLN("g/m^3 -> transition to COOLING");
-          fsmSub2.handleEvent(Event::SubStart);
-          g_ahRateSampleCount[1] = 0;
-          g_consecutiveNegativeCount[1] = 0;
-          g_peakDetected[1] = false;
-          g_peakDetectedMs[1] = 0;
-          return;
-        } else if (minDurationMet && !safeAHLevel) {
-          // AH diff dropped too low - might be sensor glitch, wait longer
-          FSM_DBG_PRINT("SUB2: WET safety check - diff dropped to ");
-          FSM_DBG_PRINT(currentAHDiff, 2);
-          FSM_DBG_PRINTLN("g/m^3 (below safety margin), waiting for stabilization...");
-          return;
-        } else {
-          // Minimum duration not yet reached
-          FSM_DBG_PRINT("SUB2: WET waiting for minimum duration (");
-          FSM_DBG_PRINT(minDurationRemaining);
-          FSM_DBG_PRINT("ms remaining, diff=");
-          FSM_DBG_PRINT(currentAHDiff, 2);
-          FSM_DBG_PRINTLN("g/m^3)");
-          return;
-        }
-      }
-      
-      // ==================== BEFORE PEAK: MONITOR EVAPORATION RATE ====================
-      // Track minimum AH diff seen (to detect true evaporation bottom)
-      if (wetElapsed >= AH_ACCEL_WARMUP_MS && currentAHDiff < g_minAHDiffSeen[1]) {
-        g_minAHDiffSeen[1] = currentAHDiff;
-        g_minAHDiffSeenMs[1] = now;
-      }
-      
-      // Early peak detection: if AH has risen significantly above minimum, we passed the peak
-      // Adaptive gate by initial wetness
-      uint32_t minRiseTime1;
-      float riseThreshold1;
-      if (g_initialWetDiff[1] < AH_DIFF_BARELY_WET) { // barely wet
-        minRiseTime1 = 60000u; riseThreshold1 = 0.6f;
-      } else if (g_initialWetDiff[1] < AH_DIFF_MODERATE_WET) { // moderate
-        minRiseTime1 = 90000u; riseThreshold1 = 0.6f;
-      } else if (g_initialWetDiff[1] < AH_DIFF_VERY_WET) { // very wet
-        minRiseTime1 = 120000u; riseThreshold1 = 0.8f;
-      } else { // soaked
-        minRiseTime1 = 150000u; riseThreshold1 = 1.0f;
-      }
-      if (wetElapsed >= minRiseTime1 && g_minAHDiffSeen[1] < g_initialWetDiff[1] - 0.5f) {
-        // We've seen a significant drop (good evaporation happened)
-        float riseFromMin = currentAHDiff - g_minAHDiffSeen[1];
-        if (riseFromMin > riseThreshold1) {
-          // AH has risen >riseThreshold g/m^3 from minimum - we missed the peak!
-          FSM_DBG_PRINT("SUB2: WET RISE detection - min was ");
-          FSM_DBG_PRINT(g_minAHDiffSeen[1], 2);
-          FSM_DBG_PRINT(" now ");
-          FSM_DBG_PRINT(currentAHDiff, 2);
-          FSM_DBG_PRINT(" (rose +");
-          FSM_DBG_PRINT(riseFromMin, 2);
-          FSM_DBG_PRINTLN(") -> peak passed, starting buffer");
-          g_peakDetected[1] = true;
-          g_peakDetectedMs[1] = g_minAHDiffSeenMs[1];  // Use time when minimum was seen
-          g_consecutiveNegativeCount[1] = 0;
-          g_lastValidAHDiff[1] = currentAHDiff;
-          heaterRun(1, false);
-          return;
-        }
-      }
-      
-      // Peak detection using moving-average decline
-      if (wetElapsed >= AH_ACCEL_WARMUP_MS) {
-        // Update rate history buffer
-        g_rateHistory[1][g_rateHistoryIdx[1]] = currentRate;
-        g_rateHistoryIdx[1] = (g_rateHistoryIdx[1] + 1) % 8;
-        if (g_rateHistoryCount[1] < 8) g_rateHistoryCount[1]++;
-
-        if (g_rateHistoryCount[1] >= 6) {
-          float recentAvg = 0.0f, previousAvg = 0.0f;
-          int i2 = (g_rateHistoryIdx[1] - 1 + 8) % 8;
-          int i1 = (g_rateHistoryIdx[1] - 2 + 8) % 8;
-          int i0 = (g_rateHistoryIdx[1] - 3 + 8) % 8;
-          int j2 = (g_rateHistoryIdx[1] - 4 + 8) % 8;
-          int j1 = (g_rateHistoryIdx[1] - 5 + 8) % 8;
-          int j0 = (g_rateHistoryIdx[1] - 6 + 8) % 8;
-          recentAvg = (g_rateHistory[1][i0] + g_rateHistory[1][i1] + g_rateHistory[1][i2]) / 3.0f;
-          previousAvg = (g_rateHistory[1][j0] + g_rateHistory[1][j1] + g_rateHistory[1][j2]) / 3.0f;
-
-          float avgChange = recentAvg - previousAvg;
-          FSM_DBG_PRINT("SUB2: WET avg recent="); FSM_DBG_PRINT(recentAvg);
-          FSM_DBG_PRINT(" prevAvg="); FSM_DBG_PRINT(previousAvg);
-          FSM_DBG_PRINT(" change="); FSM_DBG_PRINT(avgChange);
-          FSM_DBG_PRINT(" diff="); FSM_DBG_PRINT(currentAHDiff, 2);
-          FSM_DBG_PRINTLN("g/m^3");
-
-          if (avgChange < AH_RATE_DECLINE_THRESHOLD) {
-            g_consecutiveNegativeCount[1]++;
-          } else {
-            g_consecutiveNegativeCount[1] = 0;
-          }
-
-          // Robust peak detection with 4-tier adaptive thresholds
-          uint32_t minPeakTimeMs;
-          float peakRateThreshold;
-          
-          if (g_initialWetDiff[1] < AH_DIFF_BARELY_WET) {
-            // Barely wet: quick peak detection to save power
-            minPeakTimeMs = 60u * 1000u;  // 60s
-            peakRateThreshold = 0.2f;     // Low threshold
-          } else if (g_initialWetDiff[1] < AH_DIFF_MODERATE_WET) {
-            // Moderate: normal thresholds
-            minPeakTimeMs = AH_PEAK_NORMAL_MIN_TIME_MS;           // 120s
-            peakRateThreshold = AH_RATE_NORMAL_PEAK_THRESHOLD;    // 0.35
-          } else if (g_initialWetDiff[1] < AH_DIFF_VERY_WET) {
-            // Very wet: stricter thresholds
-            minPeakTimeMs = 180u * 1000u;    // 180s
-            peakRateThreshold = 0.50f;       // 0.50
-          } else {
-            // Soaked: most stringent thresholds
-            minPeakTimeMs = AH_PEAK_WET_MIN_TIME_MS;        // 240s
-            peakRateThreshold = AH_RATE_WET_PEAK_THRESHOLD; // 0.60
-          }
-
-          bool decliningEnough = (g_consecutiveNegativeCount[1] >= MIN_CONSECUTIVE_NEGATIVE) && (avgChange < -0.05f);
-          bool rateIsLow = (recentAvg < peakRateThreshold);
-          bool hasSpentEnoughTime = (wetElapsed >= minPeakTimeMs);
-          
-          if (decliningEnough && rateIsLow && hasSpentEnoughTime) {
-            FSM_DBG_PRINT("SUB2: WET peak (rate=");
-            FSM_DBG_PRINT(recentAvg, 2);
-            FSM_DBG_PRINT("<");
-            FSM_DBG_PRINT(peakRateThreshold, 2);
-            FSM_DBG_PRINT(", time=");
-            FSM_DBG_PRINT(wetElapsed/1000);
-            FSM_DBG_PRINT("s>=");
-            FSM_DBG_PRINT(minPeakTimeMs/1000);
-            FSM_DBG_PRINT("s) -> ");
-            FSM_DBG_PRINT(g_peakBufferMs[1]/1000);
-            FSM_DBG_PRINTLN("s buffer");
-            g_peakDetected[1] = true;
-            g_peakDetectedMs[1] = now;
-            g_consecutiveNegativeCount[1] = 0;
-            g_lastValidAHDiff[1] = currentAHDiff;
-            // Heater continues during peak detection for extra heating time
-            FSM_DBG_PRINTLN("SUB2: WET peak detected, entering post-peak buffer (heater continues)");
-          }
-        }
-      }
-        g_prevAHRate[1] = currentRate;
-        g_ahRateSampleCount[1]++;
-      }
-      
-      // ==================== WET PHASE SAFETY TIMEOUT ====================
-      // Prevent indefinite WET phase if peak detection never triggers or succeeds
-      if (g_heaterWarmupDone[1] && g_subWetStartMs[1] != 0) {
-        uint32_t now = millis();
-        uint32_t wetElapsed = (uint32_t)(now - g_wetPhaseStartMs[1]);
-        
-        // Determine maximum WET duration based on initial wetness level
-        uint32_t wetMaxMs = WET_BARELY_WET_MAX_MS;
-        if (g_initialWetDiff[1] < AH_DIFF_BARELY_WET) {
-          wetMaxMs = WET_BARELY_WET_MAX_MS;         // 5 min
-        } else if (g_initialWetDiff[1] < AH_DIFF_MODERATE_WET) {
-          wetMaxMs = WET_MODERATE_MAX_MS;           // 9 min
-        } else if (g_initialWetDiff[1] < AH_DIFF_VERY_WET) {
-          wetMaxMs = WET_VERY_WET_MAX_MS;           // 12 min
-        } else {
-          wetMaxMs = WET_SOAKED_MAX_MS;             // 15 min
-        }
-        
-        if (wetElapsed >= wetMaxMs && !g_peakDetected[1]) {
-          // Timeout reached and no peak detected - force transition to COOLING
-          FSM_DBG_PRINT("SUB2: WET timeout (no peak detected after ");
-          FSM_DBG_PRINT(wetElapsed/1000);
-          FSM_DBG_PRINT("s, limit=");
-          FSM_DBG_PRINT(wetMaxMs/1000);
-          FSM_DBG_PRINTLN("s) -> COOLING");
-          heaterRun(1, false);
-          motorStop(1);
-          g_ahRateSampleCount[1] = 0;
-          g_consecutiveNegativeCount[1] = 0;
-          startCoolingPhase(1, false);
-          return;
-        }
-      }
-  });
-
-  // S_COOLING run: two-phase logic
-  // Phase 1 (0-5s): motor at 80%, heater off
-  // Phase 2 (5-10s): motor off, stabilization period
-  // After 10s: perform dry-check and advance
-  // OPTIMIZATION: If already dry, immediately advance to DRY state
-  fsmSub1.setRun(SubState::S_COOLING, []() {
-    if (g_subCoolingStartMs[0] == 0)
-      return;
-
-    // Prevent repeated hard-timeout logging; once triggered, skip motor phase and go straight to stabilization
-    static bool s_hardTimeout[2] = {false, false};
-    bool skipMotorPhase = s_hardTimeout[0] && (g_subCoolingStabilizeStartMs[0] != 0);
-
-    // PERSISTENT HEATER OFF GUARD: Ensure heater stays OFF during main COOLING phase
-    // (only RE-EVAP subsection is allowed to control heater)
-    if (!g_inReEvap[0]) {
-      static uint32_t lastHeaterOffCmd[2] = {0, 0};
-      uint32_t now = millis();
-      // Re-send heater OFF every 500ms during COOLING to ensure it stays OFF
-      if ((uint32_t)(now - lastHeaterOffCmd[0]) >= 500) {
-        heaterRun(0, false);
-        lastHeaterOffCmd[0] = now;
-      }
-    }
-
-    // ================= RE-EVAP SHORT CYCLE =================
-    if (g_inReEvap[0]) {
-      // Acquire motor lock first - don't waste heater power if motor can't run
-      if (!g_motorStarted[0]) {
-        // Try to acquire motor lock at start of re-evap motor phase
-        if (g_wetLockOwner == -1) {
-          g_wetLockOwner = 0;
-          g_reEvapStartMs[0] = millis();  // START TIMER ONLY AFTER ACQUIRING LOCK
-          FSM_DBG_PRINTLN("SUB1: RE-EVAP acquired motor lock, timer started");
-          g_reEvapMinDiffMs[0] = g_reEvapStartMs[0];
-          motorStart(0);
-          g_motorStarted[0] = true;
-        } else {
-          // Motor lock held by other shoe, don't waste heater power - pause re-evap
-          heaterRun(0, false);
-          return;  // Wait for lock to become available
-        }
-      }
-      // Motor lock acquired and motor running - now control heater
-      float t = g_dhtTemp[1];
-      if (!isnan(t) && t >= HEATER_WET_TEMP_THRESHOLD_C) {
-        heaterRun(0, false);
-      } else {
-        heaterRun(0, true);
-      }
-      motorSetDutyPercent(0, RE_EVAP_MOTOR_DUTY);
-      uint32_t now = millis();
-      uint32_t elapsed = (uint32_t)(now - g_reEvapStartMs[0]);
-      float d = g_dhtAHDiff[0];
-      if (!isnan(d) && d < g_reEvapMinDiff[0]) { g_reEvapMinDiff[0] = d; g_reEvapMinDiffMs[0] = now; }
-      // Adaptive lenient gates
-      float init = g_initialWetDiff[0];
-      uint32_t minTime; float riseThresh;
-      if (init < AH_DIFF_BARELY_WET) { minTime = RE_EVAP_MIN_TIME_BARE_MOD; riseThresh = RE_EVAP_RISE_BARE_MOD; }
-      else if (init < AH_DIFF_MODERATE_WET) { minTime = RE_EVAP_MIN_TIME_BARE_MOD; riseThresh = RE_EVAP_RISE_BARE_MOD; }
-      else if (init < AH_DIFF_VERY_WET) { minTime = RE_EVAP_MIN_TIME_VERY; riseThresh = RE_EVAP_RISE_VERY; }
-      else { minTime = RE_EVAP_MIN_TIME_SOAKED; riseThresh = RE_EVAP_RISE_SOAKED; }
-      bool timeout = (elapsed >= RE_EVAP_MAX_MS);
-      bool risePassed = (elapsed >= minTime) && (d - g_reEvapMinDiff[0] > riseThresh);
-      if (timeout || risePassed) {
-        FSM_DBG_PRINT("SUB1: RE-EVAP done (" ); FSM_DBG_PRINT(timeout ? "timeout" : "rise"); FSM_DBG_PRINTLN(") -> back to COOLING");
-        heaterRun(0, false);
-        g_inReEvap[0] = false;
-        g_reEvapStartMs[0] = 0; g_reEvapMinDiff[0] = 999.0f; g_reEvapMinDiffMs[0] = 0;
-        // Release motor lock when re-evap completes
-        if (g_wetLockOwner == 0) {
-          g_wetLockOwner = -1;
-          FSM_DBG_PRINTLN("SUB1: RE-EVAP released motor lock on completion");
-        }
-        
-        // Limit re-evap retries to prevent infinite loops
-        if (timeout) {
-          g_reEvapRetryCount[0]++;
-          if (g_reEvapRetryCount[0] >= MAX_RE_EVAP_RETRIES) {
-            FSM_DBG_PRINT("SUB1: MAX RE-EVAP RETRIES (");
-            FSM_DBG_PRINT(g_reEvapRetryCount[0]);
-            FSM_DBG_PRINTLN(") reached, forcing DRY");
-            motorStop(0);
-            g_subCoolingStartMs[0] = 0;
-            g_subCoolingStabilizeStartMs[0] = 0;
-            g_coolingLocked[0] = false;
-            fsmSub1.handleEvent(Event::SubStart);  // Force to DRY
-            return;
-          }
-        }
-        // Restart COOLING motor phase fresh (retry semantics)
-        startCoolingPhase(0, true);
-        return;
-      }
-      return; // stay in re-evap until exit conditions
-    }
-    
-    // Check if shoe is already dry - guard with flag to prevent infinite loop
-    if (!g_coolingEarlyExit[0]) {
-      static float s_lastCoolingTemp[2] = {NAN, NAN};
-      static float s_lastCoolingDiff[2] = {NAN, NAN};
-
-      float tempCurr = g_dhtTemp[1];
-      bool tempGlitch = false;
-      if (!isnan(tempCurr) && !isnan(s_lastCoolingTemp[0])) {
-        if (tempCurr < s_lastCoolingTemp[0] - 4.0f) {
-          tempGlitch = true;
-        }
-      }
-
-      float earlyDiff = g_dhtAHDiff[0];
-      bool diffGlitch = false;
-      if (!isnan(earlyDiff) && !isnan(s_lastCoolingDiff[0])) {
-        if (earlyDiff < s_lastCoolingDiff[0] - MAX_AH_DELTA_PER_SAMPLE) {
-          diffGlitch = true;
-        }
-      }
-
-      if (!tempGlitch && !diffGlitch && earlyDiff <= AH_DRY_THRESHOLD) {
-        FSM_DBG_PRINT("SUB1: COOLING early dry-check -> already dry (diff=");
-        FSM_DBG_PRINT(earlyDiff);
-        FSM_DBG_PRINTLN("), advancing immediately");
-        g_subCoolingStartMs[0] = 0;
-        g_subCoolingStabilizeStartMs[0] = 0;
-        g_coolingLocked[0] = false;
-        g_coolingEarlyExit[0] = true;
-        motorStop(0);
-        fsmSub1.handleEvent(Event::SubStart);
-        return;
-      }
-
-      if (!isnan(tempCurr)) s_lastCoolingTemp[0] = tempCurr;
-      if (!isnan(earlyDiff)) s_lastCoolingDiff[0] = earlyDiff;
-    }
-    
-    uint32_t nowMs0 = millis();
-    uint32_t motorElapsed = (uint32_t)(nowMs0 - g_subCoolingStartMs[0]);
-    float tempC0 = g_dhtTemp[1];
-    float ambC0 = g_dhtTemp[0];
-    float targetC0 = (!isnan(ambC0) ? (ambC0 + COOLING_AMBIENT_DELTA_C) : COOLING_TEMP_RELEASE_C);
-    
-    if (!skipMotorPhase) {
-      // Phase 1: motor running with duty based on temperature delta (shoe vs ambient)
-      // Goal: Use motor to cool when shoe is HOT; OFF when ambient is warmer (passive cooling/heating sufficient)
-      // Heater is already OFF; motor circulation is the ONLY cooling mechanism
-      if (!isnan(tempC0) && !isnan(ambC0)) {
-        float delta = tempC0 - ambC0;  // Positive = shoe hotter, negative = ambient hotter
-        int duty = 0;  // Default: motor OFF
-        
-        if (delta > 5.0f) {
-          // Shoe much hotter than ambient: aggressive motor cooling needed
-          duty = 90;  // Increased to speed cooling
-        } else if (delta > 2.0f) {
-          // Shoe moderately hotter: medium-high motor speed
-          duty = 75;  // Increased from 60
-        } else if (delta > 0.5f) {
-          // Shoe slightly hotter: ensure meaningful airflow
-          duty = 55;  // Increased from 40
-        }
-        // If delta <= 0.5: ambient is at least as warm as shoe, motor OFF (duty = 0)
-        
-        motorSetDutyPercent(0, duty);
-      } else if (!isnan(tempC0) && tempC0 >= COOLING_TEMP_FAN_BOOST_ON) {
-        // Fallback: high shoe temp detected, use moderate cooling (60%)
-        motorSetDutyPercent(0, 60);
-      } else {
-        // Safety: if can't determine temperature reliably, use low motor (40%)
-        motorSetDutyPercent(0, 40);
-      }
-      if (motorElapsed < g_coolingMotorDurationMs[0]) {
-        return; // Still in motor-run phase
-      }
-      
-      // If motor phase time elapsed but shoe is still hot, extend motor phase (bounded to prevent watchdog timeout)
-      if (!isnan(tempC0) && tempC0 > targetC0) {
-        // Hard timeout check: prevent indefinite motor running that could cause watchdog reset
-        if (motorElapsed >= COOLING_MOTOR_ABSOLUTE_MAX_MS) {
-          FSM_DBG_PRINT("SUB1: COOLING -> hard motor timeout (");
-          FSM_DBG_PRINT(motorElapsed);
-          FSM_DBG_PRINTLN("ms) reached, forcing stabilization");
-          // Force transition to stabilization immediately but keep motor at low duty for airflow
-          motorSetDutyPercent(0, 60);
-          if (g_wetLockOwner == 0) {
-            g_wetLockOwner = -1;
-            FSM_DBG_PRINTLN("SUB1: COOLING released motor lock on hard timeout");
-          }
-          g_subCoolingStabilizeStartMs[0] = millis();
-          s_hardTimeout[0] = true;
-          return;
-        }
-        if (motorElapsed < g_coolingMotorDurationMs[0] + COOLING_TEMP_EXTEND_MAX_MS) {
-          static uint32_t lastHoldLog0 = 0;
-          if ((uint32_t)(nowMs0 - lastHoldLog0) >= 10000u || lastHoldLog0 == 0) {
-            lastHoldLog0 = nowMs0;
-            FSM_DBG_PRINT("SUB1: COOLING hold - temp=");
-            FSM_DBG_PRINT(tempC0, 1);
-            FSM_DBG_PRINT("C, target=");
-            FSM_DBG_PRINT(targetC0, 1);
-            FSM_DBG_PRINTLN("C, extending motor run");
-          }
-          // Adjust motor duty based on current temp delta during extension
-          float delta = tempC0 - ambC0;
-          if (delta > 5.0f) {
-            motorSetDutyPercent(0, 80);  // Still hot, use high duty
-          } else if (delta > 2.0f) {
-            motorSetDutyPercent(0, 60);  // Moderately hot
-          } else {
-            motorSetDutyPercent(0, 40);  // Just barely above target
-          }
-          return;
-        }
-        // Max extension reached: force stabilization to prevent infinite watchdog timeout
-        FSM_DBG_PRINT("SUB1: COOLING -> max motor extension (");
-        FSM_DBG_PRINT(motorElapsed);
-        FSM_DBG_PRINTLN("ms) reached, forcing stabilization to prevent watchdog");
-      }
-    }
-    
-    // Transition from motor phase to stabilization phase
-    if (g_subCoolingStabilizeStartMs[0] == 0) {
-      FSM_DBG_PRINTLN("SUB1: COOLING -> motor phase done, starting stabilization");
-      motorStop(0);
-      // Release motor lock when transitioning to stabilization phase
-      if (g_wetLockOwner == 0) {
-        g_wetLockOwner = -1;
-        FSM_DBG_PRINTLN("SUB1: COOLING released motor lock on stabilization start");
-      }
-      g_subCoolingStabilizeStartMs[0] = millis();
-      return;
-    }
-    
-    // Phase 2: stabilization (check if stabilization period elapsed)
-    uint32_t stabilizeElapsed = (uint32_t)(millis() - g_subCoolingStabilizeStartMs[0]);
-    if (stabilizeElapsed < DRY_STABILIZE_MS) {
-      // Sample AH diff every 15 seconds during stabilization using absolute time
-      static uint32_t lastSampleMs0 = 0;
-      uint32_t now = millis();
-      if (lastSampleMs0 == 0) {
-        lastSampleMs0 = now;  // Initialize on first sample
-      }
-      // Use absolute time, not relative elapsed time
-      if ((uint32_t)(now - lastSampleMs0) >= 15000) {
-        lastSampleMs0 = now;  // Update to current absolute time
-        g_coolingDiffSamples[0][g_coolingDiffSampleIdx[0]] = g_dhtAHDiff[0];
-        g_coolingDiffSampleIdx[0] = (g_coolingDiffSampleIdx[0] + 1) % 6;
-        if (g_coolingDiffSampleCount[0] < 6) g_coolingDiffSampleCount[0]++;
-      }
-      return; // Still in stabilization phase
-    }
-    
-    // Stabilization complete, perform dry-check with adaptive threshold
-    float diff = g_dhtAHDiff[0];
-    bool isDeclining = isAHDiffDeclining(0);
-    float threshold = isDeclining ? AH_DRY_THRESHOLD_LENIENT : AH_DRY_THRESHOLD;
-    // Use median of last 3 stabilization samples if available to reduce noise
-    float evalDiff0 = diff;
-    if (g_coolingDiffSampleCount[0] >= 3) {
-      float a = g_coolingDiffSamples[0][(g_coolingDiffSampleIdx[0] - 1 + 6) % 6];
-      float b = g_coolingDiffSamples[0][(g_coolingDiffSampleIdx[0] - 2 + 6) % 6];
-      float c = g_coolingDiffSamples[0][(g_coolingDiffSampleIdx[0] - 3 + 6) % 6];
-      // median of a,b,c
-      float minab = (a < b) ? a : b;
-      float maxab = (a > b) ? a : b;
-      float med = (c < minab) ? minab : (c > maxab ? maxab : c);
-      evalDiff0 = med;
-    }
-    bool stillWet = (evalDiff0 > threshold);
-    // Temperature guard: don't declare dry if still warm (> 36.5C)
-    float tC0_final = g_dhtTemp[1];
-    float tC0_amb = g_dhtTemp[0];
-    float tC0_target = (!isnan(tC0_amb) ? (tC0_amb + COOLING_AMBIENT_DELTA_C) : (COOLING_TEMP_RELEASE_C - 0.5f));
-    if (!isnan(tC0_final) && tC0_final > tC0_target) {
-      stillWet = true;
-    }
-    FSM_DBG_PRINT("SUB1: COOLING stabilization done -> dry-check, diff=");
-    FSM_DBG_PRINT(evalDiff0);
-    FSM_DBG_PRINT(isDeclining ? " (declining, lenient threshold=" : " (threshold=");
-    FSM_DBG_PRINT(threshold);
-    FSM_DBG_PRINTLN(")");
-    g_subCoolingStartMs[0] = 0;
-    g_subCoolingStabilizeStartMs[0] = 0;
-    g_coolingLocked[0] = false;
-    s_hardTimeout[0] = false;
-    if (stillWet) {
-      // Immediately perform short re-evap cycle (no cooling retries)
-      FSM_DBG_PRINTLN("SUB1: COOLING -> invoking RE-EVAP short cycle");
-      g_inReEvap[0] = true;
-      g_reEvapStartMs[0] = 0;  // Will be set when motor lock is acquired
-      g_reEvapMinDiff[0] = g_dhtAHDiff[0];
-      g_reEvapMinDiffMs[0] = 0;
-      return;
-    } else {
-      FSM_DBG_PRINTLN("SUB1: COOLING dry-check -> dry, advancing to DRY");
-      fsmSub1.handleEvent(Event::SubStart);
-    }
-  });
+       nullptr, nullptr}
+  };
 
-  fsmSub2.setRun(SubState::S_COOLING, []() {
-    if (g_subCoolingStartMs[1] == 0)
-      return;
+  // State hierarchy: super-states catch events their children do not handle
+  static constexpr StateParent<GlobalState> global_parents[] = {
+      {GlobalState::Idle, GlobalState::Root},          {GlobalState::Session, GlobalState::Root},
+      {GlobalState::Detecting, GlobalState::Session},  {GlobalState::Checking, GlobalState::Session},
+      {GlobalState::Running, GlobalState::Session},    {GlobalState::Done, GlobalState::Root},
+      {GlobalState::LowBattery, GlobalState::Root},    {GlobalState::Error, GlobalState::Root},
+      {GlobalState::Debug, GlobalState::Root}};
+  static constexpr StateParent<SubState> sub_parents[] = {
+      {SubState::S_IDLE, SubState::S_ROOT},         {SubState::S_WAITING, SubState::S_ROOT},
+      {SubState::S_WET, SubState::S_ROOT},          {SubState::S_FINISHING, SubState::S_ROOT},
+      {SubState::S_COOLING, SubState::S_FINISHING}, {SubState::S_DRY, SubState::S_FINISHING},
+      {SubState::S_DONE, SubState::S_ROOT}};
+
+  static constexpr auto global_table =
+      makeStateTable<NUM_GLOBAL_STATES, NUM_EVENT_BITS>(global_trans, global_cbs, global_parents);
+  static constexpr auto sub_table =
+      makeStateTable<NUM_SUB_STATES, NUM_EVENT_BITS>(sub_trans, sub_cbs, sub_parents);
+  // Timer-driven transitions: armed on entry, cancelled if the state is left first
+  static constexpr StateTimeout<GlobalState, Event> global_timeouts[] = {
+      {GlobalState::Detecting, SENSOR_EQUALIZE_MS, Event::SensorTimeout},
+      // Done -> Idle; Idle entry resets the subs
+      {GlobalState::Done, DONE_TIMEOUT_MS, Event::ResetPressed}};
+
+  fsmGlobal.setTable(global_table);
+  fsmGlobal.setTimeouts(global_timeouts);
+  fsmSubs.setTable(sub_table);
+}
 
-    // Prevent repeated hard-timeout logging; once triggered, skip motor phase and go straight to stabilization
-    static bool s_hardTimeout[2] = {false, false};
-    bool skipMotorPhase = s_hardTimeout[1] && (g_subCoolingStabilizeStartMs[1] != 0);
+// The trace dump is up to FSM_TRACE_DEPTH serial lines, about a second at
+// 115200 baud: it prints from a short-lived task on core 0 so the heater and
+// fan scripts keep their tick. A request while one is printing is dropped.
+static volatile bool g_traceDumping = false;
 
-    // PERSISTENT HEATER OFF GUARD: Ensure heater stays OFF during main COOLING phase
-    // (only RE-EVAP subsection is allowed to control heater)
-    if (!g_inReEvap[1]) {
-      static uint32_t lastHeaterOffCmd[2] = {0, 0};
-      uint32_t now = millis();
-      // Re-send heater OFF every 500ms during COOLING to ensure it stays OFF
-      if ((uint32_t)(now - lastHeaterOffCmd[1]) >= 500) {
-        heaterRun(1, false);
-        lastHeaterOffCmd[1] = now;
-      }
-    }
+static void vTraceDumpTask(void * /*pv*/) {
+  fsmTraceDump();
+  g_traceDumping = false;
+  vTaskDelete(nullptr);
+}
 
-    // ================= RE-EVAP SHORT CYCLE =================
-    if (g_inReEvap[1]) {
-      // Acquire motor lock first - don't waste heater power if motor can't run
-      if (!g_motorStarted[1]) {
-        // Try to acquire motor lock at start of re-evap motor phase
-        if (g_wetLockOwner == -1) {
-          g_wetLockOwner = 1;
-          g_reEvapStartMs[1] = millis();  // START TIMER ONLY AFTER ACQUIRING LOCK
-          FSM_DBG_PRINTLN("SUB2: RE-EVAP acquired motor lock, timer started");
-          g_reEvapMinDiffMs[1] = g_reEvapStartMs[1];
-          motorStart(1);
-          g_motorStarted[1] = true;
-        } else {
-          // Motor lock held by other shoe, don't waste heater power - pause re-evap
-          heaterRun(1, false);
-          return;  // Wait for lock to become available
-        }
-      }
-      // Motor lock acquired and motor running - now control heater
-      float t = g_dhtTemp[2];
-      if (!isnan(t) && t >= HEATER_WET_TEMP_THRESHOLD_C) {
-        heaterRun(1, false);
-      } else {
-        heaterRun(1, true);
-      }
-      motorSetDutyPercent(1, RE_EVAP_MOTOR_DUTY);
-      uint32_t now = millis();
-      uint32_t elapsed = (uint32_t)(now - g_reEvapStartMs[1]);
-      float d = g_dhtAHDiff[1];
-      if (!isnan(d) && d < g_reEvapMinDiff[1]) { g_reEvapMinDiff[1] = d; g_reEvapMinDiffMs[1] = now; }
-      float init = g_initialWetDiff[1];
-      uint32_t minTime; float riseThresh;
-      if (init < AH_DIFF_BARELY_WET) { minTime = RE_EVAP_MIN_TIME_BARE_MOD; riseThresh = RE_EVAP_RISE_BARE_MOD; }
-      else if (init < AH_DIFF_MODERATE_WET) { minTime = RE_EVAP_MIN_TIME_BARE_MOD; riseThresh = RE_EVAP_RISE_BARE_MOD; }
-      else if (init < AH_DIFF_VERY_WET) { minTime = RE_EVAP_MIN_TIME_VERY; riseThresh = RE_EVAP_RISE_VERY; }
-      else { minTime = RE_EVAP_MIN_TIME_SOAKED; riseThresh = RE_EVAP_RISE_SOAKED; }
-      bool timeout = (elapsed >= RE_EVAP_MAX_MS);
-      bool risePassed = (elapsed >= minTime) && (d - g_reEvapMinDiff[1] > riseThresh);
-      if (timeout || risePassed) {
-        FSM_DBG_PRINT("SUB2: RE-EVAP done (" ); FSM_DBG_PRINT(timeout ? "timeout" : "rise"); FSM_DBG_PRINTLN(") -> back to COOLING");
-        heaterRun(1, false);
-        g_inReEvap[1] = false;
-        g_reEvapStartMs[1] = 0; g_reEvapMinDiff[1] = 999.0f; g_reEvapMinDiffMs[1] = 0;
-        // Release motor lock when re-evap completes
-        if (g_wetLockOwner == 1) {
-          g_wetLockOwner = -1;
-          FSM_DBG_PRINTLN("SUB2: RE-EVAP released motor lock on completion");
-        }
-        
-        // Limit re-evap retries to prevent infinite loops
-        if (timeout) {
-          g_reEvapRetryCount[1]++;
-          if (g_reEvapRetryCount[1] >= MAX_RE_EVAP_RETRIES) {
-            FSM_DBG_PRINT("SUB2: MAX RE-EVAP RETRIES (");
-            FSM_DBG_PRINT(g_reEvapRetryCount[1]);
-            FSM_DBG_PRINTLN(") reached, forcing DRY");
-            motorStop(1);
-            g_subCoolingStartMs[1] = 0;
-            g_subCoolingStabilizeStartMs[1] = 0;
-            g_coolingLocked[1] = false;
-            fsmSub2.handleEvent(Event::SubStart);  // Force to DRY
-            return;
-          }
-        }
-        startCoolingPhase(1, true);
-        return;
-      }
-      return;
-    }
-    
-    // Check if shoe is already dry - guard with flag to prevent infinite loop
-    if (!g_coolingEarlyExit[1]) {
-      // Glitch guard: ignore implausible sudden temp drops or AH jumps when motor is active
-      static float s_lastCoolingTemp[2] = {NAN, NAN};
-      static float s_lastCoolingDiff[2] = {NAN, NAN};
-
-      float tempCurr = g_dhtTemp[2];
-      bool tempGlitch = false;
-      if (!isnan(tempCurr) && !isnan(s_lastCoolingTemp[1])) {
-        if (tempCurr < s_lastCoolingTemp[1] - 4.0f) {
-          tempGlitch = true; // drop >4C in one sample is likely EMI glitch
-        }
-      }
+static void requestTraceDump() {
+  if (g_traceDumping)
+    return;
+  g_traceDumping = true;
+  // fsmTraceDump() copies into a static buffer, so a small stack is enough
+  if (xTaskCreatePinnedToCore(vTraceDumpTask, "TraceDump", 3072, nullptr, 1, nullptr, 0) != pdPASS)
+    g_traceDumping = false;
+}
 
-      float earlyDiff = g_dhtAHDiff[1];
-      bool diffGlitch = false;
-      if (!isnan(earlyDiff) && !isnan(s_lastCoolingDiff[1])) {
-        if (earlyDiff < s_lastCoolingDiff[1] - MAX_AH_DELTA_PER_SAMPLE) {
-          diffGlitch = true; // sudden downward jump beyond per-sample clamp
-        }
-      }
+// Deliver one event. Addressed events go straight to their sub. Others go
+// to the global FSM first, then every sub; which sub (if any) reacts is
+// decided by the sub table's guards. ResetPressed always reaches the subs;
+// other events only if the global FSM did not consume them.
+static void dispatchEvent(Event ev, uint8_t target, uint32_t arg) {
+  // A button press before the crash resume starts discards it
+  if (ev == Event::StartPressed || ev == Event::ResetPressed)
+    cancelResume();
+  // Diagnostics, not a transition: Reset held down dumps the transition trace
+  if (ev == Event::Debug) {
+    requestTraceDump();
+    return;
+  }
+  g_eventArg = arg;
+  if (target != FSM_TARGET_ALL)
+    fsmSubs.handleEvent(target - 1, ev);
+  else if (!fsmGlobal.handleEvent(ev) || ev == Event::ResetPressed)
+    fsmSubs.broadcast(ev);
+  g_eventArg = 0;
+}
 
-      if (!tempGlitch && !diffGlitch && earlyDiff <= AH_DRY_THRESHOLD) {
-        FSM_DBG_PRINT("SUB2: COOLING early dry-check -> already dry (diff=");
-        FSM_DBG_PRINT(earlyDiff);
-        FSM_DBG_PRINTLN("), advancing immediately");
-        g_subCoolingStartMs[1] = 0;
-        g_subCoolingStabilizeStartMs[1] = 0;
-        g_coolingLocked[1] = false;
-        g_coolingEarlyExit[1] = true;
-        motorStop(1);
-        fsmSub2.handleEvent(Event::SubStart);
-        return;
-      }
+// Events that one machine's callbacks post to another are handled here, once
+// the step that raised them has completed.
+static void processDeferredEvents() {
+  fsmGlobal.processDeferred();
+  fsmSubs.processDeferred();
+}
 
-      if (!isnan(tempCurr)) s_lastCoolingTemp[1] = tempCurr;
-      if (!isnan(earlyDiff)) s_lastCoolingDiff[1] = earlyDiff;
-    }
-    
-    uint32_t nowMs1 = millis();
-    uint32_t motorElapsed = (uint32_t)(nowMs1 - g_subCoolingStartMs[1]);
-    float tempC1 = g_dhtTemp[2];
-    float ambC1 = g_dhtTemp[0];
-    float targetC1 = (!isnan(ambC1) ? (ambC1 + COOLING_AMBIENT_DELTA_C) : COOLING_TEMP_RELEASE_C);
-    
-    if (!skipMotorPhase) {
-      // Phase 1: motor running with duty based on temperature delta (shoe vs ambient)
-      // Goal: Use motor to cool when shoe is HOT; OFF when ambient is warmer (passive cooling/heating sufficient)
-      // Heater is already OFF; motor circulation is the ONLY cooling mechanism
-      if (!isnan(tempC1) && !isnan(ambC1)) {
-        float delta = tempC1 - ambC1;  // Positive = shoe hotter, negative = ambient hotter
-        int duty = 0;  // Default: motor OFF
-        
-        if (delta > 5.0f) {
-          // Shoe much hotter than ambient: aggressive motor cooling needed
-          duty = 90;  // Increased to speed cooling
-        } else if (delta > 2.0f) {
-          // Shoe moderately hotter: medium-high motor speed
-          duty = 75;  // Increased from 60
-        } else if (delta > 0.5f) {
-          // Shoe slightly hotter: ensure meaningful airflow
-          duty = 55;  // Increased from 40
-        }
-        // If delta <= 0.5: ambient is at least as warm as shoe, motor OFF (duty = 0)
-        
-        motorSetDutyPercent(1, duty);
-      } else if (!isnan(tempC1) && tempC1 >= COOLING_TEMP_FAN_BOOST_ON) {
-        // Fallback: high shoe temp detected, use moderate cooling (60%)
-        motorSetDutyPercent(1, 60);
-      } else {
-        // Safety: if can't determine temperature reliably, use low motor (40%)
-        motorSetDutyPercent(1, 40);
-      }
-      if (motorElapsed < g_coolingMotorDurationMs[1]) {
-        return; // Still in motor-run phase
-      }
-      
-      // If motor phase time elapsed but shoe is still hot, extend motor phase (bounded to prevent watchdog timeout)
-      if (!isnan(tempC1) && tempC1 > targetC1) {
-        // Hard timeout check: prevent indefinite motor running that could cause watchdog reset
-        if (motorElapsed >= COOLING_MOTOR_ABSOLUTE_MAX_MS) {
-          FSM_DBG_PRINT("SUB2: COOLING -> hard motor timeout (");
-          FSM_DBG_PRINT(motorElapsed);
-          FSM_DBG_PRINTLN("ms) reached, forcing stabilization");
-          // Force transition to stabilization immediately but keep motor at low duty for airflow
-          motorSetDutyPercent(1, 60);
-          if (g_wetLockOwner == 1) {
-            g_wetLockOwner = -1;
-            FSM_DBG_PRINTLN("SUB2: COOLING released motor lock on hard timeout");
-          }
-          g_subCoolingStabilizeStartMs[1] = millis();
-          s_hardTimeout[1] = true;
-          return;
-        }
-        if (motorElapsed < g_coolingMotorDurationMs[1] + COOLING_TEMP_EXTEND_MAX_MS) {
-          static uint32_t lastHoldLog1 = 0;
-          if ((uint32_t)(nowMs1 - lastHoldLog1) >= 10000u || lastHoldLog1 == 0) {
-            lastHoldLog1 = nowMs1;
-            FSM_DBG_PRINT("SUB2: COOLING hold - temp=");
-            FSM_DBG_PRINT(tempC1, 1);
-            FSM_DBG_PRINT("C, target=");
-            FSM_DBG_PRINT(targetC1, 1);
-            FSM_DBG_PRINTLN("C, extending motor run");
-          }
-          // Adjust motor duty based on current temp delta during extension
-          float delta = tempC1 - ambC1;
-          if (delta > 5.0f) {
-            motorSetDutyPercent(1, 80);  // Still hot, use high duty
-          } else if (delta > 2.0f) {
-            motorSetDutyPercent(1, 60);  // Moderately hot
-          } else {
-            motorSetDutyPercent(1, 40);  // Just barely above target
-          }
-          return;
-        }
-        // Max extension reached: force stabilization to prevent infinite watchdog timeout
-        FSM_DBG_PRINT("SUB2: COOLING -> max motor extension (");
-        FSM_DBG_PRINT(motorElapsed);
-        FSM_DBG_PRINTLN("ms) reached, forcing stabilization to prevent watchdog");
-      }
-    }
-    
-    // Transition from motor phase to stabilization phase
-    if (g_subCoolingStabilizeStartMs[1] == 0) {
-      FSM_DBG_PRINTLN("SUB2: COOLING -> motor phase done, starting stabilization");
-      motorStop(1);
-      // Release motor lock when transitioning to stabilization phase
-      if (g_wetLockOwner == 1) {
-        g_wetLockOwner = -1;
-        FSM_DBG_PRINTLN("SUB2: COOLING released motor lock on stabilization start");
-      }
-      g_subCoolingStabilizeStartMs[1] = millis();
-      return;
-    }
-    
-    // Phase 2: stabilization (check if stabilization period elapsed)
-    uint32_t stabilizeElapsed = (uint32_t)(millis() - g_subCoolingStabilizeStartMs[1]);
-    if (stabilizeElapsed < DRY_STABILIZE_MS) {
-      // Sample AH diff every 15 seconds during stabilization using absolute time
-      static uint32_t lastSampleMs1 = 0;
-      uint32_t now = millis();
-      if (lastSampleMs1 == 0) {
-        lastSampleMs1 = now;  // Initialize on first sample
-      }
-      // Use absolute time, not relative elapsed time
-      if ((uint32_t)(now - lastSampleMs1) >= 15000) {
-        lastSampleMs1 = now;  // Update to current absolute time
-        g_coolingDiffSamples[1][g_coolingDiffSampleIdx[1]] = g_dhtAHDiff[1];
-        g_coolingDiffSampleIdx[1] = (g_coolingDiffSampleIdx[1] + 1) % 6;
-        if (g_coolingDiffSampleCount[1] < 6) g_coolingDiffSampleCount[1]++;
-      }
-      return; // Still in stabilization phase
-    }
-    
-    // Stabilization complete, perform dry-check with adaptive threshold
-    float diff = g_dhtAHDiff[1];
-    bool isDeclining = isAHDiffDeclining(1);
-    float threshold = isDeclining ? AH_DRY_THRESHOLD_LENIENT : AH_DRY_THRESHOLD;
-    // Use median of last 3 stabilization samples if available to reduce noise
-    float evalDiff1 = diff;
-    if (g_coolingDiffSampleCount[1] >= 3) {
-      float a = g_coolingDiffSamples[1][(g_coolingDiffSampleIdx[1] - 1 + 6) % 6];
-      float b = g_coolingDiffSamples[1][(g_coolingDiffSampleIdx[1] - 2 + 6) % 6];
-      float c = g_coolingDiffSamples[1][(g_coolingDiffSampleIdx[1] - 3 + 6) % 6];
-      float minab = (a < b) ? a : b;
-      float maxab = (a > b) ? a : b;
-      float med = (c < minab) ? minab : (c > maxab ? maxab : c);
-      evalDiff1 = med;
-    }
-    bool stillWet = (evalDiff1 > threshold);
-    // Temperature guard: don't declare dry if still warm (> 36.5C)
-    float tC1_final = g_dhtTemp[2];
-    float tC1_amb = g_dhtTemp[0];
-    float tC1_target = (!isnan(tC1_amb) ? (tC1_amb + COOLING_AMBIENT_DELTA_C) : (COOLING_TEMP_RELEASE_C - 0.5f));
-    if (!isnan(tC1_final) && tC1_final > tC1_target) {
-      stillWet = true;
-    }
-    FSM_DBG_PRINT("SUB2: COOLING stabilization done -> dry-check, diff=");
-    FSM_DBG_PRINT(evalDiff1);
-    FSM_DBG_PRINT(isDeclining ? " (declining, lenient threshold=" : " (threshold=");
-    FSM_DBG_PRINT(threshold);
-    FSM_DBG_PRINTLN(")");
-    g_subCoolingStartMs[1] = 0;
-    g_subCoolingStabilizeStartMs[1] = 0;
-    g_coolingLocked[1] = false;
-    s_hardTimeout[1] = false;
-    if (stillWet) {
-      // Immediately perform short re-evap cycle (no cooling retries)
-      FSM_DBG_PRINTLN("SUB2: COOLING -> invoking RE-EVAP short cycle");
-      g_inReEvap[1] = true;
-      g_reEvapStartMs[1] = 0;  // Will be set when motor lock is acquired
-      g_reEvapMinDiff[1] = g_dhtAHDiff[1];
-      g_reEvapMinDiffMs[1] = 0;
-      return;
-    } else {
-      FSM_DBG_PRINTLN("SUB2: COOLING dry-check -> dry, advancing to DRY");
-      fsmSub2.handleEvent(Event::SubStart);
-    }
-  });
-
-  // Detecting entry/exit
-  fsmGlobal.setEntry(GlobalState::Detecting, []() {
-    detectingStartMs = millis();
-    FSM_DBG_PRINTLN("GLOBAL ENTRY: Detecting - equalize timer started");
-  });
-  fsmGlobal.setExit(GlobalState::Detecting, []() {
-    detectingStartMs = 0;
-    FSM_DBG_PRINTLN("GLOBAL EXIT: Detecting - equalize timer cleared");
-  });
-  // Done entry: stop UVs but keep subs in their final states (COOLING/DRY/etc)
-  // Subs will reset when user presses Start again (goes back to Idle first)
-  fsmGlobal.setEntry(GlobalState::Done, []() {
-    FSM_DBG_PRINTLN("GLOBAL ENTRY: Done - stopping UVs");
-    uvStop(0);
-    uvStop(1);
-    g_subDoneMask = 0;
-    g_doneStartMs = millis();
-  });
-
-  // Ensure Done exit clears the done-start timestamp used for auto-reset
-  fsmGlobal.setExit(GlobalState::Done, []() { g_doneStartMs = 0; });
-
-  // Checking state: run callback to check battery before allowing transition to Running
-  fsmGlobal.setRun(GlobalState::Checking, []() {
-    // Battery check performed here; if user presses Start and battery is low, post BatteryLow event
-    // The transition to Running will only occur if battery is OK
-  });
-
-  // Checking state entry: perform battery check immediately
-  fsmGlobal.setEntry(GlobalState::Checking, []() {
-    FSM_DBG_PRINTLN("GLOBAL ENTRY: Checking - verifying battery voltage");
-    // Turn on status LED when checking
-    digitalWrite(HW_STATUS_LED_PIN, HIGH);
-    digitalWrite(HW_ERROR_LED_PIN, LOW);
-    // Update cached battery voltage
-    g_lastBatteryVoltage = readBatteryVoltage();
-    if (!isBatteryOk()) {
-      FSM_DBG_PRINT("GLOBAL: Battery voltage low: ");
-      if (Serial) Serial.printf("%.2f V\n", g_lastBatteryVoltage);
-      fsmPostEvent(Event::BatteryLow, false);
-    }
-  });
-
-  // LowBattery state: continuously check battery and turn off status LED, turn on error LED
-  fsmGlobal.setEntry(GlobalState::LowBattery, []() {
-    FSM_DBG_PRINTLN("GLOBAL ENTRY: LowBattery - waiting for battery recovery");
-    digitalWrite(HW_STATUS_LED_PIN, LOW);   // Status LED off
-    digitalWrite(HW_ERROR_LED_PIN, HIGH);   // Error LED solid on
-    g_lastBatteryCheckMs = millis();
-  });
-
-  fsmGlobal.setRun(GlobalState::LowBattery, []() {
-    uint32_t now = millis();
-    if ((uint32_t)(now - g_lastBatteryCheckMs) >= BATTERY_CHECK_INTERVAL_MS) {
-      g_lastBatteryCheckMs = now;
-      if (isBatteryRecovered()) {
-        float vBat = readBatteryVoltage();
-        FSM_DBG_PRINT("GLOBAL: Battery recovered: ");
-        if (Serial) Serial.printf("%.2f V\n", vBat);
-        fsmPostEvent(Event::BatteryRecovered, false);
-      }
-    }
-  });
-
-  fsmGlobal.setExit(GlobalState::LowBattery, []() {
-    FSM_DBG_PRINTLN("GLOBAL EXIT: LowBattery");
-    digitalWrite(HW_ERROR_LED_PIN, LOW);  // Turn off error LED
-  });
-
-  // Idle state: status LED on, error LED off
-  fsmGlobal.setEntry(GlobalState::Idle, []() {
-    detectingStartMs = 0;  // Clear detecting timer to prevent stale timeout
-    
-    // Full reset when entering Idle
-    FSM_DBG_PRINTLN("GLOBAL ENTRY: Idle - full reset");
-    
-    // Stop all motors, heaters, UVs
-    motorStop(0);
-    motorStop(1);
-    heaterRun(0, false);
-    heaterRun(1, false);
-    uvStop(0);
-    uvStop(1);
-    
-    // Reset WET lock
-    g_wetLockOwner = -1;
-    g_uvComplete[0] = g_uvComplete[1] = false;
-    g_motorStarted[0] = g_motorStarted[1] = false;
-
-    // Clear per-sub cooling/wet timers and flags to avoid stale blocking across runs
-    g_subWetStartMs[0] = g_subWetStartMs[1] = 0;
-    g_subCoolingStartMs[0] = g_subCoolingStartMs[1] = 0;
-    g_subCoolingStabilizeStartMs[0] = g_subCoolingStabilizeStartMs[1] = 0;
-    g_coolingLocked[0] = g_coolingLocked[1] = false;
-    g_coolingEarlyExit[0] = g_coolingEarlyExit[1] = false;
-    g_inReEvap[0] = g_inReEvap[1] = false;
-    g_reEvapStartMs[0] = g_reEvapStartMs[1] = 0;
-    g_reEvapMinDiff[0] = g_reEvapMinDiff[1] = 999.0f;
-    g_reEvapMinDiffMs[0] = g_reEvapMinDiffMs[1] = 0;
-    // Clear heater warmup and trend tracking
-    g_heaterWarmupStartMs[0] = g_heaterWarmupStartMs[1] = 0;
-    g_heaterWarmupDone[0] = g_heaterWarmupDone[1] = false;
-    g_heaterLastTemp[0] = g_heaterLastTemp[1] = NAN;
-    g_heaterLastCheckMs[0] = g_heaterLastCheckMs[1] = 0;
-    g_heaterTrendSamples[0] = g_heaterTrendSamples[1] = 0;
-    g_heaterTempRising[0] = g_heaterTempRising[1] = false;
-    // Reset waiting event guards
-    g_waitingEventPosted[0] = g_waitingEventPosted[1] = false;
-
-    // Play entry-only SOLE/CARE splash on Idle entry (after reset)
-    triggerSplashEntryOnly();
-    
-    // Reset substates to IDLE via ResetPressed event
-    fsmSub1.handleEvent(Event::ResetPressed);
-    fsmSub2.handleEvent(Event::ResetPressed);
-    
-    // LEDs: Status on (idle), Error off
-    digitalWrite(HW_STATUS_LED_PIN, HIGH);
-    digitalWrite(HW_ERROR_LED_PIN, LOW);
-  });
-
-  // Running state: status LED off, error LED blinking + initialize subs
-  fsmGlobal.setEntry(GlobalState::Running, []() {
-    // Initialize substates
-    bool s1Wet = g_dhtIsWet[0];
-    bool s2Wet = g_dhtIsWet[1];
-    FSM_DBG_PRINTLN("GLOBAL ENTRY: Running - initializing subs");
-    g_uvComplete[0] = g_uvComplete[1] = false;
-    g_motorStarted[0] = g_motorStarted[1] = false;
-    g_wetLockOwner = -1; // Clear lock for new run
-    // Ensure no stale cooling/wet state blocks WET acquisition
-    g_subWetStartMs[0] = g_subWetStartMs[1] = 0;
-    g_subCoolingStartMs[0] = g_subCoolingStartMs[1] = 0;
-    g_subCoolingStabilizeStartMs[0] = g_subCoolingStabilizeStartMs[1] = 0;
-    g_coolingLocked[0] = g_coolingLocked[1] = false;
-    g_coolingEarlyExit[0] = g_coolingEarlyExit[1] = false;
-    g_inReEvap[0] = g_inReEvap[1] = false;
-    g_waitingEventPosted[0] = g_waitingEventPosted[1] = false;
-    // Directly handle init events to ensure substates transition immediately
-    fsmSub1.handleEvent(s1Wet ? Event::Shoe0InitWet : Event::Shoe0InitDry);
-    fsmSub2.handleEvent(s2Wet ? Event::Shoe1InitWet : Event::Shoe1InitDry);
-    
-    // LED initialization for running state
-    digitalWrite(HW_STATUS_LED_PIN, LOW);   // Status LED off when running
-    digitalWrite(HW_ERROR_LED_PIN, LOW);    // Start with error LED off
-    g_ledBlinkMs = millis();
-    g_ledBlinkState = false;
-  });
-
-  // Error state: status LED off, error LED solid on
-  fsmGlobal.setEntry(GlobalState::Error, []() {
-    digitalWrite(HW_STATUS_LED_PIN, LOW);
-    digitalWrite(HW_ERROR_LED_PIN, HIGH);  // Solid on for error
-  });
+// Loop sleep: until the next state timer, periodic run handler or LED blink,
+// whichever is first; with none pending, until a post (buttons included)
+// notifies the task.
+static TickType_t fsmSleepTicks() {
+  uint32_t sleepMs = UINT32_MAX;
+  uint32_t dueMs;
+  if (fsmGlobal.nextDeadline(dueMs) && dueMs < sleepMs)
+    sleepMs = dueMs;
+  GlobalState gs = fsmGlobal.getState();
+  // Only Running steps the subs: elsewhere (LowBattery, Error, Done) their run
+  // deadlines are never moved on and would read as due forever. A paused
+  // cycle ignores them too and polls the battery rung.
+  if (gs == GlobalState::Running && g_pauseStartMs) {
+    if (BATTERY_CHECK_INTERVAL_MS < sleepMs)
+      sleepMs = BATTERY_CHECK_INTERVAL_MS;
+  } else if (gs == GlobalState::Running && fsmSubs.nextDeadline(dueMs) && dueMs < sleepMs) {
+    sleepMs = dueMs;
+  }
+  if (gs == GlobalState::Running || gs == GlobalState::Done) {
+    uint32_t since = millis() - g_ledBlinkMs;
+    dueMs = since >= LED_BLINK_MS ? 0 : LED_BLINK_MS - since;
+    if (dueMs < sleepMs)
+      sleepMs = dueMs;
+  }
+  // A pending checkpoint write is due once the batching gap has passed
+  if (CHECKPOINT_RESUME && g_checkpointDirty && gs == GlobalState::Running && !g_pauseStartMs) {
+    uint32_t since = millis() - g_checkpointMs;
+    dueMs = since >= CHECKPOINT_MIN_GAP_MS ? 0 : CHECKPOINT_MIN_GAP_MS - since;
+    if (dueMs < sleepMs)
+      sleepMs = dueMs;
+  }
+  // The pending resume polls for the first sensor pass
+  if (g_resumeWaitSensors && SCRIPT_TICK_MS < sleepMs)
+    sleepMs = SCRIPT_TICK_MS;
+  return sleepMs == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(sleepMs);
 }
 
 // FreeRTOS task that drives all FSMs
 static void vStateMachineTask(void * /*pvParameters*/) {
-  pinMode(START_PIN, INPUT_PULLUP);
-  pinMode(RESET_PIN, INPUT_PULLUP);
-  
-  // Initialize battery ADC
-  analogReadResolution(12);
-  analogSetPinAttenuation(HW_BATTERY_ADC_PIN, ADC_11db);
-  pinMode(HW_BATTERY_ADC_PIN, INPUT);
+  buttonsInit();
   
   // Initialize status LEDs
   pinMode(HW_STATUS_LED_PIN, OUTPUT);
@@ -2324,111 +1959,62 @@ static void vStateMachineTask(void * /*pvParameters*/) {
   digitalWrite(HW_STATUS_LED_PIN, HIGH);  // Status LED on at startup
   digitalWrite(HW_ERROR_LED_PIN, LOW);    // Error LED off at startup
   
-  if (!g_fsmEventQ)
-    g_fsmEventQ = xQueueCreate(FSM_QUEUE_LEN, sizeof(EventMsg));
+  // Transition history survives warm resets (.noinit): dump what led up to it
+  if (g_fsmTrace.begin()) {
+    FSM_DBG_PRINTLN("FSM: transition trace from before reset:");
+    fsmTraceDump();
+    g_fsmTrace.clear();
+  }
   uvInit();
   setupStateMachines();
+  profPrintHeader();
+  // A cycle cut short by a crash or brownout resumes once the sensors have
+  // been read; any other reset starts clean
+  if (CHECKPOINT_RESUME && resetWasCrash() && checkpointLoad(g_resumeCp) && checkpointResumable(g_resumeCp)) {
+    FSM_DBG_PRINT("FSM: checkpoint #"); FSM_DBG_PRINT(g_resumeCp.seq);
+    FSM_DBG_PRINTLN(" found after a crash reset, resuming after the first sensor pass");
+    g_resumeWaitSensors = true;
+  } else {
+    checkpointClear();
+  }
   FSM_DBG_PRINTLN("FSM Task started");
-
-  auto forwardToSubs = [](Event e) {
-    fsmSub1.handleEvent(e);
-    fsmSub2.handleEvent(e);
-  };
+#ifdef FSM_STATS
+  g_wakeStatsSinceMs = millis();
+#endif
 
   while (true) {
-    if (readStart()) {
-      GlobalState gs = fsmGlobal.getState();
-      // Only allow start from Idle or Checking states
-      if (gs == GlobalState::Idle || gs == GlobalState::Checking) {
-        if (gs == GlobalState::Running)
-          fsmPostEvent(Event::SubStart, false);
-        else
-          fsmPostEvent(Event::StartPressed, false);
-      }
+#ifdef FSM_STATS
+    uint32_t tickStartUs = micros();
+#endif
+    // State timers (Detecting equalize, Done auto-reset, ...)
+    fsmGlobal.pollTimers();
+    fsmSubs.pollTimers();
+    processDeferredEvents();
+
+    // Drain every pending event this pass, highest priority first. Bounded so
+    // an event re-posted from its own handler cannot starve the loop.
+    Event ev;
+    uint8_t target;
+    uint32_t arg;
+    for (size_t n = 0; n < NUM_EVENT_BITS * FSM_NUM_TARGETS &&
+                       g_fsmMailbox.pop(ev, target, arg, FSM_EVENT_PRIORITY);
+         ++n) {
+      dispatchEvent(ev, target, arg);
+      processDeferredEvents();
+#ifdef FSM_STATS
+      g_eventLatencyUs.record(micros() - g_postUs[target][eventIndex(ev)]);
+#endif
     }
-    if (readReset())
-      fsmPostEvent(Event::ResetPressed, true);
 
-    if (detectingStartMs != 0) {
-      uint32_t now = millis();
-      if ((uint32_t)(now - detectingStartMs) >= SENSOR_EQUALIZE_MS) {
-        FSM_DBG_PRINTLN("GLOBAL: Detecting timeout -> SensorTimeout");
-        fsmPostEvent(Event::SensorTimeout, false);
-        detectingStartMs = 0;
-      }
-    }
-
-    if (g_fsmEventQ) {
-      EventMsg m;
-      if (xQueueReceive(g_fsmEventQ, &m, 0) == pdTRUE) {
-        FSM_DBG_PRINT("FSM: dequeued event -> ");
-        FSM_DBG_PRINT_INT("", (int)m.ev);
-        bool globalConsumed = fsmGlobal.handleEvent(m.ev);
-        if (m.broadcastAll)
-          forwardToSubs(m.ev);
-        else if (!globalConsumed) {
-          switch (m.ev) {
-          case Event::Shoe0InitWet:
-          case Event::Shoe0InitDry:
-            fsmSub1.handleEvent(m.ev);
-            break;
-          case Event::Shoe1InitWet:
-          case Event::Shoe1InitDry:
-            fsmSub2.handleEvent(m.ev);
-            break;
-          case Event::SubStart: {
-            // Gate SubStart: only deliver to shoes in WET or WAITING (acquiring lock)
-            // This prevents DRY shoe from advancing to DONE when another shoe posts SubStart
-            SubState s1 = fsmSub1.getState();
-            SubState s2 = fsmSub2.getState();
-            if ((s1 == SubState::S_WET || s1 == SubState::S_WAITING) &&
-                !(s1 == SubState::S_COOLING && g_coolingLocked[0])) {
-              fsmSub1.handleEvent(m.ev);
-            }
-            if ((s2 == SubState::S_WET || s2 == SubState::S_WAITING) &&
-                !(s2 == SubState::S_COOLING && g_coolingLocked[1])) {
-              fsmSub2.handleEvent(m.ev);
-            }
-            break;
-          }
-          case Event::UVTimer0:
-            // Single UV timer expired: advance BOTH subs if they are in DRY
-            FSM_DBG_PRINTLN("UV timer expired on GPIO14");
-            if (fsmSub1.getState() == SubState::S_DRY) {
-              FSM_DBG_PRINTLN("SUB1: in DRY, advancing to DONE");
-              fsmSub1.handleEvent(Event::SubStart);
-            }
-            if (fsmSub2.getState() == SubState::S_DRY) {
-              FSM_DBG_PRINTLN("SUB2: in DRY, advancing to DONE");
-              fsmSub2.handleEvent(Event::SubStart);
-            }
-            // Mark UV complete so we don't restart it
-            g_uvComplete[0] = true;
-            // Reset UV start guard for next cycle
-            g_uvStartGuard = false;
-            break;
-          case Event::UVTimer1:
-            // UVTimer1 not used with single UV, ignore
-            FSM_DBG_PRINTLN("UVTimer1 ignored (single UV mode)");
-            break;
-          case Event::SubFSMDone:
-            if (fsmSub1.getState() == SubState::S_DONE && fsmSub2.getState() == SubState::S_DONE)
-              fsmGlobal.handleEvent(m.ev);
-            break;
-          default:
-            break;
-          }
-        }
-      }
-    }
-    // Auto-reset: if we entered Done, after DONE_TIMEOUT_MS reset everything back to Idle
-    if (g_doneStartMs != 0) {
-      uint32_t now = millis();
-      if ((uint32_t)(now - g_doneStartMs) >= DONE_TIMEOUT_MS) {
-        FSM_DBG_PRINTLN("GLOBAL: Done timeout -> Reset to Idle (global+subs)");
-        // Post ResetPressed to all FSMs so subs leave DONE and return to S_IDLE
-        fsmPostEvent(Event::ResetPressed, /*broadcastAll=*/true);
-        g_doneStartMs = 0;
+    // Resume once every sensor has a reading (the dry-checks need them), unless
+    // the battery is too low to run: resuming would only brown out again.
+    // After the drain, so a button press already posted cancels it first.
+    if (g_resumeWaitSensors && g_dhtSampleSeq > 0) {
+      if (isBatteryOk()) {
+        g_resumeWaitSensors = false;
+        fsmPostEvent(Event::Resume);
+      } else {
+        cancelResume();
       }
     }
 
@@ -2436,22 +2022,22 @@ static void vStateMachineTask(void * /*pvParameters*/) {
     auto gsNow = fsmGlobal.getState();
     if (gsNow == GlobalState::Running) {
       uint32_t now = millis();
-      if ((uint32_t)(now - g_ledBlinkMs) >= 500u) {  // Blink every 500ms
+      if ((uint32_t)(now - g_ledBlinkMs) >= LED_BLINK_MS) {
         g_ledBlinkMs = now;
         g_ledBlinkState = !g_ledBlinkState;
         digitalWrite(HW_ERROR_LED_PIN, g_ledBlinkState ? HIGH : LOW);
       }
     } else if (gsNow == GlobalState::Done) {
       uint32_t now = millis();
-      if ((uint32_t)(now - g_ledBlinkMs) >= 500u) {  // Blink every 500ms
+      if ((uint32_t)(now - g_ledBlinkMs) >= LED_BLINK_MS) {
         g_ledBlinkMs = now;
         g_ledBlinkState = !g_ledBlinkState;
         digitalWrite(HW_STATUS_LED_PIN, g_ledBlinkState ? HIGH : LOW);
       }
       // Ensure error LED stays off in Done
       digitalWrite(HW_ERROR_LED_PIN, LOW);
-    } else if (gsNow == GlobalState::LowBattery) {
-      // Keep error LED solid on while in LowBattery
+    } else if (gsNow == GlobalState::LowBattery || gsNow == GlobalState::Error) {
+      // Keep error LED solid on while in LowBattery or Error
       digitalWrite(HW_ERROR_LED_PIN, HIGH);
     } else {
       // Not Running or Done: keep error LED off unless state-specific entry sets it
@@ -2459,37 +2045,131 @@ static void vStateMachineTask(void * /*pvParameters*/) {
     }
 
     fsmGlobal.run();
-    vTaskDelay(pdMS_TO_TICKS(FSM_LOOP_DELAY_MS));
+#ifdef FSM_STATS
+    uint32_t tickUs = micros() - tickStartUs;
+    g_tickUs.record(tickUs);
+    if (tickUs > FSM_TICK_BUDGET_US)
+      ++g_tickOverruns;
+#endif
+    // Posts made while this pass ran have already notified: no lost wakeup
+    TickType_t sleepTicks = fsmSleepTicks();
+    // A deadline that stays due spins the core; say so once per streak
+    if (sleepTicks == 0 && ++g_zeroSleeps == FSM_SPIN_WARN_PASSES) {
+      FSM_DBG_PRINT("FSM: loop not blocking in ");
+      FSM_DBG_PRINTLN(globalStateName(fsmGlobal.getState()));
+    } else if (sleepTicks != 0) {
+      g_zeroSleeps = 0;
+    }
+    uint32_t notified = ulTaskNotifyTake(pdTRUE, sleepTicks);
+#ifdef FSM_STATS
+    ++g_wakeups;
+    if (notified)
+      ++g_wakeupsNotified;
+#else
+    (void)notified;
+#endif
   }
 }
 
 void createStateMachineTask() {
   motorInit();
-  xTaskCreatePinnedToCore(vStateMachineTask, "StateMachineTask", 4096, nullptr, 1, nullptr, 1);
+  checkpointInit();
+  xTaskCreatePinnedToCore(vStateMachineTask, "StateMachineTask", 4096, nullptr, 1, &s_fsmTask, 1);
 }
 
 GlobalState getGlobalState() {
   return fsmGlobal.getState();
 }
-SubState getSub1State() {
-  return fsmSub1.getState();
-}
-SubState getSub2State() {
-  return fsmSub2.getState();
+SubState getSubState(uint8_t shoeIdx) {
+  return shoeIdx < NUM_BAYS ? fsmSubs.getState(shoeIdx) : SubState::S_IDLE;
 }
 
 // Getter functions for timing tracking used in UI progress calculations
 uint32_t getSubWetStartMs(int shoeIdx) {
-  if (shoeIdx < 0 || shoeIdx >= 2) return 0;
-  return g_subWetStartMs[shoeIdx];
+  if (shoeIdx < 0 || shoeIdx >= NUM_BAYS) return 0;
+  return g_shoes[shoeIdx].wetStartMs;
 }
 
 uint32_t getSubCoolingStartMs(int shoeIdx) {
-  if (shoeIdx < 0 || shoeIdx >= 2) return 0;
-  return g_subCoolingStartMs[shoeIdx];
+  if (shoeIdx < 0 || shoeIdx >= NUM_BAYS) return 0;
+  return g_shoes[shoeIdx].coolingStartMs;
 }
 
 uint32_t getCoolingMotorDurationMs(int shoeIdx) {
-  if (shoeIdx < 0 || shoeIdx >= 2) return 0;
-  return g_coolingMotorDurationMs[shoeIdx];
-}
\ No newline at end of file
+  if (shoeIdx < 0 || shoeIdx >= NUM_BAYS) return 0;
+  return g_shoes[shoeIdx].coolingMotorDurationMs;
+}
+
+uint32_t getSubQueueWaitMs(int shoeIdx) {
+  if (shoeIdx < 0 || shoeIdx >= NUM_BAYS) return 0;
+  const ShoeContext &s = g_shoes[shoeIdx];
+  return s.queueWaitMs + (s.waitStartMs ? millis() - s.waitStartMs : 0);
+}
+#ifdef FSM_STATS
+// One line per state that was ever entered: entries, dwell and worst-case
+// callback cycles (entry/exit/run). statsOf(s) returns the StateStats of state s.
+template <typename StatsOf>
+static void printMachineStats(const char *label, size_t numStates, StatsOf statsOf, const CallbackStats &action,
+                              uint32_t guardRejects, uint8_t deferMax, uint32_t deferDropped) {
+  for (size_t i = 0; i < numStates; ++i) {
+    const StateStats &st = statsOf(i);
+    if (st.entries == 0 && st.run.calls == 0)
+      continue;
+    Serial.printf("[STATS] %s s%u n=%lu dwell=%lu/%lu ms max cyc e=%lu x=%lu r=%lu (r n=%lu)\n", label,
+                  (unsigned)i, (unsigned long)st.entries, (unsigned long)st.dwellTotalMs,
+                  (unsigned long)st.dwellMaxMs, (unsigned long)st.entry.maxCycles,
+                  (unsigned long)st.exit.maxCycles, (unsigned long)st.run.maxCycles,
+                  (unsigned long)st.run.calls);
+  }
+  Serial.printf("[STATS] %s actions n=%lu max cyc=%lu guard rejects=%lu\n", label,
+                (unsigned long)action.calls, (unsigned long)action.maxCycles,
+                (unsigned long)guardRejects);
+  Serial.printf("[STATS] %s deferred max depth=%u dropped=%lu\n", label, (unsigned)deferMax,
+                (unsigned long)deferDropped);
+}
+
+void fsmPrintStats() {
+  if (!Serial)
+    return;
+  printMachineStats(
+      "GLOBAL", NUM_GLOBAL_STATES,
+      [](size_t s) -> const StateStats & { return fsmGlobal.stateStats(static_cast<GlobalState>(s)); },
+      fsmGlobal.actionStats(), fsmGlobal.guardRejects(), fsmGlobal.deferredHighWater(), fsmGlobal.deferredOverflow());
+  for (size_t i = 0; i < NUM_BAYS; ++i) {
+    printMachineStats(
+        subLabel(i), NUM_SUB_STATES,
+        [i](size_t s) -> const StateStats & { return fsmSubs.stateStats(i, static_cast<SubState>(s)); },
+        fsmSubs.actionStats(i), fsmSubs.guardRejects(i), fsmSubs.deferredHighWater(i), fsmSubs.deferredOverflow(i));
+  }
+  uint32_t spanMs = millis() - g_wakeStatsSinceMs;
+  Serial.printf("[STATS] LOOP wakeups=%lu (notified=%lu) in %lu ms = %.2f/s\n", (unsigned long)g_wakeups,
+                (unsigned long)g_wakeupsNotified, (unsigned long)spanMs,
+                spanMs ? g_wakeups * 1000.0f / spanMs : 0.0f);
+  Serial.printf("[STATS] LOOP tick n=%lu avg=%lu max=%lu us, over %lu us: %lu\n",
+                (unsigned long)g_tickUs.calls,
+                (unsigned long)(g_tickUs.calls ? g_tickUs.totalCycles / g_tickUs.calls : 0),
+                (unsigned long)g_tickUs.maxCycles, (unsigned long)FSM_TICK_BUDGET_US,
+                (unsigned long)g_tickOverruns);
+  const CallbackStats &lat = g_eventLatencyUs;
+  Serial.printf("[STATS] LOOP event latency n=%lu avg=%lu max=%lu us\n", (unsigned long)lat.calls,
+                (unsigned long)(lat.calls ? lat.totalCycles / lat.calls : 0), (unsigned long)lat.maxCycles);
+  // Same log2 buckets as the callback histograms, counted in us; the last is open-ended
+  for (size_t b = 0; b < FSM_STATS_HIST_BUCKETS; ++b) {
+    if (lat.hist[b])
+      Serial.printf("[STATS] LOOP latency %s %lu us: %u\n", b + 1 < FSM_STATS_HIST_BUCKETS ? "<" : ">=",
+                    1ul << (b + FSM_STATS_HIST_SHIFT + (b + 1 < FSM_STATS_HIST_BUCKETS)),
+                    (unsigned)lat.hist[b]);
+  }
+}
+
+void fsmResetStats() {
+  fsmGlobal.resetStats();
+  fsmSubs.resetStats();
+  g_wakeups = 0;
+  g_wakeupsNotified = 0;
+  g_wakeStatsSinceMs = millis();
+  g_eventLatencyUs = {};
+  g_tickUs = {};
+  g_tickOverruns = 0;
+}
+#endif
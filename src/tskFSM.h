@@ -4,15 +4,31 @@
 #include <cstdint>
 
 void createStateMachineTask(void);
-// Post an Event into the FSM queue from other tasks
+// Post an Event into the FSM mailbox from other tasks or ISRs (wait-free) and
+// wake the FSM task to handle it.
+// Returns false if the same event was already pending and coalesced.
 bool fsmExternalPost(Event ev);
+// Post an Event addressed to one shoe's sub-FSM (0 .. NUM_BAYS-1) with an optional
+// payload. It skips the global FSM and coalesces only with the same event
+// already pending for the same shoe.
+bool fsmExternalPostTo(uint8_t shoeIdx, Event ev, uint32_t arg = 0);
+// Number of posts of `ev` that coalesced into an already-pending event
+uint32_t fsmEventOverflowCount(Event ev);
 
 // Query current FSM states (for UI)
 GlobalState getGlobalState();
-SubState getSub1State();
-SubState getSub2State();
+// Sub-FSM state of bay shoeIdx (S_IDLE if out of range)
+SubState getSubState(uint8_t shoeIdx);
 
 // Timing accessors for progress calculation (internal to FSM, read-only for UI)
 uint32_t getSubWetStartMs(int shoeIdx);
 uint32_t getSubCoolingStartMs(int shoeIdx);
 uint32_t getCoolingMotorDurationMs(int shoeIdx);
+// Time the shoe has spent queued in S_WAITING this run (including now)
+uint32_t getSubQueueWaitMs(int shoeIdx);
+
+#ifdef FSM_STATS
+// Dump / clear StateMachine instrumentation (build with -DFSM_STATS)
+void fsmPrintStats();
+void fsmResetStats();
+#endif
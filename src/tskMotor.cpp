@@ -20,10 +20,11 @@ struct MotorMsg {
 };
 
 static QueueHandle_t g_motorQ = nullptr;
-static volatile bool g_motorActive[2] = {false, false};
-static volatile bool g_motorOn[2] = {false, false};
-static volatile bool g_heaterOn[2] = {false, false};
-static volatile uint32_t g_motorStartMs[2] = {0, 0};
+static volatile bool g_motorActive[NUM_BAYS] = {false};
+static volatile bool g_motorOn[NUM_BAYS] = {false};
+static volatile bool g_heaterOn[NUM_BAYS] = {false};  // commanded by the FSM
+static volatile bool g_heaterRelay[NUM_BAYS] = {false};  // applied (see applyHeater)
+static volatile uint32_t g_motorStartMs[NUM_BAYS] = {0};
 
 // For motor pins we use LEDC PWM (ESP32) to drive a MOSFET gate. 
 // Heaters now use relay control (simple on/off).
@@ -32,26 +33,23 @@ static const int MOTOR_PWM_RES = 9;    // bits
 static const int MOTOR_PWM_MAX = (1 << MOTOR_PWM_RES) - 1;
 static const int MOTOR_PWM_TARGET = MOTOR_PWM_MAX;
 static const int MOTOR_PWM_STEP = 16;
-static const uint8_t MOTOR_PWM_CH[2] = {0, 1};
 
-static volatile int g_motorDuty[2] = {0, 0};
-static volatile int g_motorTargetDuty[2] = {0, 0};
+static volatile int g_motorDuty[NUM_BAYS] = {0};
+static volatile int g_motorTargetDuty[NUM_BAYS] = {0};
 
 // ==================== PID MOTOR CONTROL ====================
 // Non-static to allow external linkage (used by tskFSM.cpp)
-PIDcontrol g_motorPID[2] = {
-  PIDcontrol(PID_KP, PID_KI, PID_KD, PID_SAMPLE_MS),
-  PIDcontrol(PID_KP, PID_KI, PID_KD, PID_SAMPLE_MS)
-};
+// Tunings are applied in motorInit()
+PIDcontrol g_motorPID[NUM_BAYS];
 
-bool g_pidInitialized[2] = {false, false};  // Track PID init per shoe
+bool g_pidInitialized[NUM_BAYS] = {false};  // Track PID init per shoe
 
-static float g_lastAH[2] = {0.0f, 0.0f};           // For AH rate calculation
-static unsigned long g_lastAHTime[2] = {0, 0};     // Timestamp of last AH sample
-static float g_lastValidRate[2] = {0.0f, 0.0f};    // Store last calculated rate for consistency
-static bool g_rateInitialized[2] = {false, false}; // Track if we have first valid rate
+static float g_lastAH[NUM_BAYS] = {0.0f};            // For AH rate calculation
+static unsigned long g_lastAHTime[NUM_BAYS] = {0};   // Timestamp of last AH sample
+static float g_lastValidRate[NUM_BAYS] = {0.0f};     // Store last calculated rate for consistency
+static bool g_rateInitialized[NUM_BAYS] = {false};   // Track if we have first valid rate
 // Saturation recovery tracking
-static unsigned long g_satStartMs[2] = {0, 0};
+static unsigned long g_satStartMs[NUM_BAYS] = {0};
 
 static inline void setActuator(int pin, bool on) {
   digitalWrite(pin, (HW_ACTUATOR_ACTIVE_LOW) ? (on ? LOW : HIGH) : (on ? HIGH : LOW));
@@ -59,21 +57,61 @@ static inline void setActuator(int pin, bool on) {
 
 // Heater now uses relay control
 static inline void setHeaterRelay(uint8_t idx, bool on) {
-  const int pin = (idx == 0) ? HW_HEATER_PIN_0 : HW_HEATER_PIN_1;
+  const int pin = HW_BAYS[idx].heaterPin;
   digitalWrite(pin, (HW_RELAY_ACTIVE_LOW) ? (on ? LOW : HIGH) : (on ? HIGH : LOW));
+  g_heaterRelay[idx] = on;
+}
+
+// Commanded heater state, unless the battery ladder holds the heaters off
+static void applyHeater(uint8_t idx) {
+  bool on = g_heaterOn[idx] && g_batteryRung < BatteryRung::HoldHeaters;
+  if (on != g_heaterRelay[idx])
+    setHeaterRelay(idx, on);
+}
+
+// Combined fan duty cap (percent of one fan) at the current battery rung
+static int fanCapPct() {
+  BatteryRung rung = g_batteryRung;
+  if (rung >= BatteryRung::Pause)
+    return 0;
+  if (rung >= BatteryRung::CapFans && BATTERY_FAN_CAP_PCT < FAN_COMBINED_DUTY_MAX_PCT)
+    return BATTERY_FAN_CAP_PCT;
+  return FAN_COMBINED_DUTY_MAX_PCT;
 }
 
 static inline void setMotorPWM(uint8_t idx, int duty) {
-  if (idx > 1)
+  if (idx >= NUM_BAYS)
     return;
-  ledcWrite(MOTOR_PWM_CH[idx], duty);
+  ledcWrite(HW_BAYS[idx].motorPwmCh, duty);
   g_motorDuty[idx] = duty;
 }
 
+// Fan duty arbitration: the PWM each fan may use so that all fans together
+// stay within FAN_COMBINED_DUTY_MAX_PCT (less on a low battery, see fanCapPct).
+// Heating bays (WET, RE-EVAP) are served first; COOLING fans share what is
+// left in proportion to their targets.
+static void arbitrateFanDuty(int out[NUM_BAYS]) {
+  int left = MOTOR_PWM_MAX * fanCapPct() / 100;
+  for (int pass = 0; pass < 2; ++pass) {
+    bool primary[NUM_BAYS];
+    int want = 0;
+    for (uint8_t i = 0; i < NUM_BAYS; ++i) {
+      primary[i] = g_heaterOn[i] || getSubState(i) != SubState::S_COOLING;
+      if (primary[i] == (pass == 0))
+        want += g_motorTargetDuty[i];
+    }
+    for (uint8_t i = 0; i < NUM_BAYS; ++i) {
+      if (primary[i] == (pass == 0))
+        out[i] = want <= left ? g_motorTargetDuty[i] : g_motorTargetDuty[i] * left / want;
+    }
+    left -= want < left ? want : left;
+  }
+}
+
 // Calculate AH rate-of-change in g/m³/min
 // Returns 0.0 during first second (warming up), then stable rates after
 static float calculateAHRate(uint8_t idx) {
-  float currentAH = g_dhtAH_ema[idx + 1];  // idx+1 because sensor 0 is ambient
+  float currentAH = g_dhtAH_ema[baySensor(idx)];
   if (isnan(currentAH)) {
     // If sensor EMA is invalid, hold last valid rate
     return g_lastValidRate[idx];
@@ -122,28 +160,32 @@ static float calculateAHRate(uint8_t idx) {
 }
 
 static void motorTask(void * /*pv*/) {
-  // configure pins
-  pinMode(HW_MOTOR_PIN_0, OUTPUT);
-  pinMode(HW_MOTOR_PIN_1, OUTPUT);
-  pinMode(HW_HEATER_PIN_0, OUTPUT);
-  pinMode(HW_HEATER_PIN_1, OUTPUT);
-  // ensure off
-  setActuator(HW_MOTOR_PIN_0, false);
-  setActuator(HW_MOTOR_PIN_1, false);
-  setHeaterRelay(0, false); // Heater now uses relay control
-  setHeaterRelay(1, false);
-
-  // Configure LEDC PWM for motors
-  ledcSetup(MOTOR_PWM_CH[0], MOTOR_PWM_FREQ, MOTOR_PWM_RES);
-  ledcAttachPin(HW_MOTOR_PIN_0, MOTOR_PWM_CH[0]);
-  ledcSetup(MOTOR_PWM_CH[1], MOTOR_PWM_FREQ, MOTOR_PWM_RES);
-  ledcAttachPin(HW_MOTOR_PIN_1, MOTOR_PWM_CH[1]);
+  for (uint8_t i = 0; i < NUM_BAYS; ++i) {
+    const BayDescriptor &bay = HW_BAYS[i];
+    // configure pins and ensure off (heater uses relay control)
+    pinMode(bay.motorPin, OUTPUT);
+    pinMode(bay.heaterPin, OUTPUT);
+    setActuator(bay.motorPin, false);
+    setHeaterRelay(i, false);
+    // Configure LEDC PWM for the motor
+    ledcSetup(bay.motorPwmCh, MOTOR_PWM_FREQ, MOTOR_PWM_RES);
+    ledcAttachPin(bay.motorPin, bay.motorPwmCh);
+  }
+
+  // Storage for PID outputs and rates (updated continuously)
+  float ahRates[NUM_BAYS] = {0.0f};
+  double pidOutputs[NUM_BAYS];
+  for (double &out : pidOutputs)
+    out = 0.5;  // Default to midpoint
 
   MotorMsg msg;
+  uint32_t pausedSinceMs = 0;  // battery Pause rung: 0 = not paused
   for (;;) {
-    // Check for commands with a short timeout so we also poll sensors
-    if (xQueueReceive(g_motorQ, &msg, pdMS_TO_TICKS(200)) == pdTRUE) {
-      uint8_t i = (msg.idx < 2) ? msg.idx : 0;
+    // Wait briefly for a command so we also poll sensors, then drain every
+    // queued command so none waits a full pass (or is dropped on a full queue)
+    for (TickType_t wait = pdMS_TO_TICKS(200); xQueueReceive(g_motorQ, &msg, wait) == pdTRUE;
+         wait = 0) {
+      uint8_t i = (msg.idx < NUM_BAYS) ? msg.idx : 0;
       switch (msg.cmd) {
       case MotorCmd::Start:
         g_motorActive[i] = true;
@@ -152,7 +194,7 @@ static void motorTask(void * /*pv*/) {
         g_heaterOn[i] = true;
         g_motorTargetDuty[i] = MOTOR_PWM_TARGET;
         setMotorPWM(i, g_motorDuty[i]);
-        setHeaterRelay(i, true);
+        applyHeater(i);
         DEV_DBG_PRINT("MOTOR: started for idx=");
         DEV_DBG_PRINTLN(i);
         break;
@@ -168,7 +210,7 @@ static void motorTask(void * /*pv*/) {
         break;
       case MotorCmd::Heater:
         g_heaterOn[i] = msg.on;
-        setHeaterRelay(i, msg.on);
+        applyHeater(i);
         DEV_DBG_PRINT("MOTOR: set heater on=");
         DEV_DBG_PRINT(msg.on);
         DEV_DBG_PRINT(" idx=");
@@ -183,7 +225,9 @@ static void motorTask(void * /*pv*/) {
         int tgt = (MOTOR_PWM_MAX * pct) / 100;
         g_motorTargetDuty[i] = tgt;
         // Apply duty immediately (CRITICAL: for COOLING phase motor control)
-        setMotorPWM(i, tgt);
+        int allowed[NUM_BAYS];
+        arbitrateFanDuty(allowed);
+        setMotorPWM(i, allowed[i]);
         // Only log significant duty changes (>5% change)
         if (g_motorDuty[i] == 0 || abs(tgt - g_motorDuty[i]) > (MOTOR_PWM_MAX * 5 / 100)) {
           DEV_DBG_PRINT("MOTOR: set duty %=");
@@ -194,23 +238,36 @@ static void motorTask(void * /*pv*/) {
       }
     }
 
+    // ==================== BATTERY LADDER ====================
+    // Heaters follow a hold or its release within a pass; fans follow through
+    // the duty arbitration. While paused, PID and the WET sensor checks stop
+    // and the WET safety clock is shifted by the pause on resume.
+    for (uint8_t i = 0; i < NUM_BAYS; ++i)
+      applyHeater(i);
+    bool paused = g_batteryRung == BatteryRung::Pause;
+    if (paused && !pausedSinceMs) {
+      pausedSinceMs = millis();
+    } else if (!paused && pausedSinceMs) {
+      uint32_t pausedMs = millis() - pausedSinceMs;
+      for (uint8_t i = 0; i < NUM_BAYS; ++i)
+        if (g_motorStartMs[i])
+          g_motorStartMs[i] += pausedMs;
+      pausedSinceMs = 0;
+    }
+
     // ==================== AH RATE CALCULATION (continuous for logging) ====================
-    // Storage for PID outputs and rates (updated continuously)
-    static float ahRates[2] = {0.0f, 0.0f};
-    static double pidOutputs[2] = {0.5, 0.5};  // Default to midpoint
-    
     // Always calculate AH rates for logging (even when motor inactive)
-    for (int i = 0; i < 2; ++i) {
+    for (int i = 0; i < NUM_BAYS; ++i) {
       ahRates[i] = calculateAHRate(i);
     }
     
     // ==================== PID MOTOR CONTROL ====================
-    for (int i = 0; i < 2; ++i) {
-      if (!g_motorActive[i])
+    for (int i = 0; i < NUM_BAYS; ++i) {
+      if (!g_motorActive[i] || paused)
         continue;
       
       // Check if shoe is in COOLING state - if so, skip PID (use fixed duty set by FSM)
-      SubState currentState = (i == 0) ? getSub1State() : getSub2State();
+      SubState currentState = getSubState(i);
       if (currentState == SubState::S_COOLING) {
         // During COOLING, FSM controls motor duty directly (80% then OFF)
         // Store current duty for logging, but don't run PID
@@ -284,8 +341,9 @@ static void motorTask(void * /*pv*/) {
       unsigned long now = millis();
       if (now - lastLogMs >= 1000) {  // 1-second interval (matches AH rate sampling)
         // Get current shoe states
-        SubState sub0State = getSub1State();
-        SubState sub1State = getSub2State();
+        // The CSV log has columns for the first two bays
+        SubState sub0State = getSubState(0);
+        SubState sub1State = getSubState(1);
         // Current setpoints
         double sp0 = g_motorPID[0].getSetpoint();
         double sp1 = g_motorPID[1].getSetpoint();
@@ -300,8 +358,8 @@ static void motorTask(void * /*pv*/) {
         
         // Log comprehensive data: AH values, temps, diffs, states, rates, PID outputs
         pidLogData(
-          g_dhtAH_ema[0], g_dhtAH_ema[1], g_dhtAH_ema[2],       // AH0, AH1, AH2
-          g_dhtTemp[1], g_dhtTemp[2],                           // Shoe temperatures (sensor1, sensor2)
+          g_dhtAH_ema[0], g_dhtAH_ema[baySensor(0)], g_dhtAH_ema[baySensor(1)],  // AH0, AH1, AH2
+          g_dhtTemp[baySensor(0)], g_dhtTemp[baySensor(1)],                      // Shoe temperatures
           g_dhtAHDiff_ema[0], sub0State, ahRates[0], pidOutputs[0] * 100.0, sp0,  // Shoe 0
           g_dhtAHDiff_ema[1], sub1State, ahRates[1], pidOutputs[1] * 100.0, sp1   // Shoe 1
         );
@@ -313,29 +371,20 @@ static void motorTask(void * /*pv*/) {
     // Ensure actuators are OFF in DRY or when Global is Done, regardless of queued commands
     {
       GlobalState gs = getGlobalState();
-      SubState s0 = getSub1State();
-      SubState s1 = getSub2State();
-      bool forceOff0 = (gs == GlobalState::Done) || (s0 == SubState::S_DRY);
-      bool forceOff1 = (gs == GlobalState::Done) || (s1 == SubState::S_DRY);
-      if (forceOff0) {
-        g_motorOn[0] = false;
-        g_heaterOn[0] = false;
-        g_motorTargetDuty[0] = 0;
-        setMotorPWM(0, 0);
-        setHeaterRelay(0, false);
-      }
-      if (forceOff1) {
-        g_motorOn[1] = false;
-        g_heaterOn[1] = false;
-        g_motorTargetDuty[1] = 0;
-        setMotorPWM(1, 0);
-        setHeaterRelay(1, false);
+      for (uint8_t i = 0; i < NUM_BAYS; ++i) {
+        if (gs != GlobalState::Done && getSubState(i) != SubState::S_DRY)
+          continue;
+        g_motorOn[i] = false;
+        g_heaterOn[i] = false;
+        g_motorTargetDuty[i] = 0;
+        setMotorPWM(i, 0);
+        setHeaterRelay(i, false);
       }
     }
 
     // Check sensor conditions and timeouts
-    for (int i = 0; i < 2; ++i) {
-      if (!g_motorActive[i])
+    for (int i = 0; i < NUM_BAYS; ++i) {
+      if (!g_motorActive[i] || paused)
         continue;
       
       // Dry threshold: when sensor reads dry, advance WET->COOLING
@@ -344,8 +393,8 @@ static void motorTask(void * /*pv*/) {
         DEV_DBG_PRINT("MOTOR: dry threshold reached for idx=");
         DEV_DBG_PRINTLN(i);
         // Don't stop motor/heater here - let COOLING state handle it
-        // Just post event to advance to COOLING
-        fsmExternalPost(Event::SubStart);
+        // Just post event to advance this shoe to COOLING
+        fsmExternalPostTo(i, Event::SubStart, static_cast<uint32_t>(AdvanceReason::DryThreshold));
         g_motorActive[i] = false; // Clear flag to avoid repeated posts
       }
       
@@ -360,14 +409,16 @@ static void motorTask(void * /*pv*/) {
         setHeaterRelay(i, false);
         g_motorActive[i] = false;
         g_motorStartMs[i] = 0;
-        fsmExternalPost(Event::SubStart);
+        fsmExternalPostTo(i, Event::SubStart, static_cast<uint32_t>(AdvanceReason::SafetyTimeout));
       }
     }
 
-    // PWM ramping: move current duty towards target duty
-    for (int i = 0; i < 2; ++i) {
+    // PWM ramping: move current duty towards the arbitrated target duty
+    int allowed[NUM_BAYS];
+    arbitrateFanDuty(allowed);
+    for (int i = 0; i < NUM_BAYS; ++i) {
       int cur = g_motorDuty[i];
-      int tgt = g_motorTargetDuty[i];
+      int tgt = allowed[i];
       if (cur < tgt) {
         cur += MOTOR_PWM_STEP;
         if (cur > tgt)
@@ -388,12 +439,13 @@ static void motorTask(void * /*pv*/) {
 bool motorInit() {
   if (g_motorQ)
     return true;
-  g_motorQ = xQueueCreate(8, sizeof(MotorMsg));
+  g_motorQ = xQueueCreate(16, sizeof(MotorMsg));
   if (!g_motorQ)
     return false;
   
   // Initialize PID controllers for motor control
-  for (int i = 0; i < 2; i++) {
+  for (int i = 0; i < NUM_BAYS; i++) {
+    g_motorPID[i].setTunings(PID_KP, PID_KI, PID_KD);
     g_motorPID[i].setOutputLimits(PID_OUT_MIN, PID_OUT_MAX);
     g_motorPID[i].setSampleTime(PID_SAMPLE_MS);
     g_motorPID[i].setSetpoint(TARGET_AH_RATE);
@@ -433,7 +485,7 @@ bool motorSetDutyPercent(uint8_t idx, int percent) {
 }
 
 uint32_t motorActiveMs(uint8_t idx) {
-  if (idx >= 2)
+  if (idx >= NUM_BAYS)
     return 0;
   if (!g_motorActive[idx])
     return 0;
@@ -441,17 +493,20 @@ uint32_t motorActiveMs(uint8_t idx) {
 }
 
 bool motorIsActive(uint8_t idx) {
-  return (idx < 2) ? g_motorActive[idx] : false;
+  return (idx < NUM_BAYS) ? g_motorActive[idx] : false;
 }
 
 bool motorIsOn(uint8_t idx) {
-  return (idx < 2) ? g_motorOn[idx] : false;
+  return (idx < NUM_BAYS) ? g_motorOn[idx] : false;
 }
 bool heaterIsOn(uint8_t idx) {
-  return (idx < 2) ? g_heaterOn[idx] : false;
+  return (idx < NUM_BAYS) ? g_heaterOn[idx] : false;
+}
+bool heaterIsPowered(uint8_t idx) {
+  return (idx < NUM_BAYS) ? g_heaterRelay[idx] : false;
 }
 int getMotorDutyCycle(uint8_t idx) {
-  if (idx >= 2) return 0;
+  if (idx >= NUM_BAYS) return 0;
   // Convert PWM value (0-1023) to percentage (0-100)
   return (int)((g_motorDuty[idx] * 100) / MOTOR_PWM_MAX);
 }
\ No newline at end of file
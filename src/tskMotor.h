@@ -21,6 +21,8 @@ uint32_t motorActiveMs(uint8_t idx);
 // Query whether motor/heater outputs are currently on
 bool motorIsOn(uint8_t idx);
 bool heaterIsOn(uint8_t idx);
+// Heater relay actually energized: false while a battery hold overrides heaterIsOn()
+bool heaterIsPowered(uint8_t idx);
 
 // Query if the motor task is active for index
 bool motorIsActive(uint8_t idx);
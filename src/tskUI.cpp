@@ -4,6 +4,7 @@
 #include "tskMotor.h"
 #include "tskUV.h"
 #include "tskFSM.h"
+#include "recipe.h"
 #include <ui.h>
 #include <Arduino.h>
 #include <cmath>
@@ -20,6 +21,8 @@ uint32_t g_cycleStartMs = 0;
 static GlobalState g_lastGlobalState = GlobalState::Idle;
 static uint32_t g_stateStartMs = 0;
 static volatile bool g_rightReady = false;
+static volatile bool g_splashEntryPending = false;
+static TaskHandle_t s_leftScreenTask = nullptr;
 
 // State abbreviation lookup tables
 static const char* GLOBAL_STATE_ABBR[] = {
@@ -58,7 +61,7 @@ static const char* getSubStateAbbr(SubState ss) {
 
 // Weighted progress calculation: WET path = full cycle, DRY-only = UV progress
 static int getShoeProgress(int shoeIdx, uint32_t nowMs) {
-  SubState state = (shoeIdx == 0) ? getSub1State() : getSub2State();
+  SubState state = getSubState(shoeIdx);
   
   if (state == SubState::S_DONE) return 100;
   
@@ -148,7 +151,7 @@ void triggerSplashAnimation() {
 }
 
 // Entry-only splash (no exit animation) for reset button
-void triggerSplashEntryOnly() {
+static void playSplashEntryOnly() {
   // Faster typing and shorter hold than boot
   leftScreen.showSplash("SOLE", 60, 300, 48, true);
   if (g_rightReady) {
@@ -157,6 +160,13 @@ void triggerSplashEntryOnly() {
   vTaskDelay(pdMS_TO_TICKS(300));
 }
 
+// Called from the FSM task: hand the splash to the left screen task instead
+// of blocking the caller on the I2C animation
+void triggerSplashEntryOnly() {
+  g_splashEntryPending = true;
+  if (s_leftScreenTask) xTaskNotifyGive(s_leftScreenTask);
+}
+
 //==============================================================================
 // LEFT SCREEN TASK - Progress Tracking
 //==============================================================================
@@ -172,6 +182,11 @@ void vLeftScreenTask(void * /*pv*/) {
   vTaskDelay(pdMS_TO_TICKS(500));
 
   while (true) {
+    if (g_splashEntryPending) {
+      g_splashEntryPending = false;
+      playSplashEntryOnly();
+    }
+
     uint32_t now = millis();
     
     GlobalState gs = getGlobalState();
@@ -180,10 +195,6 @@ void vLeftScreenTask(void * /*pv*/) {
     if (gs != g_lastGlobalState) {
       g_lastGlobalState = gs;
       g_stateStartMs = now;
-      // Refresh battery reading when entering Idle so UI shows latest value
-      if (gs == GlobalState::Idle) {
-        g_lastBatteryVoltage = readBatteryVoltage();
-      }
     }
     
     uint32_t stateElapsedSec = (now - g_stateStartMs) / 1000;
@@ -197,35 +208,28 @@ void vLeftScreenTask(void * /*pv*/) {
     drawProgressBar(progress1, pb1, sizeof(pb1));
     drawProgressBar(progress2, pb2, sizeof(pb2));
     
-    // Battery: refresh while in Idle so reset button shows latest
+    // Battery: cached by the battery task every BATTERY_CHECK_INTERVAL_MS
     float batteryV = g_lastBatteryVoltage;
-    if (gs == GlobalState::Idle) {
-      batteryV = readBatteryVoltage();
-      g_lastBatteryVoltage = batteryV;
-    }
 
     // Format display message
     char msg[128];
     snprintf(msg, sizeof(msg),
-             "%s - %02lu:%02lu\n"
+             "%s %s - %02lu:%02lu\n"
              "---\n"
              "S1[%s] %s %d%%\n"
              "S2[%s] %s %d%%\n"
              "---\n"
              "UV: %lus\n"
              "Bat: %.1fV",
-             getGlobalStateAbbr(gs), mins, secs,
+             getGlobalStateAbbr(gs), recipe(recipeSelected()).abbr, mins, secs,
              (g_dhtIsWet[0] ? "WET" : "DRY"), pb1, progress1,
              (g_dhtIsWet[1] ? "WET" : "DRY"), pb2, progress2,
              uvRemainingMs(0) / 1000,
              batteryV);
-      if (gs == GlobalState::Idle) {
-        batteryV = readBatteryVoltage();
-        g_lastBatteryVoltage = batteryV;
-      }
     
     leftScreen.showMessage(String(msg));
-    vTaskDelay(pdMS_TO_TICKS(1000));
+    // Refresh once a second, or at once when a splash is requested
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
   }
 }
 
@@ -257,8 +261,8 @@ void vRightScreenTask(void * /*pv*/) {
     uint32_t now = millis();
     
     GlobalState gs = getGlobalState();
-    SubState ss1 = getSub1State();
-    SubState ss2 = getSub2State();
+    SubState ss1 = getSubState(0);
+    SubState ss2 = getSubState(1);
     
     // Format sensor values with NaN handling
     char ah0s[8], ah1s[8], ah2s[8];
@@ -311,6 +315,6 @@ void vRightScreenTask(void * /*pv*/) {
 //==============================================================================
 
 void createOledTasks() {
-  xTaskCreatePinnedToCore(vLeftScreenTask, "LeftScreen", 4096, NULL, 1, NULL, 0);
+  xTaskCreatePinnedToCore(vLeftScreenTask, "LeftScreen", 4096, NULL, 1, &s_leftScreenTask, 0);
   xTaskCreatePinnedToCore(vRightScreenTask, "RightScreen", 4096, NULL, 1, NULL, 0);
 }
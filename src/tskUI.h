@@ -7,4 +7,4 @@ extern uint32_t g_cycleStartMs;
 
 void createOledTasks();
 void triggerSplashAnimation();  // Called when reset button is pressed
-void triggerSplashEntryOnly();  // Entry-only splash for reset
+void triggerSplashEntryOnly();  // Entry-only splash for reset; non-blocking
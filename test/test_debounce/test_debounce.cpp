@@ -0,0 +1,106 @@
+// Host tests for the button debounce: pio test -e native
+#include <Debounce.h>
+#include <unity.h>
+#include <vector>
+
+static constexpr uint32_t WINDOW_MS = 50;
+static constexpr uint32_t LONG_MS = 1500;
+
+struct Level {
+  uint32_t atMs;
+  bool down;
+};
+
+// Replay a line's level changes a millisecond at a time the way buttons.cpp
+// sees them: each change is an edge, and the settle timer fires once the line
+// has been quiet for the window. Returns every non-None edge committed.
+static std::vector<DebounceEdge> replay(const std::vector<Level> &changes, uint32_t endMs) {
+  Debouncer d;
+  std::vector<DebounceEdge> out;
+  bool down = false;
+  bool armed = false;
+  size_t next = 0;
+  for (uint32_t t = 1; t <= endMs; ++t) {
+    for (; next < changes.size() && changes[next].atMs == t; ++next) {
+      down = changes[next].down;
+      d.edge(t);
+      armed = true;
+    }
+    if (armed && d.due(t, WINDOW_MS)) {
+      armed = false;
+      DebounceEdge e = d.settle(down, t, LONG_MS);
+      if (e != DebounceEdge::None)
+        out.push_back(e);
+    }
+  }
+  return out;
+}
+
+static void expectEdges(const std::vector<DebounceEdge> &want, const std::vector<DebounceEdge> &got) {
+  TEST_ASSERT_EQUAL_UINT32(want.size(), got.size());
+  for (size_t i = 0; i < want.size(); ++i)
+    TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(want[i]), static_cast<uint8_t>(got[i]));
+}
+
+void test_clean_press() {
+  expectEdges({DebounceEdge::Press, DebounceEdge::Release}, replay({{10, true}, {300, false}}, 1000));
+}
+
+void test_press_bounce_reports_one_press() {
+  expectEdges({DebounceEdge::Press, DebounceEdge::Release},
+              replay({{10, true}, {11, false}, {13, true}, {14, false}, {17, true}, {300, false}}, 1000));
+}
+
+// The first release edge reads the contact still closed: not a second press
+void test_release_bounce_reads_low() {
+  expectEdges({DebounceEdge::Press, DebounceEdge::Release},
+              replay({{10, true}, {300, false}, {301, true}, {303, false}, {304, true}, {306, false}}, 1000));
+}
+
+// A press released soon after the window still reports its release
+void test_quick_release_not_lost() {
+  expectEdges({DebounceEdge::Press, DebounceEdge::Release},
+              replay({{10, true}, {12, false}, {13, true}, {70, false}, {71, true}, {72, false}}, 1000));
+}
+
+// A tap shorter than the window is dropped whole and leaves nothing stuck
+void test_short_tap_dropped() {
+  expectEdges({DebounceEdge::Press, DebounceEdge::Release},
+              replay({{10, true}, {30, false}, {200, true}, {400, false}}, 1000));
+}
+
+// A glitch while held is bounce, not a release and a new press
+void test_glitch_while_held() {
+  expectEdges({DebounceEdge::Press, DebounceEdge::Release},
+              replay({{10, true}, {200, false}, {203, true}, {500, false}}, 1000));
+}
+
+void test_long_press() {
+  expectEdges({DebounceEdge::Press, DebounceEdge::LongRelease},
+              replay({{10, true}, {12, false}, {14, true}, {2000, false}, {2002, true}, {2003, false}}, 3000));
+}
+
+// Bounce that keeps the line busy delays the commit until it stops
+void test_commit_waits_for_quiet() {
+  Debouncer d;
+  d.edge(10);
+  d.edge(40);
+  TEST_ASSERT_FALSE(d.due(70, WINDOW_MS));
+  TEST_ASSERT_TRUE(d.due(90, WINDOW_MS));
+  TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(DebounceEdge::Press),
+                          static_cast<uint8_t>(d.settle(true, 90, LONG_MS)));
+  TEST_ASSERT_TRUE(d.down());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_clean_press);
+  RUN_TEST(test_press_bounce_reports_one_press);
+  RUN_TEST(test_release_bounce_reads_low);
+  RUN_TEST(test_quick_release_not_lost);
+  RUN_TEST(test_short_tap_dropped);
+  RUN_TEST(test_glitch_while_held);
+  RUN_TEST(test_long_press);
+  RUN_TEST(test_commit_waits_for_quiet);
+  return UNITY_END();
+}